@@ -0,0 +1,486 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "compressed_storage.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include "libmcu/logging.h"
+#include "libmcu/ringbuf.h"
+
+#if !defined(COMPRESSED_STORAGE_LOG_MAXLEN)
+/** The largest log accepted, in its original format */
+#define COMPRESSED_STORAGE_LOG_MAXLEN		256
+#endif
+#if !defined(COMPRESSED_STORAGE_TAGS_MAX)
+#define COMPRESSED_STORAGE_TAGS_MAX		16
+#endif
+#if !defined(COMPRESSED_STORAGE_LZ)
+#define COMPRESSED_STORAGE_LZ			1
+#endif
+
+#define VARINT_MAXLEN				10
+/* flags, 3 deltas, tag id, raw tag and message length */
+#define HEADER_MAXLEN				(1 + VARINT_MAXLEN * 6)
+#define RECORD_MAXLEN				\
+	(HEADER_MAXLEN + COMPRESSED_STORAGE_LOG_MAXLEN)
+
+#define FLAG_TYPE_MASK				0x07U
+#define FLAG_DICTIONARY				0x08U
+#define FLAG_LZ					0x10U
+/* the flag of logging_entry.type marking a log in dictionary mode */
+#define DICTIONARY_TYPE				0x80U
+
+#define LZ_MIN_MATCH				3
+#define LZ_MAX_MATCH				(LZ_MIN_MATCH + 15)
+#define LZ_WINDOW				4096
+
+struct delta_base {
+	unsigned long timestamp;
+	uintptr_t pc;
+	uintptr_t lr;
+};
+
+static size_t compressed_peek(void *buf, size_t bufsize);
+static size_t compressed_read(void *buf, size_t bufsize);
+static size_t compressed_consume(size_t size);
+static size_t compressed_write(const void *data, size_t size);
+static size_t compressed_count(void);
+
+static struct {
+	struct logging_backend ops;
+	pthread_mutex_t lock;
+	struct ringbuf storage;
+	size_t count;
+
+	struct delta_base writer; /* the last log written */
+	struct delta_base reader; /* the last log taken out */
+
+	const struct logging_tag *tags[COMPRESSED_STORAGE_TAGS_MAX];
+	size_t nr_tags;
+
+	uint8_t record[RECORD_MAXLEN];
+	uint8_t message[COMPRESSED_STORAGE_LOG_MAXLEN];
+} m = {
+	.ops = {
+		.peek = compressed_peek,
+		.read = compressed_read,
+		.consume = compressed_consume,
+		.write = compressed_write,
+		.count = compressed_count,
+	},
+};
+
+static size_t put_varint(uint8_t *buf, uint64_t v)
+{
+	size_t i = 0;
+
+	while (v >= 0x80) {
+		buf[i++] = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	buf[i++] = (uint8_t)v;
+
+	return i;
+}
+
+static size_t get_varint(const uint8_t *buf, size_t bufsize, uint64_t *v)
+{
+	uint64_t result = 0;
+
+	for (size_t i = 0; i < bufsize && i < VARINT_MAXLEN; i++) {
+		result |= (uint64_t)(buf[i] & 0x7f) << (i * 7);
+		if (!(buf[i] & 0x80)) {
+			*v = result;
+			return i + 1;
+		}
+	}
+
+	return 0;
+}
+
+static uint64_t zigzag(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+#if COMPRESSED_STORAGE_LZ
+/* LZSS: a flag byte precedes every 8 items, each of which is either a
+ * literal or a 2-byte match of 12-bit offset and 4-bit length. Returns 0
+ * unless the output gets smaller than the input. */
+static size_t lz_compress(uint8_t *out, size_t outsize,
+		const uint8_t *in, size_t len)
+{
+	size_t o = 0;
+	size_t i = 0;
+
+	while (i < len) {
+		const size_t flag_pos = o++;
+		uint8_t flags = 0;
+
+		for (unsigned int bit = 0; bit < 8 && i < len; bit++) {
+			size_t best_len = 0;
+			size_t best_off = 0;
+
+			for (size_t j = i > LZ_WINDOW? i - LZ_WINDOW : 0;
+					j < i; j++) {
+				size_t k = 0;
+				while (k < LZ_MAX_MATCH && i + k < len &&
+						in[j + k] == in[i + k]) {
+					k++;
+				}
+				if (k > best_len) {
+					best_len = k;
+					best_off = i - j;
+				}
+			}
+
+			if (best_len >= LZ_MIN_MATCH) {
+				if (o + 2 >= outsize) {
+					return 0;
+				}
+				flags = (uint8_t)(flags | (1U << bit));
+				out[o++] = (uint8_t)((best_off - 1) >> 4);
+				out[o++] = (uint8_t)(((best_off - 1) & 0xf) << 4
+						| (best_len - LZ_MIN_MATCH));
+				i += best_len;
+			} else {
+				if (o + 1 >= outsize) {
+					return 0;
+				}
+				out[o++] = in[i++];
+			}
+		}
+
+		out[flag_pos] = flags;
+	}
+
+	return o < len? o : 0;
+}
+#endif
+
+static size_t lz_decompress(uint8_t *out, size_t outsize,
+		const uint8_t *in, size_t len)
+{
+	size_t o = 0;
+	size_t i = 0;
+
+	while (i < len) {
+		const uint8_t flags = in[i++];
+
+		for (unsigned int bit = 0; bit < 8 && i < len; bit++) {
+			if (flags & (1U << bit)) {
+				if (len - i < 2) {
+					return 0;
+				}
+
+				const size_t off = ((size_t)in[i] << 4 |
+						(size_t)(in[i + 1] >> 4)) + 1;
+				size_t n = (size_t)(in[i + 1] & 0xf)
+					+ LZ_MIN_MATCH;
+				i += 2;
+
+				if (off > o || outsize - o < n) {
+					return 0;
+				}
+				for (; n; n--, o++) {
+					out[o] = out[o - off];
+				}
+			} else {
+				if (o >= outsize) {
+					return 0;
+				}
+				out[o++] = in[i++];
+			}
+		}
+	}
+
+	return o;
+}
+
+static uint64_t get_tag_id(const struct logging_tag *tag)
+{
+	for (size_t i = 0; i < m.nr_tags; i++) {
+		if (m.tags[i] == tag) {
+			return i + 1;
+		}
+	}
+
+	if (m.nr_tags < COMPRESSED_STORAGE_TAGS_MAX) {
+		m.tags[m.nr_tags++] = tag;
+		return m.nr_tags;
+	}
+
+	return 0; /* the pointer itself follows */
+}
+
+static size_t encode(uint8_t *buf, const struct logging_entry *entry,
+		const struct delta_base *base)
+{
+	size_t len = 1;
+	uint8_t flags = (uint8_t)(entry->type & FLAG_TYPE_MASK);
+	const uint64_t tag_id = get_tag_id(entry->tag);
+
+	if (entry->type & DICTIONARY_TYPE) {
+		flags |= FLAG_DICTIONARY;
+	}
+
+	len += put_varint(&buf[len], zigzag((int64_t)(long)
+			(entry->timestamp - base->timestamp)));
+	len += put_varint(&buf[len], zigzag((int64_t)(intptr_t)
+			(entry->pc - base->pc)));
+	len += put_varint(&buf[len], zigzag((int64_t)(intptr_t)
+			(entry->lr - base->lr)));
+	len += put_varint(&buf[len], tag_id);
+	if (tag_id == 0) {
+		len += put_varint(&buf[len], (uintptr_t)entry->tag);
+	}
+
+	size_t compressed = 0;
+#if COMPRESSED_STORAGE_LZ
+	uint8_t *p = &buf[len + put_varint(&buf[len], entry->message_length)];
+	compressed = lz_compress(p, COMPRESSED_STORAGE_LOG_MAXLEN,
+			(const uint8_t *)entry->message, entry->message_length);
+	if (compressed) {
+		flags |= FLAG_LZ;
+		len = (size_t)(p - buf) + compressed;
+	}
+#endif
+	if (!compressed) {
+		memcpy(&buf[len], entry->message, entry->message_length);
+		len += entry->message_length;
+	}
+
+	buf[0] = flags;
+
+	return len;
+}
+
+static bool decode(const uint8_t *buf, size_t len,
+		struct logging_entry *entry, struct delta_base *base)
+{
+	uint64_t v[4];
+	size_t i = 1;
+
+	if (len < 1) {
+		return false;
+	}
+
+	for (size_t j = 0; j < sizeof(v) / sizeof(*v); j++) {
+		const size_t n = get_varint(&buf[i], len - i, &v[j]);
+		if (n == 0) {
+			return false;
+		}
+		i += n;
+	}
+
+	base->timestamp += (unsigned long)unzigzag(v[0]);
+	base->pc += (uintptr_t)unzigzag(v[1]);
+	base->lr += (uintptr_t)unzigzag(v[2]);
+
+	*entry = (struct logging_entry) {
+		.timestamp = base->timestamp,
+		.pc = base->pc,
+		.lr = base->lr,
+		.type = (uint8_t)(buf[0] & FLAG_TYPE_MASK),
+	};
+
+	if (buf[0] & FLAG_DICTIONARY) {
+		entry->type |= DICTIONARY_TYPE;
+	}
+
+	if (v[3] == 0) {
+		uint64_t tag;
+		const size_t n = get_varint(&buf[i], len - i, &tag);
+		if (n == 0) {
+			return false;
+		}
+		entry->tag = (const struct logging_tag *)(uintptr_t)tag;
+		i += n;
+	} else if (v[3] <= m.nr_tags) {
+		entry->tag = m.tags[v[3] - 1];
+	} else {
+		return false;
+	}
+
+	if (buf[0] & FLAG_LZ) {
+		uint64_t msglen;
+		const size_t n = get_varint(&buf[i], len - i, &msglen);
+		if (n == 0 || msglen > sizeof(m.message) ||
+				lz_decompress(m.message, sizeof(m.message),
+					&buf[i + n], len - i - n) != msglen) {
+			return false;
+		}
+		entry->message = m.message;
+		entry->message_length = (uint16_t)msglen;
+	} else {
+		entry->message = &buf[i];
+		entry->message_length = (uint16_t)(len - i);
+	}
+
+	return true;
+}
+
+/* Reads the oldest record into m.record, returning its size in the
+ * storage including the length prefix. */
+static size_t peek_record(size_t *record_len)
+{
+	uint8_t prefix[VARINT_MAXLEN];
+	uint64_t len;
+	size_t n = ringbuf_peek(&m.storage, 0, prefix, sizeof(prefix));
+
+	if ((n = get_varint(prefix, n, &len)) == 0 || len > sizeof(m.record) ||
+			ringbuf_peek(&m.storage, n, m.record, (size_t)len)
+				!= len) {
+		return 0;
+	}
+
+	*record_len = (size_t)len;
+
+	return n + (size_t)len;
+}
+
+static size_t peek_internal(void *buf, size_t bufsize, size_t *stored_size)
+{
+	struct delta_base base = m.reader;
+	struct logging_entry entry;
+	size_t record_len;
+	size_t size;
+
+	if ((*stored_size = peek_record(&record_len)) == 0 ||
+			!decode(m.record, record_len, &entry, &base) ||
+			(size = logging_pack(buf, bufsize, &entry)) == 0) {
+		return 0;
+	}
+
+	return size;
+}
+
+static size_t consume_internal(size_t stored_size)
+{
+	struct logging_entry entry;
+	size_t record_len;
+
+	if (peek_record(&record_len) != stored_size ||
+			!decode(m.record, record_len, &entry, &m.reader)) {
+		return 0;
+	}
+
+	ringbuf_consume(&m.storage, stored_size);
+	m.count--;
+
+	return stored_size;
+}
+
+static size_t compressed_peek(void *buf, size_t bufsize)
+{
+	size_t stored_size;
+
+	pthread_mutex_lock(&m.lock);
+	size_t bytes_read = peek_internal(buf, bufsize, &stored_size);
+	pthread_mutex_unlock(&m.lock);
+
+	return bytes_read;
+}
+
+static size_t compressed_read(void *buf, size_t bufsize)
+{
+	size_t stored_size;
+
+	pthread_mutex_lock(&m.lock);
+	size_t bytes_read = peek_internal(buf, bufsize, &stored_size);
+	if (bytes_read > 0) {
+		consume_internal(stored_size);
+	}
+	pthread_mutex_unlock(&m.lock);
+
+	return bytes_read;
+}
+
+static size_t compressed_consume(size_t size)
+{
+	uint8_t log[COMPRESSED_STORAGE_LOG_MAXLEN];
+	size_t stored_size;
+
+	pthread_mutex_lock(&m.lock);
+	size_t bytes_consumed = peek_internal(log, sizeof(log), &stored_size);
+	if (bytes_consumed > 0 && consume_internal(stored_size) == 0) {
+		bytes_consumed = 0;
+	}
+	pthread_mutex_unlock(&m.lock);
+
+	(void)size;
+
+	return bytes_consumed;
+}
+
+static size_t compressed_write(const void *data, size_t size)
+{
+	struct logging_entry entry;
+	uint8_t prefix[VARINT_MAXLEN];
+	size_t written = 0;
+
+	if (size > COMPRESSED_STORAGE_LOG_MAXLEN ||
+			logging_unpack(data, size, &entry) != 0) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&m.lock);
+	{
+		const size_t len = encode(m.record, &entry, &m.writer);
+		const struct ringbuf_const_iovec iov[] = {
+			{ .base = prefix, .len = put_varint(prefix, len), },
+			{ .base = m.record, .len = len, },
+		};
+
+		if (ringbuf_writev(&m.storage, iov,
+				sizeof(iov) / sizeof(*iov))) {
+			m.writer = (struct delta_base) {
+				.timestamp = entry.timestamp,
+				.pc = entry.pc,
+				.lr = entry.lr,
+			};
+			m.count++;
+			written = size;
+		}
+	}
+	pthread_mutex_unlock(&m.lock);
+
+	return written;
+}
+
+static size_t compressed_count(void)
+{
+	pthread_mutex_lock(&m.lock);
+	size_t count = m.count;
+	pthread_mutex_unlock(&m.lock);
+
+	return count;
+}
+
+const struct logging_backend *compressed_storage_init(void *storage,
+		size_t storage_size)
+{
+	ringbuf_create_static(&m.storage, storage, storage_size);
+	pthread_mutex_init(&m.lock, NULL);
+
+	m.count = 0;
+	m.nr_tags = 0;
+	memset(&m.writer, 0, sizeof(m.writer));
+	memset(&m.reader, 0, sizeof(m.reader));
+
+	return &m.ops;
+}
+
+void compressed_storage_deinit(void)
+{
+	pthread_mutex_destroy(&m.lock);
+}
@@ -0,0 +1,41 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef COMPRESSED_STORAGE_H
+#define COMPRESSED_STORAGE_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "libmcu/logging_backend.h"
+#include <stddef.h>
+
+/**
+ * @brief Initialize the storage keeping logs compressed in memory
+ *
+ * Timestamps, pc and lr are stored as varint deltas from the previous log,
+ * tags as indices into a table and messages LZ-compressed when it pays
+ * off. peek() and read() give logs back in the original format, so that
+ * logging_peek(), logging_read() and logging_stringify() work as usual.
+ *
+ * @note Logs must be taken out in order, as each log is decoded relative to
+ *       the previous one.
+ *
+ * @param storage memory to keep logs in
+ * @param storage_size size of @p storage
+ *
+ * @return backend to be registered with logging_add_backend()
+ */
+const struct logging_backend *compressed_storage_init(void *storage,
+		size_t storage_size);
+void compressed_storage_deinit(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* COMPRESSED_STORAGE_H */
@@ -5,22 +5,38 @@
  */
 
 #include "memory_storage.h"
+#include <errno.h>
 #include <pthread.h>
 #include <string.h>
 #include "libmcu/ringbuf.h"
 #include "libmcu/assert.h"
 
+/* The number of logs written with a single ringbuf_writev() */
+#define BATCH_CHUNK_MAX			8
+
 static size_t memory_peek(void *buf, size_t bufsize);
 static size_t memory_read(void *buf, size_t bufsize);
 static size_t memory_consume(size_t size);
 static size_t memory_write(const void *data, size_t size);
+static size_t memory_write_batch(const struct logging_record *logs, size_t n);
 static size_t memory_count(void);
+static int memory_open_cursor(struct logging_cursor *cursor);
+static void memory_close_cursor(struct logging_cursor *cursor);
+static size_t memory_peek_cursor(struct logging_cursor *cursor,
+		void *buf, size_t bufsize);
+static size_t memory_consume_cursor(struct logging_cursor *cursor);
+static size_t memory_count_cursor(const struct logging_cursor *cursor);
 
 static struct {
-	logging_storage_t ops;
+	struct logging_backend ops;
 	pthread_mutex_t storage_lock;
-	ringbuf_static_t storage;
+	struct ringbuf storage;
 	size_t count; // number of entries in the storage
+
+	struct logging_cursor *cursors;
+	size_t tail; // position of the oldest entry
+	size_t tail_seq; // sequence number of the oldest entry
+	bool drop_oldest;
 } memory_storage = {
 	.ops = {
 		.peek = memory_peek,
@@ -28,22 +44,80 @@ static struct {
 		.consume = memory_consume,
 		.write = memory_write,
 		.count = memory_count,
+		.write_batch = memory_write_batch,
+		.open_cursor = memory_open_cursor,
+		.close_cursor = memory_close_cursor,
+		.peek_cursor = memory_peek_cursor,
+		.consume_cursor = memory_consume_cursor,
+		.count_cursor = memory_count_cursor,
 	},
 };
 
-static size_t peek_internal(void *buf, size_t bufsize)
+static size_t peek_at(size_t pos, void *buf, size_t bufsize)
 {
+	const size_t offset = pos - memory_storage.tail;
 	size_t bytes_read = 0;
 	size_t data_size;
 
-	if (ringbuf_peek(&memory_storage.storage, 0, &data_size, sizeof(data_size))
+	if (ringbuf_peek(&memory_storage.storage, offset, &data_size, sizeof(data_size))
 			&& data_size <= bufsize) {
-		bytes_read = ringbuf_peek(&memory_storage.storage, sizeof(data_size), buf, data_size);
+		bytes_read = ringbuf_peek(&memory_storage.storage,
+				offset + sizeof(data_size), buf, data_size);
 	}
 
 	return bytes_read;
 }
 
+static size_t peek_internal(void *buf, size_t bufsize)
+{
+	return peek_at(memory_storage.tail, buf, bufsize);
+}
+
+/* Removes the oldest entry, moving the cursors still on it to the next. */
+static size_t remove_oldest(void)
+{
+	size_t data_size;
+
+	if (!ringbuf_peek(&memory_storage.storage, 0, &data_size, sizeof(data_size))
+			|| !ringbuf_consume(&memory_storage.storage,
+					data_size + sizeof(data_size))) {
+		return 0;
+	}
+
+	memory_storage.count--;
+	memory_storage.tail += data_size + sizeof(data_size);
+	memory_storage.tail_seq++;
+
+	for (struct logging_cursor *p = memory_storage.cursors; p; p = p->next) {
+		if (p->seq < memory_storage.tail_seq) {
+			p->pos = memory_storage.tail;
+			p->seq = memory_storage.tail_seq;
+			p->missed++;
+		}
+	}
+
+	return data_size;
+}
+
+/* Removes the entries all the cursors have moved past. */
+static void reclaim(void)
+{
+	if (memory_storage.cursors == NULL) {
+		return;
+	}
+
+	while (memory_storage.count > 0) {
+		for (struct logging_cursor *p = memory_storage.cursors;
+				p; p = p->next) {
+			if (p->seq == memory_storage.tail_seq) {
+				return;
+			}
+		}
+
+		remove_oldest();
+	}
+}
+
 static size_t memory_peek(void *buf, size_t bufsize)
 {
 	pthread_mutex_lock(&memory_storage.storage_lock);
@@ -58,9 +132,7 @@ static size_t memory_read(void *buf, size_t bufsize)
 	pthread_mutex_lock(&memory_storage.storage_lock);
 	size_t bytes_read = peek_internal(buf, bufsize);
 	if (bytes_read > 0) {
-		ringbuf_consume(&memory_storage.storage,
-				bytes_read + sizeof(bytes_read));
-		memory_storage.count--;
+		remove_oldest();
 	}
 	pthread_mutex_unlock(&memory_storage.storage_lock);
 
@@ -69,42 +141,86 @@ static size_t memory_read(void *buf, size_t bufsize)
 
 static size_t memory_consume(size_t size)
 {
-	size_t data_size = 0;
-
 	pthread_mutex_lock(&memory_storage.storage_lock);
-	if (ringbuf_peek(&memory_storage.storage, 0, &data_size, sizeof(data_size))) {
-		if (ringbuf_consume(&memory_storage.storage, data_size + sizeof(data_size))) {
-			assert(data_size == size);
-			memory_storage.count--;
-		} else {
-			data_size = 0;
-		}
-	}
+	size_t data_size = remove_oldest();
+	assert(data_size == 0 || data_size == size);
 	pthread_mutex_unlock(&memory_storage.storage_lock);
 
 	return data_size;
 }
 
-static size_t memory_write(const void *data, size_t size)
+/* Writes up to BATCH_CHUNK_MAX logs all or nothing, each prefixed with its
+ * size. */
+static size_t write_chunk(const struct logging_record *logs, size_t n)
+{
+	struct ringbuf_const_iovec iov[BATCH_CHUNK_MAX * 2];
+
+	if (n > BATCH_CHUNK_MAX) {
+		n = BATCH_CHUNK_MAX;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		iov[i * 2] = (struct ringbuf_const_iovec) {
+			.base = &logs[i].size,
+			.len = sizeof(logs[i].size),
+		};
+		iov[i * 2 + 1] = (struct ringbuf_const_iovec) {
+			.base = logs[i].data,
+			.len = logs[i].size,
+		};
+	}
+
+	if (ringbuf_writev(&memory_storage.storage, iov, n * 2) == 0) {
+		return 0;
+	}
+
+	return n;
+}
+
+static size_t memory_write_batch(const struct logging_record *logs, size_t n)
 {
 	size_t written = 0;
 
 	pthread_mutex_lock(&memory_storage.storage_lock);
-	if (ringbuf_write(&memory_storage.storage, &size, sizeof(size))) {
-		written = ringbuf_write(&memory_storage.storage, data, size);
-		if (written == size) {
-			memory_storage.count++;
-		} else {
-			ringbuf_write_cancel(&memory_storage.storage, sizeof(size));
+	while (written < n) {
+		size_t chunk = write_chunk(&logs[written], n - written);
+
+		if (chunk == 0) { /* fill up what is left one by one */
+			if ((chunk = write_chunk(&logs[written], 1)) == 0) {
+				if (memory_storage.drop_oldest &&
+						remove_oldest() > 0) {
+					continue;
+				}
+				break;
+			}
 		}
+
+		written += chunk;
+		memory_storage.count += chunk;
 	}
 	pthread_mutex_unlock(&memory_storage.storage_lock);
 
-	memory_storage_write_hook(data, size);
+	for (size_t i = 0; i < n; i++) {
+		memory_storage_write_hook(logs[i].data, logs[i].size);
+	}
 
 	return written;
 }
 
+static size_t memory_write(const void *data, size_t size)
+{
+	const struct logging_record log = {
+		.data = data,
+		.size = size,
+	};
+
+	if (memory_write_batch(&log, 1) == 0) {
+		return 0;
+	}
+
+	return size;
+}
+
 static size_t memory_count(void)
 {
 	pthread_mutex_lock(&memory_storage.storage_lock);
@@ -113,13 +229,103 @@ static size_t memory_count(void)
 	return count;
 }
 
-const logging_storage_t * __attribute__((weak))
+static int memory_open_cursor(struct logging_cursor *cursor)
+{
+	int err = 0;
+
+	pthread_mutex_lock(&memory_storage.storage_lock);
+	for (struct logging_cursor *p = memory_storage.cursors; p; p = p->next) {
+		if (p == cursor || strcmp(p->name, cursor->name) == 0) {
+			err = -EEXIST;
+			goto out;
+		}
+	}
+
+	cursor->pos = memory_storage.tail;
+	cursor->seq = memory_storage.tail_seq;
+	cursor->next = memory_storage.cursors;
+	memory_storage.cursors = cursor;
+out:
+	pthread_mutex_unlock(&memory_storage.storage_lock);
+
+	return err;
+}
+
+static void memory_close_cursor(struct logging_cursor *cursor)
+{
+	pthread_mutex_lock(&memory_storage.storage_lock);
+	for (struct logging_cursor **p = &memory_storage.cursors;
+			*p; p = &(*p)->next) {
+		if (*p == cursor) {
+			*p = cursor->next;
+			cursor->next = NULL;
+			break;
+		}
+	}
+	reclaim();
+	pthread_mutex_unlock(&memory_storage.storage_lock);
+}
+
+static size_t memory_peek_cursor(struct logging_cursor *cursor,
+		void *buf, size_t bufsize)
+{
+	size_t bytes_read = 0;
+
+	pthread_mutex_lock(&memory_storage.storage_lock);
+	if (cursor->seq < memory_storage.tail_seq + memory_storage.count) {
+		bytes_read = peek_at(cursor->pos, buf, bufsize);
+	}
+	pthread_mutex_unlock(&memory_storage.storage_lock);
+
+	return bytes_read;
+}
+
+static size_t memory_consume_cursor(struct logging_cursor *cursor)
+{
+	size_t data_size = 0;
+
+	pthread_mutex_lock(&memory_storage.storage_lock);
+	if (cursor->seq < memory_storage.tail_seq + memory_storage.count &&
+			ringbuf_peek(&memory_storage.storage,
+					cursor->pos - memory_storage.tail,
+					&data_size, sizeof(data_size))) {
+		cursor->pos += data_size + sizeof(data_size);
+		cursor->seq++;
+		reclaim();
+	}
+	pthread_mutex_unlock(&memory_storage.storage_lock);
+
+	return data_size;
+}
+
+static size_t memory_count_cursor(const struct logging_cursor *cursor)
+{
+	pthread_mutex_lock(&memory_storage.storage_lock);
+	size_t count = memory_storage.tail_seq + memory_storage.count
+		- cursor->seq;
+	pthread_mutex_unlock(&memory_storage.storage_lock);
+
+	return count;
+}
+
+void memory_storage_set_drop_oldest(bool enable)
+{
+	pthread_mutex_lock(&memory_storage.storage_lock);
+	memory_storage.drop_oldest = enable;
+	pthread_mutex_unlock(&memory_storage.storage_lock);
+}
+
+const struct logging_backend * __attribute__((weak))
 memory_storage_init(void *storage, size_t storage_size)
 {
 	ringbuf_create_static(&memory_storage.storage, storage, storage_size);
 
 	pthread_mutex_init(&memory_storage.storage_lock, NULL);
 	memory_storage.count = 0;
+	memory_storage.cursors = NULL;
+	memory_storage.tail = 0;
+	memory_storage.tail_seq = 0;
+	memory_storage.drop_oldest = false;
 
 	return &memory_storage.ops;
 }
@@ -13,10 +13,21 @@ extern "C" {
 
 #include "libmcu/logging_backend.h"
 #include <stddef.h>
+#include <stdbool.h>
 
-const logging_storage_t *memory_storage_init(void *storage, size_t storage_size);
+const struct logging_backend *memory_storage_init(void *storage, size_t storage_size);
 void memory_storage_deinit(void);
 void memory_storage_write_hook(const void *data, size_t size);
+/**
+ * @brief Make room for new logs by dropping the oldest when full
+ *
+ * By default, a log is not written when the storage is full. With this
+ * enabled, the oldest logs are dropped instead, even if not read by all the
+ * cursors yet. See logging_open_cursor().
+ *
+ * @param enable true to drop the oldest logs when full
+ */
+void memory_storage_set_drop_oldest(bool enable);
 
 #if defined(__cplusplus)
 }
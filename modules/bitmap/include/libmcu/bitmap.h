@@ -57,6 +57,15 @@ void bitmap_set(bitmap_t bitmap, int pos);
  */
 int bitmap_count(const bitmap_t bitmap, int n);
 
+/**
+ * @brief Find the first bit set at or after a position
+ * @param bitmap a pointer to @ref bitmap_t
+ * @param n number of bits used
+ * @param pos bit position to start from
+ * @return position of the bit found or -1 if none
+ */
+int bitmap_find_next_set(const bitmap_t bitmap, int n, int pos);
+
 /**
  * @brief Clear a bit in the bitmap
  * @param bitmap a pointer to @ref bitmap_t
@@ -50,6 +50,23 @@ int bitmap_count(const bitmap_t bitmap, int n)
 	return cnt;
 }
 
+/* Skips a whole word at a time, finding the lowest bit set in a word with a
+ * single count trailing zeros. */
+int bitmap_find_next_set(const bitmap_t bitmap, int n, int pos)
+{
+	for (int i = BITMAP_DIV(pos); pos < n; pos = ++i * BITMAP_UNIT_BITS) {
+		const bitmap_static_t word =
+			bitmap[i] >> BITMAP_REMAIN(pos);
+
+		if (word) {
+			pos += __builtin_ctzl((unsigned long)word);
+			return pos < n? pos : -1;
+		}
+	}
+
+	return -1;
+}
+
 void bitmap_clear(bitmap_t bitmap, int pos)
 {
 	bitmap_static_t t;
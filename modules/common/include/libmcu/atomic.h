@@ -0,0 +1,290 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_ATOMIC_H
+#define LIBMCU_ATOMIC_H
+
+#if defined(_MSC_VER) && !defined(__clang__) && defined(__cplusplus)
+#include <type_traits>
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*
+ * Atomic accessors working on plain objects so that public structures keep
+ * the same layout in both C and C++ translation units.
+ *
+ * The GCC/Clang `__atomic` builtins are used when available. MSVC relies on
+ * volatile accesses, which it gives acquire and release semantics under
+ * `/volatile:ms` and the Interlocked intrinsics for read-modify-write
+ * operations on 32 and 64-bit objects. Otherwise it falls back to volatile
+ * accesses with a release fence, which is only sufficient on single-core
+ * targets where aligned word accesses are naturally atomic, and to
+ * read-modify-write operations done between libmcu_atomic_lock() and
+ * libmcu_atomic_unlock(). Those come from the port, e.g. ports/armcm/atomic.c
+ * masking interrupts or the no-op ports/stubs/atomic.c for code that is
+ * never preempted.
+ */
+void libmcu_atomic_lock(void);
+void libmcu_atomic_unlock(void);
+
+#if defined(__GNUC__) || defined(__clang__)
+#define libmcu_atomic_load_relaxed(p)		\
+	__atomic_load_n(p, __ATOMIC_RELAXED)
+#define libmcu_atomic_load_acquire(p)		\
+	__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define libmcu_atomic_store_relaxed(p, v)	\
+	__atomic_store_n(p, v, __ATOMIC_RELAXED)
+#define libmcu_atomic_store_release(p, v)	\
+	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define libmcu_atomic_fetch_add(p, v)		\
+	__atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+/* Returns the new value. The accesses before are visible to whoever brings
+ * it down to zero, as needed for reference counting. */
+#define libmcu_atomic_sub_fetch(p, v)		\
+	__atomic_sub_fetch(p, v, __ATOMIC_ACQ_REL)
+#define libmcu_atomic_fetch_or(p, v)		\
+	__atomic_fetch_or(p, v, __ATOMIC_RELEASE)
+#define libmcu_atomic_fetch_and(p, v)		\
+	__atomic_fetch_and(p, v, __ATOMIC_RELEASE)
+#define libmcu_atomic_exchange(p, v)		\
+	__atomic_exchange_n(p, v, __ATOMIC_ACQ_REL)
+/* On failure, the current value is written back to `*expected`. */
+#define libmcu_atomic_compare_exchange(p, expected, desired)		\
+	__atomic_compare_exchange_n(p, expected, desired, 1,		\
+			__ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+#elif defined(_MSC_VER)
+#if defined(_ISO_VOLATILE)
+#error "volatile accesses are not ordered under /volatile:iso"
+#endif
+#if defined(__cplusplus)
+#define libmcu_atomic_typeof(x)		std::remove_reference<decltype(x)>::type
+#elif _MSC_VER >= 1939
+#define libmcu_atomic_typeof(x)		__typeof__(x)
+#else
+#error "C requires __typeof__ of Visual Studio 2022 17.9 or later"
+#endif
+#define libmcu_atomic_load_relaxed(p)		\
+	(*(volatile libmcu_atomic_typeof(*(p)) *)(p))
+#define libmcu_atomic_load_acquire(p)		libmcu_atomic_load_relaxed(p)
+#define libmcu_atomic_store_relaxed(p, v)	\
+	(*(volatile libmcu_atomic_typeof(*(p)) *)(p) = (v))
+#define libmcu_atomic_store_release(p, v)	\
+	libmcu_atomic_store_relaxed(p, v)
+
+#include <intrin.h>
+
+#if defined(_M_X64) || defined(_M_ARM64)
+#define libmcu_atomic_interlocked(f, p, v)	(sizeof(*(p)) == 8?	\
+	(libmcu_atomic_typeof(*(p)))f##64((volatile __int64 *)(p),	\
+			(__int64)(v)) :					\
+	(libmcu_atomic_typeof(*(p)))f((volatile long *)(p), (long)(v)))
+#define libmcu_atomic_compare_exchange(p, expected, desired)		\
+	(sizeof(*(p)) == 8?						\
+	libmcu_atomic_cas64((volatile __int64 *)(p), expected,		\
+			(__int64)(desired)) :				\
+	libmcu_atomic_cas32((volatile long *)(p), expected, (long)(desired)))
+#else
+#define libmcu_atomic_interlocked(f, p, v)	\
+	(libmcu_atomic_typeof(*(p)))f((volatile long *)(p), (long)(v))
+#define libmcu_atomic_compare_exchange(p, expected, desired)		\
+	libmcu_atomic_cas32((volatile long *)(p), expected, (long)(desired))
+#endif
+
+#define libmcu_atomic_fetch_add(p, v)		\
+	libmcu_atomic_interlocked(_InterlockedExchangeAdd, p, v)
+#define libmcu_atomic_sub_fetch(p, v)		\
+	(libmcu_atomic_typeof(*(p)))(libmcu_atomic_interlocked(	\
+		_InterlockedExchangeAdd, p, -(__int64)(v)) - (v))
+#define libmcu_atomic_fetch_or(p, v)		\
+	libmcu_atomic_interlocked(_InterlockedOr, p, v)
+#define libmcu_atomic_fetch_and(p, v)		\
+	libmcu_atomic_interlocked(_InterlockedAnd, p, v)
+#define libmcu_atomic_exchange(p, v)		\
+	libmcu_atomic_interlocked(_InterlockedExchange, p, v)
+
+static __inline int libmcu_atomic_cas32(volatile long *p,
+		void *expected, long desired)
+{
+	const long old = *(long *)expected;
+	const long prev = _InterlockedCompareExchange(p, desired, old);
+
+	if (prev == old) {
+		return 1;
+	}
+
+	*(long *)expected = prev;
+	return 0;
+}
+
+#if defined(_M_X64) || defined(_M_ARM64)
+static __inline int libmcu_atomic_cas64(volatile __int64 *p,
+		void *expected, __int64 desired)
+{
+	const __int64 old = *(__int64 *)expected;
+	const __int64 prev = _InterlockedCompareExchange64(p, desired, old);
+
+	if (prev == old) {
+		return 1;
+	}
+
+	*(__int64 *)expected = prev;
+	return 0;
+}
+#endif
+#else
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L \
+		&& !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define libmcu_atomic_fence_release()	\
+	atomic_thread_fence(memory_order_release)
+#else
+#define libmcu_atomic_fence_release()
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Accesses are dispatched on the object size as there is no portable way to
+ * name the type of an object before C23. */
+#define libmcu_atomic_load_relaxed(p)		\
+	libmcu_atomic_get(p, sizeof(*(p)))
+#define libmcu_atomic_load_acquire(p)		libmcu_atomic_load_relaxed(p)
+#define libmcu_atomic_store_relaxed(p, v)	\
+	libmcu_atomic_set(p, sizeof(*(p)), (uint64_t)(v))
+#define libmcu_atomic_store_release(p, v)	do {	\
+	libmcu_atomic_fence_release();			\
+	libmcu_atomic_store_relaxed(p, v);		\
+} while (0)
+
+enum libmcu_atomic_op {
+	LIBMCU_ATOMIC_FETCH_ADD,
+	LIBMCU_ATOMIC_SUB_FETCH,
+	LIBMCU_ATOMIC_FETCH_OR,
+	LIBMCU_ATOMIC_FETCH_AND,
+	LIBMCU_ATOMIC_EXCHANGE,
+};
+
+#define libmcu_atomic_rmw_op(p, op, v)		\
+	libmcu_atomic_rmw(p, sizeof(*(p)), op, (uint64_t)(v))
+#define libmcu_atomic_fetch_add(p, v)		\
+	libmcu_atomic_rmw_op(p, LIBMCU_ATOMIC_FETCH_ADD, v)
+#define libmcu_atomic_sub_fetch(p, v)		\
+	libmcu_atomic_rmw_op(p, LIBMCU_ATOMIC_SUB_FETCH, v)
+#define libmcu_atomic_fetch_or(p, v)		\
+	libmcu_atomic_rmw_op(p, LIBMCU_ATOMIC_FETCH_OR, v)
+#define libmcu_atomic_fetch_and(p, v)		\
+	libmcu_atomic_rmw_op(p, LIBMCU_ATOMIC_FETCH_AND, v)
+#define libmcu_atomic_exchange(p, v)		\
+	libmcu_atomic_rmw_op(p, LIBMCU_ATOMIC_EXCHANGE, v)
+#define libmcu_atomic_compare_exchange(p, expected, desired)		\
+	libmcu_atomic_cas(p, sizeof(*(p)), expected, (uint64_t)(desired))
+
+static inline uint64_t libmcu_atomic_get(const volatile void *p, size_t size)
+{
+	switch (size) {
+	case sizeof(uint8_t):
+		return *(const volatile uint8_t *)p;
+	case sizeof(uint16_t):
+		return *(const volatile uint16_t *)p;
+	case sizeof(uint32_t):
+		return *(const volatile uint32_t *)p;
+	default:
+		return *(const volatile uint64_t *)p;
+	}
+}
+
+static inline uint64_t libmcu_atomic_set(volatile void *p, size_t size,
+		uint64_t v)
+{
+	switch (size) {
+	case sizeof(uint8_t):
+		return *(volatile uint8_t *)p = (uint8_t)v;
+	case sizeof(uint16_t):
+		return *(volatile uint16_t *)p = (uint16_t)v;
+	case sizeof(uint32_t):
+		return *(volatile uint32_t *)p = (uint32_t)v;
+	default:
+		return *(volatile uint64_t *)p = v;
+	}
+}
+
+static inline uint64_t libmcu_atomic_rmw(volatile void *p, size_t size,
+		enum libmcu_atomic_op op, uint64_t v)
+{
+	libmcu_atomic_lock();
+
+	const uint64_t old = libmcu_atomic_get(p, size);
+	uint64_t result = old;
+
+	switch (op) {
+	case LIBMCU_ATOMIC_FETCH_ADD:
+		libmcu_atomic_set(p, size, old + v);
+		break;
+	case LIBMCU_ATOMIC_SUB_FETCH:
+		result = libmcu_atomic_set(p, size, old - v);
+		break;
+	case LIBMCU_ATOMIC_FETCH_OR:
+		libmcu_atomic_set(p, size, old | v);
+		break;
+	case LIBMCU_ATOMIC_FETCH_AND:
+		libmcu_atomic_set(p, size, old & v);
+		break;
+	case LIBMCU_ATOMIC_EXCHANGE:
+		libmcu_atomic_set(p, size, v);
+		break;
+	default:
+		break;
+	}
+
+	libmcu_atomic_unlock();
+
+	return result;
+}
+
+/* On failure, the current value is written back to `*expected`. */
+static inline bool libmcu_atomic_cas(volatile void *p, size_t size,
+		void *expected, uint64_t desired)
+{
+	libmcu_atomic_lock();
+
+	const uint64_t current = libmcu_atomic_get(p, size);
+	const bool matched = current == libmcu_atomic_get(expected, size);
+
+	if (matched) {
+		libmcu_atomic_set(p, size, desired);
+	} else {
+		libmcu_atomic_set(expected, size, current);
+	}
+
+	libmcu_atomic_unlock();
+
+	return matched;
+}
+#endif
+
+/* Pointers are loaded and stored through these, as the size-dispatched
+ * fallback has no way to give an integer its pointer type back. */
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#define libmcu_atomic_load_ptr_acquire(p, type)	\
+	((type)libmcu_atomic_load_acquire(p))
+#define libmcu_atomic_store_ptr_release(p, v)	\
+	libmcu_atomic_store_release(p, v)
+#else
+#define libmcu_atomic_load_ptr_acquire(p, type)	\
+	((type)(uintptr_t)libmcu_atomic_load_acquire(p))
+#define libmcu_atomic_store_ptr_release(p, v)	\
+	libmcu_atomic_store_release(p, (uintptr_t)(v))
+#endif
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_ATOMIC_H */
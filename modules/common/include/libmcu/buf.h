@@ -0,0 +1,119 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_BUF_H
+#define LIBMCU_BUF_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Reference counted message buffers to be handed around without copying,
+ * e.g. published to many subscribers or sent to many actors. Each holder
+ * takes a reference with lm_buf_ref() and drops it with lm_buf_unref(), and
+ * the buffer goes back to where it came from once the last one is dropped.
+ *
+ * Reference counting goes through libmcu/atomic.h, so compilers without the
+ * GNU atomic builtins need the port to provide libmcu_atomic_lock() and
+ * libmcu_atomic_unlock().
+ */
+
+struct lm_buf_pool;
+
+struct lm_buf {
+	struct lm_buf_pool *pool; /* NULL if allocated from the heap */
+	unsigned int refcnt;
+	size_t len;
+	/* followed by the data */
+};
+
+struct lm_buf_pool {
+	uint8_t *mem;
+	size_t slot_size;
+	size_t nr_slots;
+	size_t bufsize;
+	size_t hint;
+};
+
+/**
+ * @brief Initialize a pool of fixed-size buffers in the memory given
+ *
+ * @param[in] pool pool to be initialized
+ * @param[in] mem memory to carve buffers from, aligned to a pointer size
+ * @param[in] memsize size of @p mem
+ * @param[in] bufsize data size of each buffer
+ *
+ * @return 0 on success, -EINVAL if not even a single buffer fits in @p mem
+ */
+int lm_buf_pool_init(struct lm_buf_pool *pool,
+		void *mem, size_t memsize, size_t bufsize);
+/**
+ * @brief Count the buffers free in a pool
+ *
+ * @param[in] pool pool initialized by lm_buf_pool_init()
+ *
+ * @return the number of buffers free
+ */
+size_t lm_buf_pool_available(const struct lm_buf_pool *pool);
+
+/**
+ * @brief Allocate a buffer from a pool
+ *
+ * It never blocks nor takes a lock, so it can be called from interrupts.
+ *
+ * @param[in] pool pool initialized by lm_buf_pool_init()
+ * @param[in] len data length, which must not exceed the buffer size of
+ *            @p pool
+ *
+ * @return buffer with a single reference, or NULL if none is free
+ */
+struct lm_buf *lm_buf_alloc(struct lm_buf_pool *pool, size_t len);
+/**
+ * @brief Allocate a buffer from the heap
+ *
+ * @param[in] len data length
+ *
+ * @return buffer with a single reference, or NULL on allocation failure
+ */
+struct lm_buf *lm_buf_new(size_t len);
+
+/**
+ * @brief Take a reference
+ *
+ * @param[in] buf buffer to keep
+ *
+ * @return @p buf
+ */
+struct lm_buf *lm_buf_ref(struct lm_buf *buf);
+/**
+ * @brief Drop a reference, freeing the buffer when it was the last one
+ *
+ * @param[in] buf buffer to let go of
+ */
+void lm_buf_unref(struct lm_buf *buf);
+
+void *lm_buf_data(const struct lm_buf *buf);
+size_t lm_buf_len(const struct lm_buf *buf);
+/**
+ * @brief Get the buffer back from its data
+ *
+ * @note @p data must be the one returned by lm_buf_data().
+ *
+ * @param[in] data data of a buffer
+ *
+ * @return the buffer holding @p data
+ */
+struct lm_buf *lm_buf_from_data(const void *data);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_BUF_H */
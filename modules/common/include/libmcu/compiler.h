@@ -26,6 +26,7 @@ extern "C" {
 #define LIBMCU_WEAK			__attribute__((weak))
 #define LIBMCU_NORETURN			__attribute__((noreturn))
 #define LIBMCU_PACKED			__attribute__((packed))
+#define LIBMCU_ALIGNED(n)		__attribute__((aligned(n)))
 #define LIBMCU_NO_INSTRUMENT		__attribute__((no_instrument_function))
 #define NO_OPTIMIZE			__attribute__((optimize("O0")))
 #elif defined(_MSC_VER)
@@ -35,15 +36,21 @@ extern "C" {
 #define LIBMCU_WEAK
 #define LIBMCU_NORETURN			__declspec(noreturn)
 #define LIBMCU_PACKED
+#define LIBMCU_ALIGNED(n)		__declspec(align(n))
 #define LIBMCU_NO_INSTRUMENT
 #define NO_OPTIMIZE			__pragma(optimize("", off))
 #else
 #define LIBMCU_UNUSED
 #define LIBMCU_USED
 #define LIBMCU_ALWAYS_INLINE
+#if defined(__IAR_SYSTEMS_ICC__)
+#define LIBMCU_WEAK			__weak
+#else
 #define LIBMCU_WEAK
+#endif
 #define LIBMCU_NORETURN
 #define LIBMCU_PACKED
+#define LIBMCU_ALIGNED(n)
 #define LIBMCU_NO_INSTRUMENT
 #define NO_OPTIMIZE
 #endif
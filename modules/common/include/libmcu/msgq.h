@@ -12,6 +12,11 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
+
+#if !defined(MSGQ_WAIT_FOREVER)
+#define MSGQ_WAIT_FOREVER		UINT32_MAX
+#endif
 
 typedef struct {
 	size_t size;
@@ -20,7 +25,22 @@ typedef struct {
 typedef int (*msgq_lock_fn)(void *);
 typedef int (*msgq_unlock_fn)(void *);
 
+enum msgq_event {
+	MSGQ_EVENT_READABLE, /**< a message has been pushed */
+	MSGQ_EVENT_WRITABLE, /**< a message has been popped */
+};
+
+/**
+ * Blocks until @p event gets notified or @p timeout_ms elapses. Returns 0
+ * when woken up, which may be spurious, or non-zero on timeout.
+ * MSGQ_WAIT_FOREVER means no timeout. */
+typedef int (*msgq_wait_fn)(void *ctx, const enum msgq_event event,
+		const uint32_t timeout_ms);
+/** Wakes up a waiter blocked on @p event. Called outside of the lock. */
+typedef void (*msgq_notify_fn)(void *ctx, const enum msgq_event event);
+
 struct msgq;
+struct msgq_waiter;
 
 /**
  * @brief Creates a message queue with the specified capacity.
@@ -42,6 +62,32 @@ struct msgq;
  */
 struct msgq *msgq_create(const size_t capacity_bytes);
 
+/**
+ * @brief Creates a message queue with a narrow message header.
+ *
+ * This function works like msgq_create() except that the size of each
+ * message is stored in @p header_size bytes instead of
+ * sizeof(msgq_msg_meta_t), which saves memory when messages are small. The
+ * most significant bit of the header is reserved, so the maximum message size
+ * is 127, 32767 or 2147483647 bytes respectively.
+ *
+ * The payload of a message in a compact queue is always contiguous in memory
+ * so that it can be accessed in place with msgq_peek_pointer(). To keep it
+ * so, a message that would wrap around the end of the internal buffer is
+ * preceded by a padding record, which may make msgq_push() fail with
+ * -ENOMEM even though msgq_available() reports enough space. An empty queue
+ * starts over from the beginning of the buffer instead, so it always takes a
+ * message that fits in the capacity.
+ *
+ * @param[in] capacity_bytes The maximum capacity of the queue in bytes.
+ * @param[in] header_size Header width in bytes: 1, 2 or 4.
+ *
+ * @return A pointer to the created message queue, or NULL if the creation
+ *         fails or @p header_size is not supported.
+ */
+struct msgq *msgq_create_compact(const size_t capacity_bytes,
+		const size_t header_size);
+
 /**
  * @brief Destroys the specified message queue.
  *
@@ -69,6 +115,58 @@ void msgq_destroy(struct msgq *q);
 int msgq_set_sync(struct msgq *q,
 		msgq_lock_fn lock, msgq_unlock_fn unlock, void *ctx);
 
+/**
+ * @brief Sets wait and notify functions for the blocking operations.
+ *
+ * Once set, @p notify is called with MSGQ_EVENT_READABLE whenever a message
+ * gets pushed and with MSGQ_EVENT_WRITABLE whenever one gets popped, and
+ * msgq_pop_timed() and msgq_push_timed() sleep in @p wait instead of
+ * returning right away. Ports provide ready-made hooks, see
+ * msgq_waiter_create().
+ *
+ * @param[in] q Pointer to the message queue.
+ * @param[in] wait Function to block on an event.
+ * @param[in] notify Function to signal an event.
+ * @param[in] ctx Context passed to both functions.
+ *
+ * @return 0 on success, negative value on failure.
+ */
+int msgq_set_wait(struct msgq *q,
+		msgq_wait_fn wait, msgq_notify_fn notify, void *ctx);
+
+/**
+ * @brief Creates a waiter backed by the platform primitives.
+ *
+ * The waiter functions below are implemented by ports, e.g.
+ * ports/posix/msgq.c, and meant to be plugged into msgq_set_wait():
+ *
+ * @code
+ * struct msgq_waiter *waiter = msgq_waiter_create();
+ * msgq_set_wait(q, msgq_waiter_wait, msgq_waiter_notify, waiter);
+ * @endcode
+ *
+ * @return A pointer to the waiter, or NULL on failure.
+ */
+struct msgq_waiter *msgq_waiter_create(void);
+
+/**
+ * @brief Destroys a waiter created by msgq_waiter_create().
+ *
+ * @param[in] waiter Pointer to the waiter.
+ */
+void msgq_waiter_destroy(struct msgq_waiter *waiter);
+
+/**
+ * @brief msgq_wait_fn implementation of the port.
+ */
+int msgq_waiter_wait(void *waiter, const enum msgq_event event,
+		const uint32_t timeout_ms);
+
+/**
+ * @brief msgq_notify_fn implementation of the port.
+ */
+void msgq_waiter_notify(void *waiter, const enum msgq_event event);
+
 /**
  * @brief Pushes a message onto the message queue.
  *
@@ -81,10 +179,71 @@ int msgq_set_sync(struct msgq *q,
  * @param[in] data Pointer to the message data.
  * @param[in] datasize Size of the message data.
  *
- * @return 0 on success, negative value on failure.
+ * @return 0 on success, negative value on failure. -EMSGSIZE is returned
+ *         if @p datasize does not fit in the message header or the message
+ *         would not fit even in the empty queue.
  */
 int msgq_push(struct msgq *q, const void *data, const size_t datasize);
 
+/**
+ * @brief Pushes a message, waiting for space up to @p timeout_ms.
+ *
+ * @note Without msgq_set_wait(), this function behaves like msgq_push().
+ *
+ * @param[in] q Pointer to the message queue.
+ * @param[in] data Pointer to the message data.
+ * @param[in] datasize Size of the message data.
+ * @param[in] timeout_ms Time to wait in milliseconds, or MSGQ_WAIT_FOREVER.
+ *
+ * @return 0 on success, -ETIMEDOUT if no space was freed in time, or other
+ *         negative value as msgq_push() returns. A message that would never
+ *         fit fails with -EMSGSIZE right away rather than waiting.
+ */
+int msgq_push_timed(struct msgq *q, const void *data, const size_t datasize,
+		const uint32_t timeout_ms);
+
+/**
+ * @brief Reserves space for a message to be written in place.
+ *
+ * This function returns a pointer to contiguous space in the queue where the
+ * caller can build a message of up to @p datasize bytes directly, avoiding
+ * an intermediate copy. The message becomes visible to readers only after
+ * msgq_commit().
+ *
+ * When the space left up to the end of the internal buffer is too small for
+ * the message, the tail is filled with a padding record, which readers skip
+ * transparently. Padding is only introduced by this function and by
+ * msgq_push() on compact queues.
+ *
+ * @note The lock set by msgq_set_sync() is held from a successful reservation
+ *       until msgq_commit() or msgq_cancel() is called.
+ *
+ * @param[in] q Pointer to the message queue.
+ * @param[in] datasize Maximum size of the message to be written.
+ *
+ * @return Pointer to the reserved space, or NULL if there is not enough space
+ *         or the lock could not be acquired.
+ */
+void *msgq_reserve(struct msgq *q, const size_t datasize);
+
+/**
+ * @brief Publishes a message written in place after msgq_reserve().
+ *
+ * @param[in] q Pointer to the message queue.
+ * @param[in] datasize Actual size of the message, which must not exceed the
+ *            size reserved.
+ *
+ * @return 0 on success, negative value on failure.
+ */
+int msgq_commit(struct msgq *q, const size_t datasize);
+
+/**
+ * @brief Abandons a reservation made by msgq_reserve().
+ *
+ * @param[in] q Pointer to the message queue.
+ */
+void msgq_cancel(struct msgq *q);
+
 /**
  * @brief Pops a message from the message queue.
  *
@@ -103,6 +262,70 @@ int msgq_push(struct msgq *q, const void *data, const size_t datasize);
  */
 int msgq_pop(struct msgq *q, void *buf, size_t bufsize);
 
+/**
+ * @brief Pops a message, waiting for one up to @p timeout_ms.
+ *
+ * @note Without msgq_set_wait(), this function behaves like msgq_pop().
+ *
+ * @param[in] q Pointer to the message queue.
+ * @param[out] buf Buffer to store the message.
+ * @param[in] bufsize Size of the buffer.
+ * @param[in] timeout_ms Time to wait in milliseconds, or MSGQ_WAIT_FOREVER.
+ *
+ * @return The size of the message popped on success, -ETIMEDOUT if no
+ *         message arrived in time, or other negative value as msgq_pop()
+ *         returns.
+ */
+int msgq_pop_timed(struct msgq *q, void *buf, size_t bufsize,
+		const uint32_t timeout_ms);
+
+/**
+ * @brief Pops up to @p n messages under a single lock acquisition.
+ *
+ * The messages are copied back to back into @p buf and the size of each one
+ * is stored in @p sizes in order. Popping stops early when the queue runs
+ * out of messages or the next message does not fit in the space left.
+ *
+ * @param[in] q Pointer to the message queue.
+ * @param[out] buf Buffer to store the messages.
+ * @param[in] bufsize Size of @p buf.
+ * @param[out] sizes Array of at least @p n elements to store message sizes.
+ * @param[in] n Maximum number of messages to pop.
+ *
+ * @return The number of messages popped, or a negative value as msgq_pop()
+ *         returns if not even the first message could be popped.
+ */
+int msgq_pop_many(struct msgq *q, void *buf, size_t bufsize,
+		size_t *sizes, const size_t n);
+
+/**
+ * @brief Gets a pointer to the next message without copying it.
+ *
+ * @note The lock set by msgq_set_sync() is held from a successful call until
+ *       msgq_release() is called, so do not keep the message for long.
+ *
+ * @note Only queues created with msgq_create_compact() guarantee contiguous
+ *       payloads. For other queues, NULL is returned when the payload wraps
+ *       around the end of the internal buffer and msgq_pop() has to be used
+ *       instead.
+ *
+ * @param[in] q Pointer to the message queue.
+ * @param[out] size Size of the message.
+ *
+ * @return Pointer to the message payload, or NULL if the queue is empty or
+ *         the payload is not contiguous.
+ */
+const void *msgq_peek_pointer(struct msgq *q, size_t *size);
+
+/**
+ * @brief Removes the message got by msgq_peek_pointer() from the queue.
+ *
+ * @param[in] q Pointer to the message queue.
+ *
+ * @return 0 on success, negative value on failure.
+ */
+int msgq_release(struct msgq *q);
+
 /**
  * @brief Returns the capacity of the message queue.
  *
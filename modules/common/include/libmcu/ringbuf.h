@@ -18,20 +18,65 @@ extern "C" {
 
 #include "libmcu/compiler.h"
 
+#if defined(RINGBUF_CACHE_LINE_SIZE)
+#define RINGBUF_INDEX_ALIGNED		LIBMCU_ALIGNED(RINGBUF_CACHE_LINE_SIZE)
+#else
+#define RINGBUF_INDEX_ALIGNED
+#endif
+
+/**
+ * @brief Ring buffer handle.
+ *
+ * A ring buffer is lock-free and wait-free for a single producer and a single
+ * consumer running concurrently, e.g. an ISR producer and a task consumer.
+ * `index` is written only by the producer and `outdex` only by the consumer.
+ * Each side publishes its index with release semantics after the data is
+ * copied and observes the other side's index with acquire semantics.
+ *
+ * - Producer side: ringbuf_write(), ringbuf_writev(), ringbuf_write_cancel(),
+ *   ringbuf_reserve(), ringbuf_commit()
+ * - Consumer side: ringbuf_read(), ringbuf_readv(), ringbuf_peek(),
+ *   ringbuf_peek_pointer(), ringbuf_consume()
+ * - Either side: ringbuf_length(), ringbuf_available(), ringbuf_capacity()
+ *
+ * Multiple producers or multiple consumers still need external locking, and
+ * ringbuf_resize() must not run concurrently with any other call.
+ *
+ * Define `RINGBUF_CACHE_LINE_SIZE` to put `index` and `outdex` on separate
+ * cache lines so that the producer and the consumer running on different
+ * cores do not contend for the same line. Note that dynamically created
+ * handles are only aligned to what the allocator guarantees.
+ */
 struct ringbuf {
 	size_t capacity;
-	size_t index;
-	size_t outdex;
 	uint8_t *buffer;
+	RINGBUF_INDEX_ALIGNED size_t index;
+	RINGBUF_INDEX_ALIGNED size_t outdex;
+};
+
+/**
+ * @brief A span of data to be written by ringbuf_writev().
+ */
+struct ringbuf_const_iovec {
+	const void *base;
+	size_t len;
+};
+
+/**
+ * @brief A span of buffer to be filled by ringbuf_readv().
+ */
+struct ringbuf_iovec {
+	void *base;
+	size_t len;
 };
 
 #define DEFINE_RINGBUF(_name, _bufsize) \
 	static uint8_t LIBMCU_CONCAT(_name, _buf)[_bufsize]; \
 	static struct ringbuf _name = { \
 		.capacity = _bufsize, \
+		.buffer = LIBMCU_CONCAT(_name, _buf), \
 		.index = 0, \
 		.outdex = 0, \
-		.buffer = LIBMCU_CONCAT(_name, _buf), \
 	}; \
 	static_assert((_bufsize & (_bufsize - 1)) == 0, \
 			      "_bufsize should be power of 2.")
@@ -52,6 +97,23 @@ struct ringbuf {
 size_t ringbuf_write(struct ringbuf *handle,
 		const void *data, const size_t datasize);
 
+/**
+ * @brief Writes multiple spans of data to the ring buffer at once.
+ *
+ * This function writes the spans back to back and publishes them with a
+ * single index update, so the consumer sees either all of them or none.
+ * Unlike ringbuf_write(), nothing is written unless all the spans fit.
+ *
+ * @param[in] handle Pointer to the ring buffer handle.
+ * @param[in] iov Array of spans to be written.
+ * @param[in] iovcnt Number of spans in @p iov.
+ *
+ * @return The total number of bytes written, or 0 if there is not enough
+ *         space for all the spans.
+ */
+size_t ringbuf_writev(struct ringbuf *handle,
+		const struct ringbuf_const_iovec *iov, const size_t iovcnt);
+
 /**
  * @brief Cancels the write operation on the ring buffer.
  *
@@ -59,6 +121,10 @@ size_t ringbuf_write(struct ringbuf *handle,
  * written to the ring buffer. It effectively reduces the write pointer
  * by the specified size, making the space available for future writes.
  *
+ * @note The data being canceled is already visible to the consumer. In
+ *       single-producer/single-consumer use, cancel only what the consumer
+ *       is known not to have read yet.
+ *
  * @param[in] handle Pointer to the ring buffer handle.
  * @param[in] size The size of the data to cancel, in bytes.
  *
@@ -66,6 +132,44 @@ size_t ringbuf_write(struct ringbuf *handle,
  */
 size_t ringbuf_write_cancel(struct ringbuf *handle, const size_t size);
 
+/**
+ * @brief Reserves space in the ring buffer to be written in place.
+ *
+ * This function returns a pointer to the free space in the ring buffer so
+ * that the producer can fill it directly, avoiding an intermediate copy. The
+ * reserved space becomes visible to the consumer only after ringbuf_commit().
+ *
+ * If the reservation wraps around the end of the buffer, @p contiguous is
+ * set to the number of bytes up to the end of the buffer, which is less than
+ * @p len. Commit that first span and reserve again to get the rest at the
+ * beginning of the buffer. The rest is guaranteed to be available as long as
+ * the same producer is the only writer.
+ *
+ * @param[in] handle Pointer to the ring buffer handle.
+ * @param[in] len The number of bytes to reserve.
+ * @param[out] contiguous Pointer to a variable where the size of the
+ *             writable contiguous space will be stored.
+ *
+ * @return Pointer to the reserved space, or NULL if @p len is zero or
+ *         larger than the available space.
+ */
+void *ringbuf_reserve(struct ringbuf *handle,
+		const size_t len, size_t *contiguous);
+
+/**
+ * @brief Publishes data written in place after ringbuf_reserve().
+ *
+ * This function advances the write pointer by @p len, making the data
+ * written to the reserved space available for reading.
+ *
+ * @param[in] handle Pointer to the ring buffer handle.
+ * @param[in] len The number of bytes to publish.
+ *
+ * @return true if the operation was successful, false if @p len exceeds the
+ *         available space in the buffer.
+ */
+bool ringbuf_commit(struct ringbuf *handle, const size_t len);
+
 /**
  * @brief Peeks at the data in the ring buffer without removing it.
  *
@@ -135,6 +239,23 @@ bool ringbuf_consume(struct ringbuf *handle, const size_t consume_size);
 size_t ringbuf_read(struct ringbuf *handle,
 		const size_t offset, void *buf, const size_t bufsize);
 
+/**
+ * @brief Reads data from the ring buffer into multiple spans.
+ *
+ * This function fills the spans in order starting from a specified offset
+ * and then consumes what has been read, including the offset, with a single
+ * index update. It stops when no more data is left.
+ *
+ * @param[in] handle Pointer to the ring buffer handle.
+ * @param[in] offset The offset from the current read pointer to start reading.
+ * @param[in] iov Array of spans to be filled.
+ * @param[in] iovcnt Number of spans in @p iov.
+ *
+ * @return The total number of bytes read from the ring buffer.
+ */
+size_t ringbuf_readv(struct ringbuf *handle, const size_t offset,
+		const struct ringbuf_iovec *iov, const size_t iovcnt);
+
 /**
  * @brief Gets the current length of data in the ring buffer.
  *
@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "libmcu/buf.h"
+#include "libmcu/atomic.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#define ALIGNMENT				sizeof(uintptr_t)
+#define ALIGN_UP(x)				\
+	(((x) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+static struct lm_buf *get_slot(const struct lm_buf_pool *pool, size_t index)
+{
+	return (struct lm_buf *)(void *)&pool->mem[index * pool->slot_size];
+}
+
+int lm_buf_pool_init(struct lm_buf_pool *pool,
+		void *mem, size_t memsize, size_t bufsize)
+{
+	const size_t slot_size = ALIGN_UP(sizeof(struct lm_buf) + bufsize);
+
+	if (pool == NULL || mem == NULL || memsize < slot_size) {
+		return -EINVAL;
+	}
+
+	*pool = (struct lm_buf_pool) {
+		.mem = (uint8_t *)mem,
+		.slot_size = slot_size,
+		.nr_slots = memsize / slot_size,
+		.bufsize = bufsize,
+	};
+
+	for (size_t i = 0; i < pool->nr_slots; i++) {
+		struct lm_buf *buf = get_slot(pool, i);
+		buf->pool = pool;
+		buf->refcnt = 0;
+		buf->len = 0;
+	}
+
+	return 0;
+}
+
+size_t lm_buf_pool_available(const struct lm_buf_pool *pool)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < pool->nr_slots; i++) {
+		if (libmcu_atomic_load_relaxed(&get_slot(pool, i)->refcnt)
+				== 0) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/* A slot is free while its reference count is zero, so claiming one is a
+ * single compare-and-swap with no free list to suffer from ABA. Scanning
+ * starts where the last allocation left off. */
+struct lm_buf *lm_buf_alloc(struct lm_buf_pool *pool, size_t len)
+{
+	if (pool == NULL || len > pool->bufsize) {
+		return NULL;
+	}
+
+	const size_t start = libmcu_atomic_load_relaxed(&pool->hint);
+
+	for (size_t i = 0; i < pool->nr_slots; i++) {
+		const size_t index = (start + i) % pool->nr_slots;
+		struct lm_buf *buf = get_slot(pool, index);
+		unsigned int expected = 0;
+
+		if (libmcu_atomic_load_relaxed(&buf->refcnt) == 0 &&
+				libmcu_atomic_compare_exchange(&buf->refcnt,
+					&expected, 1)) {
+			libmcu_atomic_store_relaxed(&pool->hint,
+					(index + 1) % pool->nr_slots);
+			buf->len = len;
+			return buf;
+		}
+	}
+
+	return NULL;
+}
+
+struct lm_buf *lm_buf_new(size_t len)
+{
+	struct lm_buf *buf = (struct lm_buf *)malloc(sizeof(*buf) + len);
+
+	if (buf) {
+		buf->pool = NULL;
+		buf->refcnt = 1;
+		buf->len = len;
+	}
+
+	return buf;
+}
+
+struct lm_buf *lm_buf_ref(struct lm_buf *buf)
+{
+	libmcu_atomic_fetch_add(&buf->refcnt, 1);
+	return buf;
+}
+
+void lm_buf_unref(struct lm_buf *buf)
+{
+	if (buf == NULL) {
+		return;
+	}
+
+	/* A pool slot is free again as soon as the count hits zero */
+	if (libmcu_atomic_sub_fetch(&buf->refcnt, 1) == 0 &&
+			buf->pool == NULL) {
+		free(buf);
+	}
+}
+
+void *lm_buf_data(const struct lm_buf *buf)
+{
+	return (void *)((uintptr_t)buf + sizeof(*buf));
+}
+
+size_t lm_buf_len(const struct lm_buf *buf)
+{
+	return buf->len;
+}
+
+struct lm_buf *lm_buf_from_data(const void *data)
+{
+	return (struct lm_buf *)((uintptr_t)data - sizeof(struct lm_buf));
+}
@@ -7,66 +7,323 @@
 #include "libmcu/msgq.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
 #include <errno.h>
 
 #include "libmcu/ringbuf.h"
 #include "libmcu/bitops.h"
+#include "libmcu/board.h"
+
+/* A padding record fills up the tail of the ring buffer so that a reserved
+ * message payload never wraps around. It is marked with the most significant
+ * bit of the size field, whatever width the field is, and skipped by
+ * readers. */
+#define PADDING_FLAG(width)	((size_t)1 << ((width) * CHAR_BIT - 1))
 
 struct msgq {
 	struct ringbuf *ringbuf;
 	size_t capacity;
+	size_t meta_size; /* width of the size field in bytes */
+	bool compact; /* payloads never wrap around */
 
 	msgq_lock_fn lock;
 	msgq_unlock_fn unlock;
 	void *sync_ctx;
+
+	msgq_wait_fn wait;
+	msgq_notify_fn notify;
+	void *wait_ctx;
+
+	struct {
+		uint8_t *meta; /* where the meta goes. it may wrap around */
+		size_t meta_contiguous;
+		size_t size;
+	} reserved;
+
+	size_t peeked; /* bytes to be consumed on msgq_release() */
 };
 
-static int push_message(struct ringbuf *ringbuf,
-		const void *data, const size_t datasize)
+static void notify_event(const struct msgq *q, const enum msgq_event event)
 {
-	const size_t available =
-		ringbuf_capacity(ringbuf) - ringbuf_length(ringbuf);
-	const msgq_msg_meta_t meta = {
-		.size = datasize,
-	};
-	size_t n;
+	if (q->notify) {
+		q->notify(q->wait_ctx, event);
+	}
+}
 
-	if (datasize + sizeof(meta) > available) {
-		return -ENOMEM;
+static uint32_t get_time_left(const uint32_t started, const uint32_t timeout_ms)
+{
+	const uint32_t elapsed = board_get_time_since_boot_ms() - started;
+
+	if (timeout_ms == MSGQ_WAIT_FOREVER) {
+		return MSGQ_WAIT_FOREVER;
+	}
+
+	return elapsed >= timeout_ms? 0 : timeout_ms - elapsed;
+}
+
+static size_t get_max_msg_size(const struct msgq *q)
+{
+	return PADDING_FLAG(q->meta_size) - 1;
+}
+
+/* A message bigger than this would never fit, not even in an empty queue. */
+static bool is_msg_size_valid(const struct msgq *q, const size_t datasize)
+{
+	return datasize <= get_max_msg_size(q) &&
+		q->meta_size + datasize <= ringbuf_capacity(q->ringbuf);
+}
+
+/* Keeps the first error rather than mixing it up with the unlock result. */
+static int unlock_queue(const struct msgq *q, const int err)
+{
+	int rc = 0;
+
+	if (q->unlock) {
+		rc = q->unlock(q->sync_ctx);
+	}
+
+	return err? err : rc;
+}
+
+static void encode_meta(const struct msgq *q, uint8_t *buf, const size_t size)
+{
+	if (q->meta_size == sizeof(uint8_t)) {
+		const uint8_t v = (uint8_t)size;
+		memcpy(buf, &v, sizeof(v));
+	} else if (q->meta_size == sizeof(uint16_t)) {
+		const uint16_t v = (uint16_t)size;
+		memcpy(buf, &v, sizeof(v));
+	} else if (q->meta_size == sizeof(uint32_t)) {
+		const uint32_t v = (uint32_t)size;
+		memcpy(buf, &v, sizeof(v));
+	} else {
+		const msgq_msg_meta_t meta = { .size = size, };
+		memcpy(buf, &meta, sizeof(meta));
+	}
+}
+
+static size_t decode_meta(const struct msgq *q, const uint8_t *buf)
+{
+	if (q->meta_size == sizeof(uint8_t)) {
+		return buf[0];
+	} else if (q->meta_size == sizeof(uint16_t)) {
+		uint16_t v;
+		memcpy(&v, buf, sizeof(v));
+		return v;
+	} else if (q->meta_size == sizeof(uint32_t)) {
+		uint32_t v;
+		memcpy(&v, buf, sizeof(v));
+		return v;
+	}
+
+	msgq_msg_meta_t meta;
+	memcpy(&meta, buf, sizeof(meta));
+	return meta.size;
+}
+
+static int read_meta(const struct msgq *q, const size_t offset, size_t *size)
+{
+	uint8_t buf[sizeof(msgq_msg_meta_t)];
+	size_t contiguous;
+	const uint8_t *p = (const uint8_t *)
+		ringbuf_peek_pointer(q->ringbuf, offset, &contiguous);
+
+	if (p == NULL) {
+		return -ENOENT;
+	}
+
+	if (contiguous < q->meta_size) {
+		/* The meta wraps around. Fall back to copying. */
+		if (ringbuf_peek(q->ringbuf, offset, buf, q->meta_size)
+				!= q->meta_size) {
+			return -ENOENT;
+		}
+		p = buf;
 	}
 
-	if ((n = ringbuf_write(ringbuf, &meta, sizeof(meta))) != sizeof(meta)) {
-		ringbuf_write_cancel(ringbuf, n);
+	*size = decode_meta(q, p);
+
+	return 0;
+}
+
+/* Returns the offset of the first real message, skipping padding records. */
+static int peek_meta(const struct msgq *q, size_t *size, size_t *offset)
+{
+	const size_t flag = PADDING_FLAG(q->meta_size);
+
+	*offset = 0;
+
+	while (1) {
+		if (read_meta(q, *offset, size) != 0) {
+			return -ENOENT;
+		}
+
+		if ((*size & flag) == 0) {
+			break;
+		}
+
+		*offset += q->meta_size + (*size & ~flag);
+	}
+
+	return 0;
+}
+
+static int write_padding(struct msgq *q, uint8_t *p, size_t len)
+{
+	encode_meta(q, p, (len - q->meta_size) | PADDING_FLAG(q->meta_size));
+
+	return ringbuf_commit(q->ringbuf, len)? 0 : -EIO;
+}
+
+/* Skips the tail of an empty queue. No reader is behind, so the tail is
+ * consumed right away rather than left as padding, leaving the whole
+ * capacity contiguous from the beginning of the buffer. */
+static int rewind_queue(struct msgq *q, size_t tail)
+{
+	if (!ringbuf_commit(q->ringbuf, tail) ||
+			!ringbuf_consume(q->ringbuf, tail)) {
 		return -EIO;
 	}
 
-	if ((n = ringbuf_write(ringbuf, data, datasize)) != datasize) {
-		ringbuf_write_cancel(ringbuf, n + sizeof(meta));
+	return 0;
+}
+
+static void *reserve_message(struct msgq *q, const size_t datasize)
+{
+	struct ringbuf *ringbuf = q->ringbuf;
+	const size_t len = q->meta_size + datasize;
+	size_t contiguous;
+	uint8_t *p;
+
+	if (datasize > get_max_msg_size(q)) {
+		return NULL;
+	}
+
+	if ((p = (uint8_t *)ringbuf_reserve(ringbuf, len, &contiguous))
+			== NULL) {
+		return NULL;
+	}
+
+	if (contiguous < len && contiguous > q->meta_size) {
+		/* The payload would wrap around. Skip the tail, padding it
+		 * if messages are left before it, so that the message starts
+		 * from the beginning of the buffer. */
+		if (ringbuf_length(ringbuf) == 0) {
+			if (rewind_queue(q, contiguous) != 0) {
+				return NULL;
+			}
+		} else if (ringbuf_available(ringbuf) < contiguous + len ||
+				write_padding(q, p, contiguous) != 0) {
+			return NULL;
+		}
+		if ((p = (uint8_t *)ringbuf_reserve(ringbuf, len, &contiguous))
+				== NULL) {
+			return NULL;
+		}
+	}
+
+	q->reserved.meta = p;
+	q->reserved.meta_contiguous = contiguous;
+	q->reserved.size = datasize;
+
+	if (contiguous <= q->meta_size) {
+		/* The meta wraps around while the payload starts from the
+		 * beginning of the buffer, which is `contiguous` bytes off the
+		 * end of the buffer. */
+		uint8_t *base = p + contiguous - ringbuf_capacity(ringbuf);
+		return base + q->meta_size - contiguous;
+	}
+
+	return p + q->meta_size;
+}
+
+static int commit_message(struct msgq *q, const size_t datasize)
+{
+	uint8_t meta[sizeof(msgq_msg_meta_t)];
+	const size_t cut = q->reserved.meta_contiguous < q->meta_size?
+		q->reserved.meta_contiguous : q->meta_size;
+
+	if (datasize > q->reserved.size) {
+		return -EINVAL;
+	}
+
+	encode_meta(q, meta, datasize);
+
+	memcpy(q->reserved.meta, meta, cut);
+	if (cut < q->meta_size) {
+		uint8_t *base = q->reserved.meta + q->reserved.meta_contiguous
+			- ringbuf_capacity(q->ringbuf);
+		memcpy(base, &meta[cut], q->meta_size - cut);
+	}
+
+	if (!ringbuf_commit(q->ringbuf, q->meta_size + datasize)) {
 		return -EIO;
 	}
 
 	return 0;
 }
 
-static int pop_message(struct ringbuf *ringbuf, void *buf, size_t bufsize)
+static int push_message(struct msgq *q,
+		const void *data, const size_t datasize)
 {
-	msgq_msg_meta_t meta;
+	uint8_t meta[sizeof(msgq_msg_meta_t)];
+	const struct ringbuf_const_iovec iov[] = {
+		{ .base = meta, .len = q->meta_size, },
+		{ .base = data, .len = datasize, },
+	};
 
-	if (ringbuf_peek(ringbuf, 0, &meta, sizeof(meta)) != sizeof(meta)) {
+	if (!is_msg_size_valid(q, datasize)) {
+		return -EMSGSIZE;
+	}
+
+	if (q->compact) {
+		void *p = reserve_message(q, datasize);
+
+		if (p == NULL) {
+			return -ENOMEM;
+		}
+
+		memcpy(p, data, datasize);
+
+		return commit_message(q, datasize);
+	}
+
+	encode_meta(q, meta, datasize);
+
+	if (ringbuf_writev(q->ringbuf, iov, sizeof(iov) / sizeof(*iov)) == 0) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int pop_message(struct msgq *q, void *buf, size_t bufsize)
+{
+	size_t size;
+	size_t offset;
+
+	if (peek_meta(q, &size, &offset) != 0) {
 		return -ENOENT;
 	}
 
-	if (meta.size > bufsize) {
+	if (offset) {
+		ringbuf_consume(q->ringbuf, offset);
+	}
+
+	if (size > bufsize) {
 		return -ERANGE;
 	}
 
-	if (ringbuf_peek(ringbuf, sizeof(meta), buf, meta.size) != meta.size) {
+	if (ringbuf_peek(q->ringbuf, q->meta_size, buf, size) != size) {
 		return -EIO;
 	}
 
-	ringbuf_consume(ringbuf, sizeof(meta) + meta.size);
+	ringbuf_consume(q->ringbuf, q->meta_size + size);
 
-	return (int)meta.size;
+	return (int)size;
 }
 
 int msgq_push(struct msgq *q, const void *data, const size_t datasize)
@@ -75,10 +332,30 @@ int msgq_push(struct msgq *q, const void *data, const size_t datasize)
 		return -EAGAIN;
 	}
 
-	int err = push_message(q->ringbuf, data, datasize);
+	int err = push_message(q, data, datasize);
 
-	if (q->unlock) {
-		err |= q->unlock(q->sync_ctx);
+	err = unlock_queue(q, err);
+
+	if (err == 0) {
+		notify_event(q, MSGQ_EVENT_READABLE);
+	}
+
+	return err;
+}
+
+int msgq_push_timed(struct msgq *q, const void *data, const size_t datasize,
+		const uint32_t timeout_ms)
+{
+	const uint32_t started = board_get_time_since_boot_ms();
+	int err;
+
+	while ((err = msgq_push(q, data, datasize)) == -ENOMEM && q->wait) {
+		const uint32_t time_left = get_time_left(started, timeout_ms);
+
+		if (time_left == 0 || q->wait(q->wait_ctx,
+				MSGQ_EVENT_WRITABLE, time_left) != 0) {
+			return -ETIMEDOUT;
+		}
 	}
 
 	return err;
@@ -90,32 +367,194 @@ int msgq_pop(struct msgq *q, void *buf, size_t bufsize)
 		return -EAGAIN;
 	}
 
-	int bytes_read = pop_message(q->ringbuf, buf, bufsize);
+	int bytes_read = pop_message(q, buf, bufsize);
 
 	if (q->unlock) {
 		q->unlock(q->sync_ctx);
 	}
 
+	if (bytes_read >= 0) {
+		notify_event(q, MSGQ_EVENT_WRITABLE);
+	}
+
 	return bytes_read;
 }
 
-size_t msgq_next_msg_size(const struct msgq *q)
+int msgq_pop_timed(struct msgq *q, void *buf, size_t bufsize,
+		const uint32_t timeout_ms)
 {
-	msgq_msg_meta_t meta;
+	const uint32_t started = board_get_time_since_boot_ms();
+	int bytes_read;
+
+	while ((bytes_read = msgq_pop(q, buf, bufsize)) == -ENOENT && q->wait) {
+		const uint32_t time_left = get_time_left(started, timeout_ms);
+
+		if (time_left == 0 || q->wait(q->wait_ctx,
+				MSGQ_EVENT_READABLE, time_left) != 0) {
+			return -ETIMEDOUT;
+		}
+	}
+
+	return bytes_read;
+}
 
+void *msgq_reserve(struct msgq *q, const size_t datasize)
+{
 	if (q->lock && q->lock(q->sync_ctx) != 0) {
-		return 0;
+		return NULL;
+	}
+
+	void *p = reserve_message(q, datasize);
+
+	if (p == NULL && q->unlock) {
+		q->unlock(q->sync_ctx);
+	}
+
+	return p;
+}
+
+int msgq_commit(struct msgq *q, const size_t datasize)
+{
+	if (q->reserved.meta == NULL) {
+		return -EINVAL;
+	}
+
+	int err = commit_message(q, datasize);
+
+	q->reserved.meta = NULL;
+
+	err = unlock_queue(q, err);
+
+	if (err == 0) {
+		notify_event(q, MSGQ_EVENT_READABLE);
+	}
+
+	return err;
+}
+
+void msgq_cancel(struct msgq *q)
+{
+	if (q->reserved.meta == NULL) {
+		return;
+	}
+
+	q->reserved.meta = NULL;
+
+	if (q->unlock) {
+		q->unlock(q->sync_ctx);
+	}
+}
+
+int msgq_pop_many(struct msgq *q, void *buf, size_t bufsize,
+		size_t *sizes, const size_t n)
+{
+	size_t used = 0;
+	int count = 0;
+
+	if (q->lock && q->lock(q->sync_ctx) != 0) {
+		return -EAGAIN;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		int bytes_read = pop_message(q,
+				(uint8_t *)buf + used, bufsize - used);
+
+		if (bytes_read < 0) {
+			if (count == 0) {
+				count = bytes_read;
+			}
+			break;
+		}
+
+		sizes[i] = (size_t)bytes_read;
+		used += (size_t)bytes_read;
+		count++;
 	}
 
-	if (ringbuf_peek(q->ringbuf, 0, &meta, sizeof(meta)) != sizeof(meta)) {
+	if (q->unlock) {
+		q->unlock(q->sync_ctx);
+	}
+
+	if (count > 0) {
+		notify_event(q, MSGQ_EVENT_WRITABLE);
+	}
+
+	return count;
+}
+
+const void *msgq_peek_pointer(struct msgq *q, size_t *size)
+{
+	const void *p = NULL;
+	size_t offset;
+	size_t contiguous;
+
+	if (q->lock && q->lock(q->sync_ctx) != 0) {
+		return NULL;
+	}
+
+	if (peek_meta(q, size, &offset) == 0) {
+		if (*size == 0) {
+			/* Nothing to point at. Give the meta position. */
+			p = ringbuf_peek_pointer(q->ringbuf, offset, NULL);
+		} else if ((p = ringbuf_peek_pointer(q->ringbuf,
+				offset + q->meta_size, &contiguous))
+				&& contiguous < *size) {
+			p = NULL;
+		}
+	}
+
+	if (p == NULL) {
+		if (q->unlock) {
+			q->unlock(q->sync_ctx);
+		}
+		return NULL;
+	}
+
+	q->peeked = offset + q->meta_size + *size;
+
+	return p;
+}
+
+int msgq_release(struct msgq *q)
+{
+	int err = 0;
+
+	if (q->peeked == 0) {
+		return -EINVAL;
+	}
+
+	if (!ringbuf_consume(q->ringbuf, q->peeked)) {
+		err = -EIO;
+	}
+
+	q->peeked = 0;
+
+	err = unlock_queue(q, err);
+
+	if (err == 0) {
+		notify_event(q, MSGQ_EVENT_WRITABLE);
+	}
+
+	return err;
+}
+
+size_t msgq_next_msg_size(const struct msgq *q)
+{
+	size_t size;
+	size_t offset;
+	int err;
+
+	if (q->lock && q->lock(q->sync_ctx) != 0) {
 		return 0;
 	}
 
+	err = peek_meta(q, &size, &offset);
+
 	if (q->unlock) {
 		q->unlock(q->sync_ctx);
 	}
 
-	return meta.size;
+	return err? 0 : size;
 }
 
 size_t msgq_available(const struct msgq *q)
@@ -131,8 +570,7 @@ size_t msgq_available(const struct msgq *q)
 		q->unlock(q->sync_ctx);
 	}
 
-	return available < sizeof(msgq_msg_meta_t) ?
-		0 : available - sizeof(msgq_msg_meta_t);
+	return available < q->meta_size ? 0 : available - q->meta_size;
 }
 
 size_t msgq_cap(const struct msgq *q)
@@ -175,6 +613,16 @@ int msgq_set_sync(struct msgq *q,
 	return 0;
 }
 
+int msgq_set_wait(struct msgq *q,
+		msgq_wait_fn wait, msgq_notify_fn notify, void *ctx)
+{
+	q->wait = wait;
+	q->notify = notify;
+	q->wait_ctx = ctx;
+
+	return 0;
+}
+
 size_t msgq_calc_size(const size_t n, const size_t max_msg_size)
 {
 	const size_t requested = (sizeof(msgq_msg_meta_t) + max_msg_size) * n;
@@ -183,7 +631,8 @@ size_t msgq_calc_size(const size_t n, const size_t max_msg_size)
 	return 1UL << bit_corrected;
 }
 
-struct msgq *msgq_create(const size_t capacity_bytes)
+static struct msgq *create_queue(const size_t capacity_bytes,
+		const size_t meta_size, const bool compact)
 {
 	struct msgq *q;
 
@@ -198,14 +647,38 @@ struct msgq *msgq_create(const size_t capacity_bytes)
 		}
 
 		q->capacity = capacity_bytes;
+		q->meta_size = meta_size;
+		q->compact = compact;
 		q->lock = NULL;
 		q->unlock = NULL;
 		q->sync_ctx = NULL;
+		q->wait = NULL;
+		q->notify = NULL;
+		q->wait_ctx = NULL;
+		q->reserved.meta = NULL;
+		q->peeked = 0;
 	}
 
 	return q;
 }
 
+struct msgq *msgq_create(const size_t capacity_bytes)
+{
+	return create_queue(capacity_bytes, sizeof(msgq_msg_meta_t), false);
+}
+
+struct msgq *msgq_create_compact(const size_t capacity_bytes,
+		const size_t header_size)
+{
+	if (header_size != sizeof(uint8_t) &&
+			header_size != sizeof(uint16_t) &&
+			header_size != sizeof(uint32_t)) {
+		return NULL;
+	}
+
+	return create_queue(capacity_bytes, header_size, true);
+}
+
 void msgq_destroy(struct msgq *q)
 {
 	if (q) {
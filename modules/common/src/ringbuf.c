@@ -8,12 +8,10 @@
 
 #include <string.h>
 #include <stdlib.h>
-#if __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
-#include <stdatomic.h>
-#endif
 
 #include "libmcu/compiler.h"
 #include "libmcu/bitops.h"
+#include "libmcu/atomic.h"
 
 #define GET_INDEX(i, n)			((i) & ((n) - 1))
 #if !defined(MIN)
@@ -27,7 +25,12 @@ static size_t get_capacity(const struct ringbuf *handle)
 
 static size_t get_length(const struct ringbuf *handle)
 {
-	return handle->index - handle->outdex;
+	/* outdex must be loaded first. Otherwise outdex could be seen ahead of
+	 * a stale index. */
+	const size_t outdex = libmcu_atomic_load_acquire(&handle->outdex);
+	const size_t index = libmcu_atomic_load_acquire(&handle->index);
+
+	return index - outdex;
 }
 
 static size_t get_available(const struct ringbuf *handle)
@@ -43,13 +46,22 @@ static void initialize(struct ringbuf *handle, const size_t bufsize)
 	handle->outdex = 0;
 }
 
+/* Called only by the consumer. The consumer owns outdex so it can be loaded
+ * relaxed while index published by the producer is loaded with acquire. */
+static size_t load_consumer_view(const struct ringbuf *handle, size_t *outdex)
+{
+	*outdex = libmcu_atomic_load_relaxed(&handle->outdex);
+	return libmcu_atomic_load_acquire(&handle->index) - *outdex;
+}
+
 static uint8_t *get_pointer(const struct ringbuf *handle,
+		const size_t outdex, const size_t length,
 		const size_t offset, size_t *contiguous)
 {
-	size_t index = GET_INDEX(handle->outdex + offset, handle->capacity);
+	size_t index = GET_INDEX(outdex + offset, handle->capacity);
 	uint8_t *p = &handle->buffer[index];
 
-	if (offset >= get_length(handle)) {
+	if (offset >= length) {
 		p = NULL;
 		index = handle->capacity;
 	}
@@ -61,38 +73,58 @@ static uint8_t *get_pointer(const struct ringbuf *handle,
 	return p;
 }
 
-static size_t read_core(const struct ringbuf *handle,
-		const size_t offset, void *buf, const size_t bufsize)
+static void copy_out(const struct ringbuf *handle,
+		const size_t pos, void *buf, const size_t len)
+{
+	const size_t index = GET_INDEX(pos, handle->capacity);
+	const size_t contiguous = handle->capacity - index;
+	const size_t remained = (contiguous < len)? len - contiguous : 0;
+	const size_t cut = len - remained;
+
+	memcpy(buf, &handle->buffer[index], cut);
+	memcpy((uint8_t *)buf + cut, handle->buffer, remained);
+}
+
+static void copy_in(struct ringbuf *handle,
+		const size_t pos, const void *data, const size_t len)
 {
-	size_t contiguous;
-	const uint8_t *p = get_pointer(handle, offset, &contiguous);
-	const uint8_t *base = handle->buffer;
-	size_t bytes_read = 0;
+	const size_t index = GET_INDEX(pos, handle->capacity);
+	const size_t contiguous = handle->capacity - index;
+	const size_t remained = (contiguous < len)? len - contiguous : 0;
+	const size_t cut = len - remained;
 
-	if (p) {
-		const size_t len = MIN(get_length(handle) - offset, bufsize);
-		const size_t remained = contiguous < len? len - contiguous : 0;
-		const size_t cut = len - remained;
+	memcpy(&handle->buffer[index], data, cut);
+	memcpy(handle->buffer, (const uint8_t *)data + cut, remained);
+}
 
-		memcpy(buf, p, cut);
-		memcpy((uint8_t *)buf + cut, base, remained);
+static size_t read_core(const struct ringbuf *handle,
+		const size_t offset, void *buf, const size_t bufsize)
+{
+	size_t outdex;
+	const size_t length = load_consumer_view(handle, &outdex);
+	size_t len;
 
-		bytes_read = len;
+	if (offset >= length) {
+		return 0;
 	}
 
-	return bytes_read;
+	len = MIN(length - offset, bufsize);
+	copy_out(handle, outdex + offset, buf, len);
+
+	return len;
 }
 
 static bool consume_core(struct ringbuf *handle, const size_t consume_size)
 {
-	if (get_length(handle) < consume_size) {
+	size_t outdex;
+
+	if (load_consumer_view(handle, &outdex) < consume_size) {
 		return false;
 	}
 
-#if __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
-	atomic_thread_fence(memory_order_acquire);
-#endif
-	handle->outdex += consume_size;
+	/* release: the bytes must be fully read before the producer is allowed
+	 * to reuse the space. */
+	libmcu_atomic_store_release(&handle->outdex, outdex + consume_size);
 
 	return true;
 }
@@ -100,37 +132,92 @@ static bool consume_core(struct ringbuf *handle, const size_t consume_size)
 size_t ringbuf_write(struct ringbuf *handle,
 		const void *data, const size_t datasize)
 {
-	const size_t len = MIN(get_available(handle), datasize);
-	const size_t index = GET_INDEX(handle->index, handle->capacity);
-	const size_t contiguous = handle->capacity - index;
-	const size_t remained = (contiguous < len)? len - contiguous : 0;
-	const size_t cut = len - remained;
+	/* acquire: the consumer must be done with the space before it gets
+	 * overwritten. */
+	const size_t outdex = libmcu_atomic_load_acquire(&handle->outdex);
+	const size_t head = libmcu_atomic_load_relaxed(&handle->index);
+	const size_t available = get_capacity(handle) - (head - outdex);
+	const size_t len = MIN(available, datasize);
 
-	memcpy(handle->buffer + index, data, cut);
-	memcpy(handle->buffer, ((const uint8_t *)data + cut), remained);
+	copy_in(handle, head, data, len);
 
-#if __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
-	atomic_thread_fence(memory_order_release);
-#endif
-	handle->index += len;
+	/* release: the data must be visible before the new index is. */
+	libmcu_atomic_store_release(&handle->index, head + len);
 
 	return len;
 }
 
+size_t ringbuf_writev(struct ringbuf *handle,
+		const struct ringbuf_const_iovec *iov, const size_t iovcnt)
+{
+	const size_t outdex = libmcu_atomic_load_acquire(&handle->outdex);
+	const size_t head = libmcu_atomic_load_relaxed(&handle->index);
+	const size_t available = get_capacity(handle) - (head - outdex);
+	size_t total = 0;
+
+	for (size_t i = 0; i < iovcnt; i++) {
+		if (iov[i].len > available - total) {
+			return 0;
+		}
+		total += iov[i].len;
+	}
+
+	for (size_t i = 0, pos = head; i < iovcnt; pos += iov[i].len, i++) {
+		copy_in(handle, pos, iov[i].base, iov[i].len);
+	}
+
+	libmcu_atomic_store_release(&handle->index, head + total);
+
+	return total;
+}
+
 size_t ringbuf_write_cancel(struct ringbuf *handle, const size_t size)
 {
-	if (get_length(handle) < size) {
+	const size_t outdex = libmcu_atomic_load_acquire(&handle->outdex);
+	const size_t head = libmcu_atomic_load_relaxed(&handle->index);
+
+	if (head - outdex < size) {
 		return 0;
 	}
 
-#if __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
-	atomic_thread_fence(memory_order_release);
-#endif
-	handle->index -= size;
+	libmcu_atomic_store_release(&handle->index, head - size);
 
 	return size;
 }
 
+void *ringbuf_reserve(struct ringbuf *handle,
+		const size_t len, size_t *contiguous)
+{
+	const size_t outdex = libmcu_atomic_load_acquire(&handle->outdex);
+	const size_t head = libmcu_atomic_load_relaxed(&handle->index);
+	const size_t available = get_capacity(handle) - (head - outdex);
+	const size_t index = GET_INDEX(head, handle->capacity);
+
+	if (len == 0 || len > available) {
+		return NULL;
+	}
+
+	if (contiguous) {
+		*contiguous = MIN(len, handle->capacity - index);
+	}
+
+	return &handle->buffer[index];
+}
+
+bool ringbuf_commit(struct ringbuf *handle, const size_t len)
+{
+	const size_t outdex = libmcu_atomic_load_acquire(&handle->outdex);
+	const size_t head = libmcu_atomic_load_relaxed(&handle->index);
+
+	if (len > get_capacity(handle) - (head - outdex)) {
+		return false;
+	}
+
+	libmcu_atomic_store_release(&handle->index, head + len);
+
+	return true;
+}
+
 size_t ringbuf_peek(const struct ringbuf *handle,
 		const size_t offset, void *buf, const size_t bufsize)
 {
@@ -140,10 +227,12 @@ size_t ringbuf_peek(const struct ringbuf *handle,
 const void *ringbuf_peek_pointer(const struct ringbuf *handle,
 		const size_t offset, size_t *contiguous)
 {
-	const void *p = get_pointer(handle, offset, contiguous);
+	size_t outdex;
+	const size_t length = load_consumer_view(handle, &outdex);
+	const void *p = get_pointer(handle, outdex, length, offset, contiguous);
 
-	if (contiguous) {
-		*contiguous = MIN(*contiguous, get_length(handle) - offset);
+	if (contiguous && p) {
+		*contiguous = MIN(*contiguous, length - offset);
 	}
 
 	return p;
@@ -166,6 +255,31 @@ size_t ringbuf_read(struct ringbuf *handle,
 	return bytes_read;
 }
 
+size_t ringbuf_readv(struct ringbuf *handle, const size_t offset,
+		const struct ringbuf_iovec *iov, const size_t iovcnt)
+{
+	size_t outdex;
+	const size_t length = load_consumer_view(handle, &outdex);
+	size_t total = 0;
+
+	if (offset >= length) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < iovcnt && offset + total < length; i++) {
+		const size_t len = MIN(length - offset - total, iov[i].len);
+		copy_out(handle, outdex + offset + total, iov[i].base, len);
+		total += len;
+	}
+
+	if (total > 0) {
+		libmcu_atomic_store_release(&handle->outdex,
+				outdex + offset + total);
+	}
+
+	return total;
+}
+
 size_t ringbuf_length(const struct ringbuf *handle)
 {
 	return get_length(handle);
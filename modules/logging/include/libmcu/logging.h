@@ -13,8 +13,10 @@ extern "C" {
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include "libmcu/logging_backend.h"
 #include "libmcu/compiler.h"
+#include "libmcu/atomic.h"
 
 #if !defined(LOGGING_MESSAGE_MAXLEN)
 /** Message itself only. `logging_data_t` type size overhead should also take
@@ -22,8 +24,27 @@ extern "C" {
 #define LOGGING_MESSAGE_MAXLEN			80
 #endif
 #if !defined(LOGGING_TAGS_MAXNUM)
+/** Tags registered by logging_write() or logging_set_level_tag() directly.
+ * Tags used at call sites through @ref LOGGING_WRAPPER bring their own
+ * storage and do not count. */
 #define LOGGING_TAGS_MAXNUM			8
 #endif
+#if !defined(LOGGING_ASYNC_REORDER_WINDOW)
+/** The number of queued logs looked ahead to deliver them in order of
+ * timestamp in async mode */
+#define LOGGING_ASYNC_REORDER_WINDOW		8
+#endif
+#if !defined(LOGGING_BATCH_BUFSIZE)
+/** Buffer for the logs handed over to backends at once by logging_drain().
+ * It must hold a log of @ref LOGGING_MESSAGE_MAXLEN at least. */
+#define LOGGING_BATCH_BUFSIZE			256
+#endif
+#if !defined(LOGGING_COMPILE_MIN_LEVEL)
+/** Logs below this level are removed at compile time along with their
+ * arguments: 0 for debug, 1 for info, 2 for warn, 3 for error and 4 to
+ * remove all. It must be a number as it is evaluated by the preprocessor. */
+#define LOGGING_COMPILE_MIN_LEVEL		0
+#endif
 #if !defined(LOGGING_TAG)
 #define FILENAME_TAG				\
 	(__builtin_strrchr(__FILE__, '/')?	\
@@ -46,10 +67,35 @@ enum logging_type {
 };
 typedef uint8_t logging_t;
 
+struct logging_tag {
+	const char *tag;
+	struct logging_tag *next;
+	logging_t min_log_level;
+	/** the higher of @ref min_log_level and the global level */
+	logging_t threshold;
+};
+
+/**
+ * @brief Tag cache of a call site
+ *
+ * @ref LOGGING_WRAPPER defines one at each call site so that the tag gets
+ * looked up only once and a log filtered out costs no more than a load and
+ * a compare. The first call site of a tag lends @ref storage to the tag.
+ *
+ * @note The tag of a call site must not change.
+ */
+struct logging_site {
+	struct logging_tag *tag;
+	struct logging_site *next;
+	struct logging_tag storage;
+};
+
 struct logging_context {
 	const char *tag;
 	const void *pc;
 	const void *lr;
+	/** NULL to look up @ref tag every time */
+	struct logging_site *site;
 };
 
 typedef uint32_t (*logging_time_func_t)(void);
@@ -58,26 +104,84 @@ typedef uint32_t (*logging_time_func_t)(void);
 #define get_program_counter()		libmcu_get_pc()
 #endif
 
-#define LOGGING_WRAPPER(type, ...) do { 		\
-	const struct logging_context _logctx = {	\
-		.tag = LOGGING_TAG,			\
-		.pc = get_program_counter(),		\
-		.lr = __builtin_return_address(0),	\
-	};						\
-	logging_write(type, &_logctx, __VA_ARGS__);	\
+#define LOGGING_WRAPPER(type, ...) do { 				\
+	static struct logging_site _logsite;				\
+	if (logging_is_site_enabled(&_logsite, LOGGING_TAG, type)) {	\
+		const struct logging_context _logctx = {		\
+			.tag = LOGGING_TAG,				\
+			.pc = get_program_counter(),			\
+			.lr = __builtin_return_address(0),		\
+			.site = &_logsite,				\
+		};							\
+		logging_write(type, &_logctx, __VA_ARGS__);		\
+	}								\
+} while (0)
+
+/* Keeps the arguments referenced, so that no unused warnings are raised,
+ * while neither evaluated nor compiled in. */
+#define LOGGING_DISCARD(type, ...) do {					\
+	if (0) {							\
+		logging_write(type, NULL, __VA_ARGS__);			\
+	}								\
 } while (0)
 
+#if LOGGING_COMPILE_MIN_LEVEL <= 0
 #define debug(...) \
 	LOGGING_WRAPPER(LOGGING_TYPE_DEBUG, __VA_ARGS__)
+#else
+#define debug(...) \
+	LOGGING_DISCARD(LOGGING_TYPE_DEBUG, __VA_ARGS__)
+#endif
+#if LOGGING_COMPILE_MIN_LEVEL <= 1
 #define info(...) \
 	LOGGING_WRAPPER(LOGGING_TYPE_INFO, __VA_ARGS__)
+#else
+#define info(...) \
+	LOGGING_DISCARD(LOGGING_TYPE_INFO, __VA_ARGS__)
+#endif
+#if LOGGING_COMPILE_MIN_LEVEL <= 2
 #define warn(...) \
 	LOGGING_WRAPPER(LOGGING_TYPE_WARN, __VA_ARGS__)
+#else
+#define warn(...) \
+	LOGGING_DISCARD(LOGGING_TYPE_WARN, __VA_ARGS__)
+#endif
+#if LOGGING_COMPILE_MIN_LEVEL <= 3
 #define error(...) \
 	LOGGING_WRAPPER(LOGGING_TYPE_ERROR, __VA_ARGS__)
+#else
+#define error(...) \
+	LOGGING_DISCARD(LOGGING_TYPE_ERROR, __VA_ARGS__)
+#endif
 
 void logging_init(logging_time_func_t time_func);
 
+/**
+ * @brief Resolve the tag of a call site, registering it if not found
+ *
+ * @note Called by logging_is_site_enabled() only once per call site.
+ *
+ * @param site call site to resolve
+ * @param tag tag of the call site
+ *
+ * @return the tag
+ */
+struct logging_tag *logging_resolve_site(struct logging_site *site,
+		const char *tag);
+
+static inline LIBMCU_ALWAYS_INLINE bool logging_is_site_enabled(
+		struct logging_site *site, const char *tag, logging_t type)
+{
+	const struct logging_tag *p = libmcu_atomic_load_ptr_acquire(
+			&site->tag, const struct logging_tag *);
+
+	if (p == NULL) {
+		p = logging_resolve_site(site, tag);
+	}
+
+	return type >= libmcu_atomic_load_relaxed(&p->threshold);
+}
+
 int logging_add_backend(const struct logging_backend *backend);
 int logging_remove_backend(const struct logging_backend *backend);
 
@@ -93,8 +197,134 @@ size_t logging_consume(const struct logging_backend *backend,
 		size_t consume_size);
 size_t logging_count(const struct logging_backend *backend);
 
+/**
+ * @brief Open a read cursor of its own on a storage backend
+ *
+ * Many readers can take logs out of the same storage independently, each
+ * through its own cursor, with no copy of the storage for each. A log is
+ * removed only after all cursors have moved past it, unless the backend is
+ * set to drop the oldest logs when full, in which case the logs a cursor
+ * missed are counted in `missed` of the cursor.
+ *
+ * @param[in] backend backend to read from. NULL for the first backend
+ * @param[out] cursor cursor to open, to be kept until closed
+ * @param[in] name name of the reader, unique per backend
+ *
+ * @return 0 on success, -ENOTSUP if @p backend has no cursor support,
+ *         -EEXIST if @p name is already in use
+ */
+int logging_open_cursor(const struct logging_backend *backend,
+		struct logging_cursor *cursor, const char *name);
+void logging_close_cursor(const struct logging_backend *backend,
+		struct logging_cursor *cursor);
+size_t logging_peek_cursor(const struct logging_backend *backend,
+		struct logging_cursor *cursor, void *buf, size_t bufsize);
+size_t logging_read_cursor(const struct logging_backend *backend,
+		struct logging_cursor *cursor, void *buf, size_t bufsize);
+size_t logging_consume_cursor(const struct logging_backend *backend,
+		struct logging_cursor *cursor);
+size_t logging_count_cursor(const struct logging_backend *backend,
+		const struct logging_cursor *cursor);
+
 size_t logging_stringify(char *buf, size_t bufsize, const void *log);
 
+/** Fields of a log. See logging_unpack() and logging_pack() */
+struct logging_entry {
+	unsigned long timestamp;
+	uintptr_t pc;
+	uintptr_t lr;
+	const struct logging_tag *tag;
+	const void *message;
+	uint16_t message_length;
+	/** @ref logging_t along with the flag marking a log in dictionary
+	 * mode, to be kept as it is */
+	uint8_t type;
+};
+
+/**
+ * @brief Break a log down into its fields
+ *
+ * This is for backends storing logs in their own format, e.g. compressed.
+ *
+ * @param[in] log a log as given to backends
+ * @param[in] size size of @p log
+ * @param[out] entry fields of the log. The message points into @p log
+ *
+ * @return 0 on success, -EINVAL if @p log is not a valid log
+ */
+int logging_unpack(const void *log, size_t size, struct logging_entry *entry);
+/**
+ * @brief Build a log from its fields, the reverse of logging_unpack()
+ *
+ * @param[out] buf buffer to build the log in
+ * @param[in] bufsize size of @p buf
+ * @param[in] entry fields of the log
+ *
+ * @return the size of the log built, 0 if @p bufsize is not enough
+ */
+size_t logging_pack(void *buf, size_t bufsize,
+		const struct logging_entry *entry);
+
+/**
+ * @brief Switch logging_write() to async mode
+ *
+ * In async mode, logging_write() only captures the timestamp, the format
+ * string pointer and the raw arguments into @p buf and returns. Formatting
+ * and writing to backends are deferred to logging_drain(), which is
+ * typically called by a dedicated thread woken up by
+ * logging_async_notify().
+ *
+ * @note No lock is taken on the way. Each caller packs the arguments on its
+ *       own stack and claims a slot in @p buf atomically. The logs are then
+ *       delivered in order of timestamp and sequence number, looking ahead
+ *       @ref LOGGING_ASYNC_REORDER_WINDOW logs.
+ * @note The format string must outlive the queued log, which is the case for
+ *       string literals. The arguments are copied, all together up to
+ *       @ref LOGGING_MESSAGE_MAXLEN bytes, a `%s` taking its length plus a
+ *       byte and getting truncated to what is left after the arguments
+ *       before it.
+ * @note Logs that do not fit in @p buf are dropped and counted, see
+ *       logging_count_dropped().
+ * @note logging_write_with_backend() always writes synchronously.
+ *
+ * @param buf memory for the queue. NULL to get back to sync mode, in which
+ *        case any logs left should be drained beforehand
+ * @param bufsize size of @p buf. Rounded down to a power of 2
+ *
+ * @return 0 on success, -EINVAL if @p bufsize is too small
+ */
+int logging_set_async(void *buf, size_t bufsize);
+/**
+ * @brief Format queued logs and write them to backends
+ *
+ * @note Only one context may call this at a time.
+ *
+ * @param max_records maximum number of logs to process. 0 for all
+ *
+ * @return the number of logs processed
+ */
+size_t logging_drain(size_t max_records);
+size_t logging_count_dropped(void);
+
+/**
+ * @brief Store the format string address and raw arguments instead of text
+ *
+ * In dictionary mode, a log message holds the address of its format string
+ * followed by the arguments as they are, so that no formatting happens on
+ * the device and logs get much smaller. The text is recovered on the host by
+ * looking up the format string in the ELF image, e.g. with
+ * tools/scripts/translate_log.py, or on the device with logging_stringify().
+ *
+ * @note Integers, floating points and pointers take their native sizes while
+ *       `%s` arguments are copied with a length byte ahead. All arguments
+ *       together take up to @ref LOGGING_MESSAGE_MAXLEN bytes, so a string
+ *       gets truncated to what is left after the arguments before it.
+ * @note Logs written before switching keep their own encoding.
+ *
+ * @param enable true to store logs in dictionary mode, false for text
+ */
+void logging_set_dictionary(bool enable);
+
 /**
  * @brief Change the minimum log level to be saved for the tag
  *
@@ -17,7 +17,26 @@ extern "C" {
 #define LOGGING_MAX_BACKENDS			1
 #endif
 
+struct logging_record {
+	const void *data;
+	size_t size;
+};
+
+/** A read position of its own into a storage shared by many readers. Owned
+ * by the reader, only to be touched by the backend. */
+struct logging_cursor {
+	const char *name;
+	/** Storage specific position of the next log to read */
+	size_t pos;
+	/** Sequence number of the next log to read */
+	size_t seq;
+	/** The number of logs dropped before being read */
+	size_t missed;
+	struct logging_cursor *next;
+};
+
 struct logging_backend {
+	/** Write a log. Optional when `write_batch` is given */
 	size_t (*write)(const void *data, size_t size);
 	size_t (*peek)(void *buf, size_t bufsize);
 	/** Read up to `bufsize` bytes from the storage
@@ -28,6 +47,25 @@ struct logging_backend {
 	 * @return The number of bytes removed. */
 	size_t (*consume)(size_t size);
 	size_t (*count)(void);
+	/** Write `n` logs at once. Optional, `write` is called for each log
+	 * when not given
+	 * @return The number of logs written from the first. */
+	size_t (*write_batch)(const struct logging_record *logs, size_t n);
+	/** Push out the logs written so far. Optional, called after every
+	 * log in sync mode and after every batch in async mode */
+	void (*flush)(void);
+	/** Start reading from the oldest log with a cursor of its own.
+	 * Optional, the cursor operations below are given along with it.
+	 * Logs are kept until every open cursor has consumed them
+	 * @return 0 on success, negative error code otherwise */
+	int (*open_cursor)(struct logging_cursor *cursor);
+	void (*close_cursor)(struct logging_cursor *cursor);
+	size_t (*peek_cursor)(struct logging_cursor *cursor,
+			void *buf, size_t bufsize);
+	/** Move the cursor past the next log
+	 * @return The number of bytes of the log moved past. */
+	size_t (*consume_cursor)(struct logging_cursor *cursor);
+	size_t (*count_cursor)(const struct logging_cursor *cursor);
 };
 
 #if defined(__cplusplus)
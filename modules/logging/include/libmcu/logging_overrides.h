@@ -14,6 +14,13 @@ extern "C" {
 void logging_lock_init(void);
 void logging_lock(void);
 void logging_unlock(void);
+/**
+ * @brief Called whenever a log gets queued in async mode.
+ *
+ * Implement this to wake up the thread that calls logging_drain(). It is
+ * called outside of logging_lock().
+ */
+void logging_async_notify(void);
 
 #if defined(__cplusplus)
 }
@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_LOGGING_RATELIM_H
+#define LIBMCU_LOGGING_RATELIM_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "libmcu/logging.h"
+#include "libmcu/ratelim.h"
+
+#if !defined(LOGGING_RATELIM_BURST)
+/** The number of logs let through at once from a call site */
+#define LOGGING_RATELIM_BURST			10
+#endif
+#if !defined(LOGGING_RATELIM_PER_MINUTE)
+/** The number of logs let through per minute from a call site once the
+ * burst is used up */
+#define LOGGING_RATELIM_PER_MINUTE		6
+#endif
+
+/**
+ * @brief Rate limiting state of a call site
+ *
+ * @ref LOGGING_RATELIMITED defines one at each call site along with the
+ * tag cache of the site.
+ */
+struct logging_ratelim {
+	struct logging_site site;
+	struct ratelim bucket;
+	/** The number of logs suppressed since the last one let through */
+	uint32_t suppressed;
+	/** Non-zero while the bucket is accessed */
+	unsigned int busy;
+	bool initialized;
+};
+
+/**
+ * @brief Log through a token bucket of the call site
+ *
+ * Logs over @ref LOGGING_RATELIM_BURST at once, or over
+ * @ref LOGGING_RATELIM_PER_MINUTE afterwards, are suppressed before being
+ * formatted. The logs suppressed are collapsed into a single
+ * "last message repeated N times" log, written right before the next log
+ * let through from the same call site.
+ *
+ * @param type one of @ref logging_t
+ */
+#define LOGGING_RATELIMITED(type, ...) do {				\
+	static struct logging_ratelim _lograte;				\
+	if (logging_is_site_enabled(&_lograte.site, LOGGING_TAG, type)) { \
+		const struct logging_context _logctx = {		\
+			.tag = LOGGING_TAG,				\
+			.pc = get_program_counter(),			\
+			.lr = __builtin_return_address(0),		\
+			.site = &_lograte.site,				\
+		};							\
+		if (logging_ratelim_request(&_lograte, type, &_logctx)) { \
+			logging_write(type, &_logctx, __VA_ARGS__);	\
+		}							\
+	}								\
+} while (0)
+
+/**
+ * @brief Take a token from the bucket of a call site
+ *
+ * Writes the number of logs suppressed so far, if any, when a token is
+ * taken.
+ *
+ * @note It takes no lock but the bucket of the call site. A log arriving
+ *       while the bucket is held by another one of the same call site is
+ *       counted as suppressed.
+ *
+ * @param ratelim rate limiting state of the call site
+ * @param type log level of the call site
+ * @param ctx logging context of the call site
+ *
+ * @return true if the log is let through, false if suppressed
+ */
+bool logging_ratelim_request(struct logging_ratelim *ratelim, logging_t type,
+		const struct logging_context *ctx);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_LOGGING_RATELIM_H */
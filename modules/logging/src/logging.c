@@ -18,20 +18,20 @@
 
 #include "libmcu/compiler.h"
 #include "libmcu/assert.h"
+#include "libmcu/atomic.h"
 
 #if !defined(MIN)
 #define MIN(a, b)				((a) > (b)? (b) : (a))
 #endif
 
 #define LOGGING_MAGIC				0xA5A5U
+/* Set in the type field of a log whose message holds the format string
+ * address followed by the arguments packed by pack_args() instead of the
+ * rendered text */
+#define LOGGING_DICTIONARY_FLAG			0x80U
 
 typedef uint16_t logging_magic_t;
 
-struct logging_tag {
-	const char *tag;
-	logging_t min_log_level;
-};
-
 typedef struct {
 	unsigned long timestamp;
 	uintptr_t pc;
@@ -46,22 +46,99 @@ static_assert(sizeof(logging_t) == sizeof(uint8_t),
 		"The size of logging_t must be the same of uint8_t.");
 static_assert(LOGGING_TYPE_MAX <= (1U << (sizeof(logging_t) * 8)) - 1,
 		"TYPE_MAX must not exceed its data type size.");
+static_assert(LOGGING_TYPE_DEBUG == 0 && LOGGING_TYPE_INFO == 1 &&
+		LOGGING_TYPE_WARN == 2 && LOGGING_TYPE_ERROR == 3 &&
+		LOGGING_TYPE_NONE == 4,
+		"LOGGING_COMPILE_MIN_LEVEL relies on the values of the types.");
+static_assert(LOGGING_TYPE_MAX < LOGGING_DICTIONARY_FLAG,
+		"TYPE_MAX must not overlap the dictionary flag.");
+static_assert(LOGGING_BATCH_BUFSIZE
+		>= sizeof(logging_data_t) + LOGGING_MESSAGE_MAXLEN,
+		"BATCH_BUFSIZE must hold a log of MESSAGE_MAXLEN.");
+static_assert(LOGGING_MESSAGE_MAXLEN > sizeof(uintptr_t),
+		"MESSAGE_MAXLEN must hold a format string address.");
 static_assert(LOGGING_MESSAGE_MAXLEN
 		< (1U << (sizeof(((logging_data_t *)0)->message_length) * 8)),
 		"MESSAGE_MAXLEN must not exceed its data type size.");
 
+/* Argument types as passed through varargs after default promotion */
+enum arg_type {
+	ARG_NONE,
+	ARG_INT,
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_INTMAX,
+	ARG_SIZE,
+	ARG_PTRDIFF,
+	ARG_DOUBLE,
+	ARG_LDOUBLE,
+	ARG_PTR,
+	ARG_STR,
+	ARG_WRITEBACK, /* %n. consumed but never written back */
+};
+
+struct fmt_spec {
+	const char *start;
+	size_t len;
+	uint8_t nr_stars; /* '*' width and precision taking int arguments */
+	enum arg_type type;
+};
+
+/* A record queued in async mode. The message is kept as its format string
+ * followed by the arguments packed by pack_args() and rendered later when
+ * drained. */
+struct async_record {
+	unsigned long timestamp;
+	uintptr_t pc;
+	uintptr_t lr;
+	const struct logging_tag *tag;
+	const char *fmt;
+	uint32_t seq;
+	uint16_t argsize;
+	logging_t type;
+};
+
+/* Each slot in the async queue starts with a word holding its size and the
+ * state below. The word stays zero until the producer publishes the slot,
+ * which is why the drain clears slots when releasing them. */
+#define SLOT_COMMITTED				(1U << 31)
+#define SLOT_PADDING				(1U << 30)
+#define SLOT_DONE				(1U << 29)
+#define SLOT_SIZE_MASK				(SLOT_DONE - 1)
+#define SLOT_HEADER_SIZE			sizeof(uint32_t)
+#define SLOT_SIZE(argsize)			\
+	((uint32_t)(SLOT_HEADER_SIZE + sizeof(struct async_record) + (argsize) \
+		+ SLOT_HEADER_SIZE - 1) & ~(uint32_t)(SLOT_HEADER_SIZE - 1))
+
 static struct {
-	struct logging_tag tags[LOGGING_TAGS_MAXNUM];
+	/* in order of registration. Linked from the pool below or from
+	 * the call sites */
+	struct logging_tag *tags;
+	struct logging_site *sites;
+	/* for tags registered not from call sites, e.g. by
+	 * logging_set_level_tag() before the first log */
+	struct logging_tag pool[LOGGING_TAGS_MAXNUM];
 	struct logging_tag global_tag;
 
 	const struct logging_backend *backends[LOGGING_MAX_BACKENDS];
 
 	logging_time_func_t time;
+	bool dictionary;
+
+	struct {
+		uint8_t *buf;
+		uint32_t capacity;
+		uint32_t head; /* reserved by producers */
+		uint32_t tail; /* released by the drain */
+		uint32_t seq;
+		size_t dropped;
+		bool enabled;
+	} async;
 } m;
 
 static const char *stringify_type(logging_t type)
 {
-	switch (type) {
+	switch (type & ~LOGGING_DICTIONARY_FLAG) {
 	case LOGGING_TYPE_DEBUG:
 		return "DEBUG";
 	case LOGGING_TYPE_INFO:
@@ -95,10 +172,14 @@ static struct logging_tag *get_global_tag(void)
 
 static void clear_tags(void)
 {
-	for (int i = 0; i < LOGGING_TAGS_MAXNUM; i++) {
-		memset(&m.tags[i], 0, sizeof(m.tags[i]));
+	for (struct logging_site *site = m.sites; site; site = site->next) {
+		site->tag = NULL;
 	}
 
+	m.tags = NULL;
+	m.sites = NULL;
+
+	memset(m.pool, 0, sizeof(m.pool));
 	memset(get_global_tag(), 0, sizeof(*get_global_tag()));
 }
 
@@ -112,7 +193,7 @@ static void clear_backends(void)
 static struct logging_tag *get_empty_tag_slot(void)
 {
 	for (int i = 0; i < LOGGING_TAGS_MAXNUM; i++) {
-		struct logging_tag *p = &m.tags[i];
+		struct logging_tag *p = &m.pool[i];
 		if (p->tag == NULL) {
 			return p;
 		}
@@ -121,10 +202,14 @@ static struct logging_tag *get_empty_tag_slot(void)
 	return NULL;
 }
 
+/* Safe to call without the lock as tags get only appended, being published
+ * with a release store. */
 static struct logging_tag *get_tag_from_string(const char *tag)
 {
-	for (int i = 0; i < LOGGING_TAGS_MAXNUM; i++) {
-		struct logging_tag *p = &m.tags[i];
+	for (struct logging_tag *p = libmcu_atomic_load_ptr_acquire(&m.tags,
+				struct logging_tag *);
+			p; p = libmcu_atomic_load_ptr_acquire(&p->next,
+				struct logging_tag *)) {
 		if (p->tag == tag) {
 			return p;
 		}
@@ -133,6 +218,32 @@ static struct logging_tag *get_tag_from_string(const char *tag)
 	return NULL;
 }
 
+static void update_threshold(struct logging_tag *p)
+{
+	const logging_t global = get_global_tag()->min_log_level;
+
+	libmcu_atomic_store_relaxed(&p->threshold,
+			p->min_log_level > global? p->min_log_level : global);
+}
+
+static void link_tag(struct logging_tag *p, const char *tag)
+{
+	struct logging_tag **pp = &m.tags;
+
+	*p = (struct logging_tag) {
+		.tag = tag,
+		.next = NULL,
+		.min_log_level = LOGGING_TYPE_DEBUG,
+	};
+	update_threshold(p);
+
+	while (*pp) {
+		pp = &(*pp)->next;
+	}
+
+	libmcu_atomic_store_ptr_release(pp, p);
+}
+
 static struct logging_tag *register_tag(const char *tag)
 {
 	struct logging_tag *p = get_empty_tag_slot();
@@ -141,7 +252,7 @@ static struct logging_tag *register_tag(const char *tag)
 		return get_global_tag();
 	}
 
-	p->tag = tag;
+	link_tag(p, tag);
 	return p;
 }
 
@@ -156,17 +267,33 @@ static struct logging_tag *obtain_tag(const char *tag)
 	return p;
 }
 
-static bool is_logging_type_enabled(const struct logging_tag *tag,
-		const logging_t type)
+/* The level is checked without the lock. Only the first log with a new tag
+ * takes it to register the tag. */
+static const struct logging_tag *get_tag(const struct logging_context *ctx)
 {
-	if (!is_global_tag(tag) && type < get_global_tag()->min_log_level) {
-		return false;
+	const struct logging_tag *p;
+
+	if (ctx->site) {
+		if ((p = libmcu_atomic_load_ptr_acquire(&ctx->site->tag,
+				const struct logging_tag *)) == NULL) {
+			p = logging_resolve_site(ctx->site, ctx->tag);
+		}
+		return p;
 	}
-	if (type < tag->min_log_level) {
-		return false;
+
+	if ((p = get_tag_from_string(ctx->tag)) == NULL) {
+		logging_lock();
+		p = obtain_tag(ctx->tag);
+		logging_unlock();
 	}
 
-	return true;
+	return p;
+}
+
+static bool is_logging_type_enabled(const struct logging_tag *tag,
+		const logging_t type)
+{
+	return type >= libmcu_atomic_load_relaxed(&tag->threshold);
 }
 
 static bool is_logging_type_valid(const logging_t type)
@@ -207,13 +334,386 @@ static size_t peek_internal(const struct logging_backend *backend,
 	return backend->peek(buf, bufsize);
 }
 
+static const char *parse_spec(const char *p, struct fmt_spec *spec)
+{
+	unsigned int longs = 0;
+
+	*spec = (struct fmt_spec) {
+		.start = p++,
+		.type = ARG_NONE,
+	};
+
+	while (*p && strchr("-+ #0", *p)) {
+		p++;
+	}
+	if (*p == '*') {
+		spec->nr_stars++;
+		p++;
+	}
+	while (*p >= '0' && *p <= '9') {
+		p++;
+	}
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->nr_stars++;
+			p++;
+		}
+		while (*p >= '0' && *p <= '9') {
+			p++;
+		}
+	}
+
+	enum arg_type modified = ARG_INT;
+
+	for (bool done = false; *p && !done; ) {
+		switch (*p) {
+		case 'h':
+			p++;
+			break;
+		case 'l':
+			longs++;
+			modified = longs > 1? ARG_LLONG : ARG_LONG;
+			p++;
+			break;
+		case 'j':
+			modified = ARG_INTMAX;
+			p++;
+			break;
+		case 'z':
+			modified = ARG_SIZE;
+			p++;
+			break;
+		case 't':
+			modified = ARG_PTRDIFF;
+			p++;
+			break;
+		case 'L':
+			modified = ARG_LDOUBLE;
+			p++;
+			break;
+		default:
+			done = true;
+			break;
+		}
+	}
+
+	switch (*p) {
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+		spec->type = modified == ARG_LDOUBLE? ARG_INT : modified;
+		break;
+	case 'c':
+		spec->type = ARG_INT;
+		break;
+	case 'f': case 'F': case 'e': case 'E':
+	case 'g': case 'G': case 'a': case 'A':
+		spec->type = modified == ARG_LDOUBLE? ARG_LDOUBLE : ARG_DOUBLE;
+		break;
+	case 's':
+		spec->type = ARG_STR;
+		break;
+	case 'p':
+		spec->type = ARG_PTR;
+		break;
+	case 'n':
+		spec->type = ARG_WRITEBACK;
+		break;
+	case '\0':
+		spec->len = (size_t)(p - spec->start);
+		return p;
+	default: /* including '%' */
+		break;
+	}
+
+	spec->len = (size_t)(p - spec->start) + 1;
+
+	return p + 1;
+}
+
+static bool put_arg(uint8_t *buf, size_t bufsize, size_t *offset,
+		const void *value, size_t size)
+{
+	if (bufsize - *offset < size) {
+		return false;
+	}
+
+	memcpy(&buf[*offset], value, size);
+	*offset += size;
+
+	return true;
+}
+
+#define pack_typed_arg(type) do {					\
+	type _v = va_arg(ap, type);					\
+	ok = put_arg(buf, bufsize, &offset, &_v, sizeof(_v));		\
+} while (0)
+
+static bool put_str_arg(uint8_t *buf, size_t bufsize, size_t *offset,
+		const char *str)
+{
+	if (str == NULL) {
+		str = "(null)";
+	}
+
+	size_t len = MIN(strlen(str), UINT8_MAX);
+
+	if (bufsize - *offset <= len) {
+		if (bufsize - *offset <= 1) {
+			return false;
+		}
+		len = bufsize - *offset - 1; /* truncate to what fits */
+	}
+
+	buf[(*offset)++] = (uint8_t)len;
+	memcpy(&buf[*offset], str, len);
+	*offset += len;
+
+	return true;
+}
+
+/* Copies the arguments into a byte stream as they are, guided by the format
+ * string. Packing stops at the first argument that does not fit. */
+static size_t pack_args(uint8_t *buf, size_t bufsize,
+		const char *fmt, va_list ap)
+{
+	size_t offset = 0;
+	bool ok = true;
+
+	while (fmt && *fmt && ok) {
+		struct fmt_spec spec;
+
+		if (*fmt != '%') {
+			fmt++;
+			continue;
+		}
+
+		fmt = parse_spec(fmt, &spec);
+
+		for (uint8_t i = 0; i < spec.nr_stars && ok; i++) {
+			pack_typed_arg(int);
+		}
+		if (!ok) {
+			break;
+		}
+
+		switch (spec.type) {
+		case ARG_INT:
+			pack_typed_arg(int);
+			break;
+		case ARG_LONG:
+			pack_typed_arg(long);
+			break;
+		case ARG_LLONG:
+			pack_typed_arg(long long);
+			break;
+		case ARG_INTMAX:
+			pack_typed_arg(intmax_t);
+			break;
+		case ARG_SIZE:
+			pack_typed_arg(size_t);
+			break;
+		case ARG_PTRDIFF:
+			pack_typed_arg(ptrdiff_t);
+			break;
+		case ARG_DOUBLE:
+			pack_typed_arg(double);
+			break;
+		case ARG_LDOUBLE:
+			pack_typed_arg(long double);
+			break;
+		case ARG_PTR:
+			pack_typed_arg(void *);
+			break;
+		case ARG_STR:
+			ok = put_str_arg(buf, bufsize, &offset,
+					va_arg(ap, const char *));
+			break;
+		case ARG_WRITEBACK:
+			(void)va_arg(ap, void *);
+			break;
+		case ARG_NONE:
+		default:
+			break;
+		}
+	}
+
+	return offset;
+}
+
+static bool get_arg(const uint8_t *args, size_t argsize, size_t *offset,
+		void *value, size_t size)
+{
+	if (argsize - *offset < size) {
+		return false;
+	}
+
+	memcpy(value, &args[*offset], size);
+	*offset += size;
+
+	return true;
+}
+
+static bool get_str_arg(const uint8_t *args, size_t argsize, size_t *offset,
+		char str[UINT8_MAX + 1])
+{
+	uint8_t len;
+
+	if (!get_arg(args, argsize, offset, &len, sizeof(len)) ||
+			!get_arg(args, argsize, offset, str, len)) {
+		return false;
+	}
+
+	str[len] = '\0';
+
+	return true;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#define format_typed_arg(out, outsize, spec, stars, nr_stars, v) (	\
+	(nr_stars) == 0? snprintf(out, outsize, spec, v) :		\
+	(nr_stars) == 1? snprintf(out, outsize, spec, (stars)[0], v) :	\
+	snprintf(out, outsize, spec, (stars)[0], (stars)[1], v))
+
+#define render_typed_arg(type) do {					\
+	type _v;							\
+	if (!get_arg(args, argsize, &offset, &_v, sizeof(_v))) {	\
+		goto out;						\
+	}								\
+	n = format_typed_arg(&out[len], outsize - len,			\
+			specstr, stars, spec.nr_stars, _v);		\
+} while (0)
+
+/* Renders the format string with the arguments packed by pack_args().
+ * Rendering stops where the packed arguments run out. */
+static size_t render_args(char *out, size_t outsize, const char *fmt,
+		const uint8_t *args, size_t argsize)
+{
+	size_t offset = 0;
+	size_t len = 0;
+
+	if (outsize == 0) {
+		return 0;
+	}
+
+	while (fmt && *fmt && len < outsize - 1) {
+		struct fmt_spec spec;
+		char str[UINT8_MAX + 1];
+		char specstr[16];
+		int stars[2] = { 0, };
+		int n = 0;
+
+		if (*fmt != '%') {
+			out[len++] = *fmt++;
+			continue;
+		}
+
+		fmt = parse_spec(fmt, &spec);
+
+		if (spec.len >= sizeof(specstr)) {
+			break;
+		}
+
+		memcpy(specstr, spec.start, spec.len);
+		specstr[spec.len] = '\0';
+
+		for (uint8_t i = 0; i < spec.nr_stars; i++) {
+			if (!get_arg(args, argsize, &offset,
+					&stars[i], sizeof(stars[i]))) {
+				goto out;
+			}
+		}
+
+		switch (spec.type) {
+		case ARG_INT:
+			render_typed_arg(int);
+			break;
+		case ARG_LONG:
+			render_typed_arg(long);
+			break;
+		case ARG_LLONG:
+			render_typed_arg(long long);
+			break;
+		case ARG_INTMAX:
+			render_typed_arg(intmax_t);
+			break;
+		case ARG_SIZE:
+			render_typed_arg(size_t);
+			break;
+		case ARG_PTRDIFF:
+			render_typed_arg(ptrdiff_t);
+			break;
+		case ARG_DOUBLE:
+			render_typed_arg(double);
+			break;
+		case ARG_LDOUBLE:
+			render_typed_arg(long double);
+			break;
+		case ARG_PTR:
+			render_typed_arg(void *);
+			break;
+		case ARG_STR:
+			if (!get_str_arg(args, argsize, &offset, str)) {
+				goto out;
+			}
+			n = format_typed_arg(&out[len], outsize - len,
+					specstr, stars, spec.nr_stars, str);
+			break;
+		case ARG_WRITEBACK:
+			break;
+		case ARG_NONE:
+		default:
+			if (spec.len == 2 && spec.start[1] == '%') {
+				out[len++] = '%';
+			}
+			break;
+		}
+
+		if (n > 0) {
+			len += MIN((size_t)n, outsize - len - 1);
+		}
+	}
+out:
+	out[len] = '\0';
+	return len;
+}
+#pragma GCC diagnostic pop
+
+static size_t pack_dictionary(uint8_t *buf, size_t bufsize, const char *fmt,
+		const uint8_t *args, size_t argsize)
+{
+	const uintptr_t addr = (uintptr_t)fmt;
+
+	argsize = MIN(argsize, bufsize - sizeof(addr));
+
+	memcpy(buf, &addr, sizeof(addr));
+	memcpy(&buf[sizeof(addr)], args, argsize);
+
+	return sizeof(addr) + argsize;
+}
+
+static size_t pack_dictionary_va(uint8_t *buf, size_t bufsize,
+		const char *fmt, va_list ap)
+{
+	const uintptr_t addr = (uintptr_t)fmt;
+
+	memcpy(buf, &addr, sizeof(addr));
+
+	return sizeof(addr) + pack_args(&buf[sizeof(addr)],
+			bufsize - sizeof(addr), fmt, ap);
+}
+
 #define pack_message(ptr, basearg) do { \
 	va_list ap; \
 	const char *fmt; \
 	int len = 0; \
 	va_start(ap, basearg); \
 	fmt = va_arg(ap, char *); \
-	if (fmt) { \
+	if (m.dictionary) { \
+		len = (int)pack_dictionary_va(ptr->message, \
+				LOGGING_MESSAGE_MAXLEN, fmt, ap); \
+		ptr->type = (logging_t)(ptr->type | LOGGING_DICTIONARY_FLAG); \
+	} else if (fmt) { \
 		len = vsnprintf((char *)ptr->message, \
 				LOGGING_MESSAGE_MAXLEN - 1, \
 				fmt, ap); \
@@ -222,6 +722,32 @@ static size_t peek_internal(const struct logging_backend *backend,
 	ptr->message_length = MIN((uint16_t)len, LOGGING_MESSAGE_MAXLEN); \
 } while (0)
 
+/* Hands @p n logs over to the backend at once if it supports, one by one
+ * otherwise. Returns the number of bytes written. */
+static size_t write_logs(const struct logging_backend *backend,
+		const struct logging_record *logs, size_t n)
+{
+	size_t written = 0;
+
+	if (backend->write_batch) {
+		const size_t nr_written = backend->write_batch(logs, n);
+
+		for (size_t i = 0; i < nr_written && i < n; i++) {
+			written += logs[i].size;
+		}
+	} else {
+		for (size_t i = 0; i < n; i++) {
+			written += backend->write(logs[i].data, logs[i].size);
+		}
+	}
+
+	if (backend->flush) {
+		(*backend->flush)();
+	}
+
+	return written;
+}
+
 static void pack_log(logging_data_t *entry, logging_t type,
 		const void *pc, const void *lr)
 {
@@ -254,31 +780,135 @@ size_t logging_write_with_backend(logging_t type,
 		backend = m.backends[0];
 	}
 
-	logging_lock();
-
-	const struct logging_tag *tag = obtain_tag(ctx->tag);
+	const struct logging_tag *tag = get_tag(ctx);
 
-	if (!is_logging_type_valid(type)) {
-		goto out;
-	}
-	if (!is_logging_type_enabled(tag, type)) {
-		goto out;
+	if (!is_logging_type_valid(type) ||
+			!is_logging_type_enabled(tag, type)) {
+		return 0;
 	}
 
+	logging_lock();
+
 	logging_data_t *log = (logging_data_t *)buf;
 	pack_log(log, type, ctx->pc, ctx->lr);
 	pack_message(log, ctx);
 
 	if (backend) {
-		result = backend->write(log, get_log_length(log));
+		const struct logging_record rec = {
+			.data = log,
+			.size = get_log_length(log),
+		};
+		result = write_logs(backend, &rec, 1);
 	}
 
-out:
 	logging_unlock();
 
 	return result;
 }
 
+static size_t write_backends(const struct logging_record *logs, size_t n)
+{
+	size_t result = 0;
+
+	for (int i = 0; i < LOGGING_MAX_BACKENDS; i++) {
+		if (m.backends[i] && n) {
+			result = write_logs(m.backends[i], logs, n);
+		}
+	}
+
+	return result;
+}
+
+static uint32_t *get_slot(uint32_t pos)
+{
+	return (uint32_t *)(void *)
+		&m.async.buf[pos & (m.async.capacity - 1)];
+}
+
+static uint8_t *get_slot_data(uint32_t pos)
+{
+	return (uint8_t *)get_slot(pos) + SLOT_HEADER_SIZE;
+}
+
+/* Claims a contiguous slot of @p size bytes with no lock taken. @p pad is
+ * set to the size of the padding needed to skip the end of the buffer when
+ * the slot would otherwise wrap around. */
+static bool reserve_slot(uint32_t size, uint32_t *pos, uint32_t *pad)
+{
+	uint32_t head = libmcu_atomic_load_relaxed(&m.async.head);
+
+	do {
+		const uint32_t tail = libmcu_atomic_load_acquire(&m.async.tail);
+		const uint32_t offset = head & (m.async.capacity - 1);
+
+		*pad = offset + size > m.async.capacity?
+			m.async.capacity - offset : 0;
+
+		if (m.async.capacity - (head - tail) < *pad + size) {
+			return false;
+		}
+	} while (!libmcu_atomic_compare_exchange(&m.async.head,
+				&head, head + *pad + size));
+
+	*pos = head;
+
+	return true;
+}
+
+/* Packs the arguments on the caller's own stack first, which serves as a
+ * per-thread staging buffer, and then copies them into a slot claimed in
+ * the shared queue. No lock is taken. */
+static size_t queue_log(logging_t type, const struct logging_context *ctx,
+		const struct logging_tag *tag, const char *fmt, va_list ap)
+{
+	uint8_t args[LOGGING_MESSAGE_MAXLEN];
+	struct async_record rec = {
+		.timestamp = m.time? (*m.time)() : 0,
+		.seq = libmcu_atomic_fetch_add(&m.async.seq, 1),
+		.pc = (uintptr_t)ctx->pc,
+		.lr = (uintptr_t)ctx->lr,
+		.tag = tag,
+		.fmt = fmt,
+		.type = type,
+	};
+
+	rec.argsize = (uint16_t)pack_args(args, sizeof(args), fmt, ap);
+
+	const uint32_t size = SLOT_SIZE(rec.argsize);
+	uint32_t pos;
+	uint32_t pad;
+
+	if (!reserve_slot(size, &pos, &pad)) {
+		libmcu_atomic_fetch_add(&m.async.dropped, 1);
+		return 0;
+	}
+
+	if (pad) {
+		libmcu_atomic_store_release(get_slot(pos),
+				pad | SLOT_PADDING | SLOT_COMMITTED);
+		pos += pad;
+	}
+
+	memcpy(get_slot_data(pos), &rec, sizeof(rec));
+	memcpy(get_slot_data(pos) + sizeof(rec), args, rec.argsize);
+	libmcu_atomic_store_release(get_slot(pos), size | SLOT_COMMITTED);
+
+	return size;
+}
+
+static size_t write_async(logging_t type, const struct logging_context *ctx,
+		const struct logging_tag *tag, va_list ap)
+{
+	const char *fmt = va_arg(ap, const char *);
+	const size_t result = queue_log(type, ctx, tag, fmt, ap);
+
+	if (result) {
+		logging_async_notify();
+	}
+
+	return result;
+}
+
 size_t logging_write(logging_t type, const struct logging_context *ctx, ...)
 {
 	static uint8_t buf[LOGGING_MESSAGE_MAXLEN + sizeof(logging_data_t)];
@@ -286,32 +916,222 @@ size_t logging_write(logging_t type, const struct logging_context *ctx, ...)
 
 	assert(ctx != NULL);
 
-	logging_lock();
-
-	const struct logging_tag *tag = obtain_tag(ctx->tag);
+	const struct logging_tag *tag = get_tag(ctx);
 
-	if (!is_logging_type_valid(type)) {
-		goto out;
+	if (!is_logging_type_valid(type) ||
+			!is_logging_type_enabled(tag, type)) {
+		return 0;
 	}
-	if (!is_logging_type_enabled(tag, type)) {
-		goto out;
+
+	if (libmcu_atomic_load_acquire(&m.async.enabled)) {
+		va_list ap;
+		va_start(ap, ctx);
+		result = write_async(type, ctx, tag, ap);
+		va_end(ap);
+		return result;
 	}
 
+	logging_lock();
+
 	logging_data_t *log = (logging_data_t *)buf;
 	pack_log(log, type, ctx->pc, ctx->lr);
 	pack_message(log, ctx);
 	log->tag = tag;
 
-	for (int i = 0; i < LOGGING_MAX_BACKENDS; i++) {
-		if (m.backends[i]) {
-			result = m.backends[i]->write(log, get_log_length(log));
+	const struct logging_record rec = {
+		.data = log,
+		.size = get_log_length(log),
+	};
+	result = write_backends(&rec, 1);
+
+	logging_unlock();
+
+	return result;
+}
+
+static bool is_older(const struct async_record *a,
+		const struct async_record *b)
+{
+	if (a->timestamp != b->timestamp) {
+		return (int32_t)((uint32_t)a->timestamp
+				- (uint32_t)b->timestamp) < 0;
+	}
+	return (int32_t)(a->seq - b->seq) < 0;
+}
+
+/* Picks the oldest by timestamp and then by sequence number among the slots
+ * published in a row from the tail, up to LOGGING_ASYNC_REORDER_WINDOW, so
+ * that logs captured concurrently get delivered in order even when they
+ * claimed their slots in a different order. */
+static bool pick_oldest(uint32_t *oldest, struct async_record *rec)
+{
+	const uint32_t head = libmcu_atomic_load_acquire(&m.async.head);
+	uint32_t pos = libmcu_atomic_load_relaxed(&m.async.tail);
+	bool found = false;
+
+	for (unsigned int n = 0;
+			pos != head && n < LOGGING_ASYNC_REORDER_WINDOW; ) {
+		const uint32_t slot = libmcu_atomic_load_acquire(get_slot(pos));
+		struct async_record candidate;
+
+		if (!(slot & SLOT_COMMITTED)) {
+			break;
+		}
+
+		if (!(slot & (SLOT_PADDING | SLOT_DONE))) {
+			memcpy(&candidate, get_slot_data(pos), sizeof(candidate));
+			if (!found || is_older(&candidate, rec)) {
+				*rec = candidate;
+				*oldest = pos;
+				found = true;
+			}
+			n++;
 		}
+
+		pos += slot & SLOT_SIZE_MASK;
 	}
 
-out:
+	return found;
+}
+
+static void release_slots(void)
+{
+	const uint32_t head = libmcu_atomic_load_acquire(&m.async.head);
+	uint32_t tail = libmcu_atomic_load_relaxed(&m.async.tail);
+
+	while (tail != head) {
+		uint32_t *p = get_slot(tail);
+		const uint32_t slot = libmcu_atomic_load_acquire(p);
+
+		if (!(slot & SLOT_COMMITTED) ||
+				!(slot & (SLOT_PADDING | SLOT_DONE))) {
+			break;
+		}
+
+		memset(p, 0, slot & SLOT_SIZE_MASK);
+		tail += slot & SLOT_SIZE_MASK;
+	}
+
+	libmcu_atomic_store_release(&m.async.tail, tail);
+}
+
+/* Logs are rendered into a batch and handed over to backends at once when
+ * the batch gets full or when no more logs are left. */
+size_t logging_drain(size_t max_records)
+{
+	static uint8_t batch[LOGGING_BATCH_BUFSIZE];
+	static struct logging_record logs[LOGGING_BATCH_BUFSIZE
+		/ sizeof(logging_data_t)];
+	static uint8_t args[LOGGING_MESSAGE_MAXLEN];
+	struct async_record rec;
+	uint32_t pos;
+	size_t offset = 0;
+	size_t n = 0;
+	size_t count = 0;
+
+	while ((max_records == 0 || count < max_records) &&
+			pick_oldest(&pos, &rec)) {
+		uint32_t *slot = get_slot(pos);
+
+		memcpy(args, get_slot_data(pos) + sizeof(rec), rec.argsize);
+		libmcu_atomic_store_relaxed(slot, *slot | SLOT_DONE);
+		release_slots();
+
+		if (n >= sizeof(logs) / sizeof(*logs) || sizeof(batch) - offset
+				< sizeof(logging_data_t) + LOGGING_MESSAGE_MAXLEN) {
+			write_backends(logs, n);
+			offset = 0;
+			n = 0;
+		}
+
+		logging_data_t *log = (logging_data_t *)&batch[offset];
+
+		*log = (logging_data_t) {
+			.timestamp = rec.timestamp,
+			.type = rec.type,
+			.pc = rec.pc,
+			.lr = rec.lr,
+			.tag = rec.tag,
+		};
+		log->magic = compute_magic(log);
+
+		if (libmcu_atomic_load_relaxed(&m.dictionary)) {
+			log->type = (logging_t)(log->type
+					| LOGGING_DICTIONARY_FLAG);
+			log->message_length = (uint16_t)pack_dictionary(
+					log->message, LOGGING_MESSAGE_MAXLEN,
+					rec.fmt, args, rec.argsize);
+		} else {
+			log->message_length = (uint16_t)render_args(
+					(char *)log->message,
+					LOGGING_MESSAGE_MAXLEN - 1,
+					rec.fmt, args, rec.argsize);
+		}
+
+		logs[n] = (struct logging_record) {
+			.data = log,
+			.size = get_log_length(log),
+		};
+		offset += logs[n++].size;
+		count++;
+	}
+
+	write_backends(logs, n);
+
+	return count;
+}
+
+int logging_set_async(void *buf, size_t bufsize)
+{
+	const uintptr_t misalign = (uintptr_t)buf % SLOT_HEADER_SIZE;
+	uint32_t capacity;
+
+	if (buf == NULL) {
+		libmcu_atomic_store_release(&m.async.enabled, false);
+		return 0;
+	}
+
+	if (misalign) {
+		const size_t skip = SLOT_HEADER_SIZE - misalign;
+		buf = (uint8_t *)buf + skip;
+		bufsize = bufsize > skip? bufsize - skip : 0;
+	}
+
+	capacity = (uint32_t)MIN(bufsize, SLOT_DONE);
+	while (capacity & (capacity - 1)) { /* round down to a power of 2 */
+		capacity &= capacity - 1;
+	}
+
+	if (capacity < SLOT_SIZE(0)) {
+		return -EINVAL;
+	}
+
+	memset(buf, 0, capacity);
+
+	logging_lock();
+	{
+		m.async.buf = (uint8_t *)buf;
+		m.async.capacity = capacity;
+		m.async.head = 0;
+		m.async.tail = 0;
+		m.async.dropped = 0;
+		libmcu_atomic_store_release(&m.async.enabled, true);
+	}
 	logging_unlock();
 
-	return result;
+	return 0;
+}
+
+size_t logging_count_dropped(void)
+{
+	return libmcu_atomic_load_relaxed(&m.async.dropped);
+}
+
+void logging_set_dictionary(bool enable)
+{
+	logging_lock();
+	libmcu_atomic_store_relaxed(&m.dictionary, enable);
+	logging_unlock();
 }
 
 size_t logging_peek(const struct logging_backend *backend,
@@ -347,6 +1167,93 @@ size_t logging_read(const struct logging_backend *backend,
 	return backend->read(buf, bufsize);
 }
 
+static bool has_cursor_support(const struct logging_backend *backend)
+{
+	return backend != NULL && backend->open_cursor != NULL;
+}
+
+int logging_open_cursor(const struct logging_backend *backend,
+		struct logging_cursor *cursor, const char *name)
+{
+	if (backend == NULL) {
+		backend = m.backends[0];
+	}
+	if (cursor == NULL || name == NULL) {
+		return -EINVAL;
+	}
+	if (!has_cursor_support(backend)) {
+		return -ENOTSUP;
+	}
+
+	*cursor = (struct logging_cursor) {
+		.name = name,
+	};
+
+	return backend->open_cursor(cursor);
+}
+
+void logging_close_cursor(const struct logging_backend *backend,
+		struct logging_cursor *cursor)
+{
+	if (backend == NULL) {
+		backend = m.backends[0];
+	}
+	if (has_cursor_support(backend) && cursor != NULL) {
+		backend->close_cursor(cursor);
+	}
+}
+
+size_t logging_peek_cursor(const struct logging_backend *backend,
+		struct logging_cursor *cursor, void *buf, size_t bufsize)
+{
+	if (backend == NULL) {
+		backend = m.backends[0];
+	}
+	if (!has_cursor_support(backend) || cursor == NULL) {
+		return 0;
+	}
+
+	return backend->peek_cursor(cursor, buf, bufsize);
+}
+
+size_t logging_consume_cursor(const struct logging_backend *backend,
+		struct logging_cursor *cursor)
+{
+	if (backend == NULL) {
+		backend = m.backends[0];
+	}
+	if (!has_cursor_support(backend) || cursor == NULL) {
+		return 0;
+	}
+
+	return backend->consume_cursor(cursor);
+}
+
+size_t logging_read_cursor(const struct logging_backend *backend,
+		struct logging_cursor *cursor, void *buf, size_t bufsize)
+{
+	const size_t size = logging_peek_cursor(backend, cursor, buf, bufsize);
+
+	if (size > 0) {
+		logging_consume_cursor(backend, cursor);
+	}
+
+	return size;
+}
+
+size_t logging_count_cursor(const struct logging_backend *backend,
+		const struct logging_cursor *cursor)
+{
+	if (backend == NULL) {
+		backend = m.backends[0];
+	}
+	if (!has_cursor_support(backend) || cursor == NULL) {
+		return 0;
+	}
+
+	return backend->count_cursor(cursor);
+}
+
 void logging_init(logging_time_func_t time_func)
 {
 	logging_lock_init();
@@ -355,11 +1262,15 @@ void logging_init(logging_time_func_t time_func)
 	clear_backends();
 
 	m.time = time_func;
+	m.dictionary = false;
+	m.async.enabled = false;
+	m.async.dropped = 0;
 }
 
 int logging_add_backend(const struct logging_backend *backend)
 {
-	if (backend == NULL || backend->write == NULL) {
+	if (backend == NULL ||
+			(backend->write == NULL && backend->write_batch == NULL)) {
 		return -EINVAL;
 	}
 
@@ -423,11 +1334,35 @@ void logging_set_level_tag(const char *tag, logging_t min_log_level)
 
 		if (min_log_level < LOGGING_TYPE_MAX && !is_global_tag(p)) {
 			p->min_log_level = min_log_level;
+			update_threshold(p);
 		}
 	}
 	logging_unlock();
 }
 
+struct logging_tag *logging_resolve_site(struct logging_site *site,
+		const char *tag)
+{
+	struct logging_tag *p;
+
+	logging_lock();
+	{
+		if ((p = site->tag) == NULL) {
+			if ((p = get_tag_from_string(tag)) == NULL) {
+				p = &site->storage;
+				link_tag(p, tag);
+			}
+
+			site->next = m.sites;
+			m.sites = site;
+			libmcu_atomic_store_ptr_release(&site->tag, p);
+		}
+	}
+	logging_unlock();
+
+	return p;
+}
+
 logging_t logging_get_level_tag(const char *tag)
 {
 	logging_t result;
@@ -443,14 +1378,28 @@ logging_t logging_get_level_tag(const char *tag)
 
 void logging_set_level_global(logging_t min_log_level)
 {
-	if (min_log_level < LOGGING_TYPE_MAX) {
-		get_global_tag()->min_log_level = min_log_level;
+	if (min_log_level >= LOGGING_TYPE_MAX) {
+		return;
+	}
+
+	logging_lock();
+	{
+		struct logging_tag *global = get_global_tag();
+
+		libmcu_atomic_store_relaxed(&global->min_log_level,
+				min_log_level);
+		libmcu_atomic_store_relaxed(&global->threshold, min_log_level);
+
+		for (struct logging_tag *p = m.tags; p; p = p->next) {
+			update_threshold(p);
+		}
 	}
+	logging_unlock();
 }
 
 logging_t logging_get_level_global(void)
 {
-	return get_global_tag()->min_log_level;
+	return libmcu_atomic_load_relaxed(&get_global_tag()->min_log_level);
 }
 
 size_t logging_count_tags(void)
@@ -459,10 +1408,8 @@ size_t logging_count_tags(void)
 
 	logging_lock();
 	{
-		for (int i = 0; i < LOGGING_TAGS_MAXNUM; i++) {
-			if (m.tags[cnt].tag != NULL) {
-				cnt++;
-			}
+		for (const struct logging_tag *p = m.tags; p; p = p->next) {
+			cnt++;
 		}
 	}
 	logging_unlock();
@@ -477,11 +1424,7 @@ void logging_iterate_tag(void (*callback_each)(const char *tag,
 
 	logging_lock();
 	{
-		for (int i = 0; i < LOGGING_TAGS_MAXNUM; i++) {
-			const struct logging_tag *p = &m.tags[i];
-			if (p->tag == NULL) {
-				continue;
-			}
+		for (const struct logging_tag *p = m.tags; p; p = p->next) {
 			callback_each(p->tag, p->min_log_level);
 		}
 	}
@@ -497,7 +1440,17 @@ size_t logging_stringify(char *buf, size_t bufsize, const void *log)
 			(p->tag && p->tag->tag)? p->tag->tag : "null");
 	buf[bufsize-1] = '\0';
 
-	if (len > 0) {
+	if (len > 0 && (p->type & LOGGING_DICTIONARY_FLAG)) {
+		uintptr_t addr = 0;
+
+		if (p->message_length >= sizeof(addr)) {
+			memcpy(&addr, p->message, sizeof(addr));
+			msglen = render_args(&buf[len], bufsize - len,
+					(const char *)addr,
+					&p->message[sizeof(addr)],
+					p->message_length - sizeof(addr));
+		}
+	} else if (len > 0) {
 		msglen = MIN(bufsize - len - 1, p->message_length);
 		memcpy(&buf[len], p->message, msglen);
 		buf[msglen + len] = '\0';
@@ -505,3 +1458,50 @@ size_t logging_stringify(char *buf, size_t bufsize, const void *log)
 
 	return msglen + len;
 }
+
+int logging_unpack(const void *log, size_t size, struct logging_entry *entry)
+{
+	const logging_data_t *p = (const logging_data_t *)log;
+
+	if (log == NULL || size < sizeof(*p) ||
+			size < get_log_length(p) ||
+			p->magic != compute_magic(p)) {
+		return -EINVAL;
+	}
+
+	*entry = (struct logging_entry) {
+		.timestamp = p->timestamp,
+		.pc = p->pc,
+		.lr = p->lr,
+		.tag = p->tag,
+		.message = p->message,
+		.message_length = p->message_length,
+		.type = p->type,
+	};
+
+	return 0;
+}
+
+size_t logging_pack(void *buf, size_t bufsize,
+		const struct logging_entry *entry)
+{
+	logging_data_t *p = (logging_data_t *)buf;
+	const size_t size = sizeof(*p) + entry->message_length;
+
+	if (buf == NULL || bufsize < size) {
+		return 0;
+	}
+
+	*p = (logging_data_t) {
+		.timestamp = entry->timestamp,
+		.pc = entry->pc,
+		.lr = entry->lr,
+		.message_length = entry->message_length,
+		.type = entry->type,
+		.tag = entry->tag,
+	};
+	p->magic = compute_magic(p);
+	memmove(p->message, entry->message, entry->message_length);
+
+	return size;
+}
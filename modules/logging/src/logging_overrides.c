@@ -21,3 +21,8 @@ LIBMCU_WEAK void logging_unlock(void)
 {
 	/* Platform specific implementation */
 }
+
+LIBMCU_WEAK void logging_async_notify(void)
+{
+	/* Platform specific implementation */
+}
@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "libmcu/logging_ratelim.h"
+#include "libmcu/atomic.h"
+#include <inttypes.h>
+
+/* A log arriving while another one of the same call site holds the bucket
+ * is counted as suppressed rather than waiting for it. */
+static bool lock_bucket(struct logging_ratelim *ratelim)
+{
+	unsigned int idle = 0;
+
+	while (!libmcu_atomic_compare_exchange(&ratelim->busy, &idle, 1)) {
+		if (idle != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void unlock_bucket(struct logging_ratelim *ratelim)
+{
+	libmcu_atomic_store_release(&ratelim->busy, 0);
+}
+
+bool logging_ratelim_request(struct logging_ratelim *ratelim, logging_t type,
+		const struct logging_context *ctx)
+{
+	uint32_t suppressed = 0;
+	bool passed = false;
+
+	if (lock_bucket(ratelim)) {
+		if (!ratelim->initialized) {
+			ratelim_init(&ratelim->bucket, RATELIM_UNIT_MINUTE,
+					LOGGING_RATELIM_BURST,
+					LOGGING_RATELIM_PER_MINUTE);
+			ratelim->initialized = true;
+		}
+
+		passed = ratelim_request(&ratelim->bucket);
+		unlock_bucket(ratelim);
+	}
+
+	if (passed) {
+		suppressed = libmcu_atomic_exchange(&ratelim->suppressed, 0);
+	} else {
+		libmcu_atomic_fetch_add(&ratelim->suppressed, 1);
+	}
+
+	if (suppressed) {
+		logging_write(type, ctx, "last message repeated %" PRIu32
+				" times", suppressed);
+	}
+
+	return passed;
+}
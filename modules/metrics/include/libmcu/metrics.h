@@ -25,6 +25,15 @@ extern "C" {
 
 #define METRICS_VALUE(x)			((metric_value_t)(x))
 
+/* Counts up to 32 arguments, the bounds of a histogram */
+#define METRICS_NARGS(...)			\
+	METRICS_NARGS_(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, \
+		22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, \
+		6, 5, 4, 3, 2, 1, 0)
+#define METRICS_NARGS_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, \
+		_13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, \
+		_25, _26, _27, _28, _29, _30, _31, _32, n, ...)	n
+
 #define METRICS_FIRST_ARG(first, ...)		first
 enum {
 #define METRICS_DEFINE(key)			key,
@@ -36,6 +45,8 @@ enum {
 #define METRICS_DEFINE_BINARY(key)		key,
 #define METRICS_DEFINE_STATE(...)		\
 	METRICS_FIRST_ARG(__VA_ARGS__, keep_at_least_one_arg),
+#define METRICS_DEFINE_HISTOGRAM(key, ...)	key, \
+	key##_LAST_BUCKET = key + METRICS_NARGS(__VA_ARGS__),
 #include METRICS_USER_DEFINES
 #undef METRICS_DEFINE
 #undef METRICS_DEFINE_COUNTER
@@ -45,11 +56,13 @@ enum {
 #undef METRICS_DEFINE_BYTES
 #undef METRICS_DEFINE_BINARY
 #undef METRICS_DEFINE_STATE
+#undef METRICS_DEFINE_HISTOGRAM
 };
 #undef METRICS_FIRST_ARG
 
 typedef uint16_t metric_key_t;
 typedef int32_t metric_value_t;
+typedef uint32_t metrics_cursor_t;
 
 /**
  * @brief Sets the value of a specific metric.
@@ -142,6 +155,30 @@ void metrics_increase_by(const metric_key_t key, const metric_value_t n);
  */
 void metrics_set_pct(metric_key_t key, metric_value_t num, metric_value_t denom);
 
+/**
+ * @brief Records an observation in a histogram.
+ *
+ * The bucket the value falls in is increased by 1. Nothing happens if @p key
+ * is not one defined with METRICS_DEFINE_HISTOGRAM.
+ *
+ * @param[in] key The histogram key.
+ * @param[in] val The value observed, e.g. a latency.
+ */
+void metrics_observe(const metric_key_t key, const metric_value_t val);
+
+/**
+ * @brief Estimates a percentile of a histogram.
+ *
+ * @param[in] key The histogram key.
+ * @param[in] pct The percentile in [0, 100], e.g. 99 for p99.
+ *
+ * @return The upper bound, exclusive, of the bucket the percentile falls in,
+ *         or INT32_MAX if it is the last bucket. 0 if nothing is observed or
+ *         @p key is not a histogram.
+ */
+metric_value_t metrics_get_percentile(const metric_key_t key,
+		const uint8_t pct);
+
 /**
  * @brief Resets all metrics to their default values.
  *
@@ -225,6 +262,31 @@ size_t metrics_collect(void *buf, const size_t bufsize, void *ctx);
  */
 size_t metrics_collect_reset(void *buf, const size_t bufsize, void *ctx);
 
+/**
+ * @brief Collects only the metrics changed since the last checkpoint.
+ *
+ * Each successful call makes a checkpoint and moves @p cursor to it, so the
+ * next call encodes only the metrics updated in between. A cursor not at the
+ * latest checkpoint, e.g. zeroed at first, left behind by another cursor or
+ * by metrics_reset() and metrics_collect_reset(), gets a full snapshot of
+ * the metrics set instead. Writing the same value again does not count as a
+ * change.
+ *
+ * Passing `NULL` as @p buf performs a dry-run, returning the size required
+ * without making a checkpoint.
+ *
+ * @param[out] buf Pointer to the buffer where metrics data will be stored.
+ * @param[in] bufsize Size of the buffer in bytes.
+ * @param[in] ctx context to be used
+ * @param[in,out] cursor checkpoint of the caller, zeroed at first
+ *
+ * @return size_t The number of bytes written to the buffer. Returns 0 if
+ *                nothing has changed, @p cursor is NULL or @p bufsize is too
+ *                small, leaving @p cursor and the changes as they are.
+ */
+size_t metrics_collect_delta(void *buf, const size_t bufsize, void *ctx,
+		metrics_cursor_t *cursor);
+
 /**
  * @brief Retrieves the count of all metrics.
  *
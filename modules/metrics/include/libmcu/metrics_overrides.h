@@ -18,6 +18,18 @@ void metrics_lock_init(void);
 void metrics_lock(void);
 void metrics_unlock(void);
 
+/**
+ * @brief Returns the shard of metrics the caller updates.
+ *
+ * Used only when `METRICS_SHARDS` is greater than 1. Override this function
+ * to return the current core or thread index so that callers updating the
+ * same metric do not contend on the same cache line. The result is taken
+ * modulo `METRICS_SHARDS`.
+ *
+ * @return shard index of the caller
+ */
+unsigned int metrics_get_shard(void);
+
 /**
  * @brief Returns the device serial number string for encoder metadata.
  *
@@ -23,6 +23,7 @@ typedef enum {
 	METRIC_CLASS_BYTES      = 5,
 	METRIC_CLASS_BINARY     = 6,
 	METRIC_CLASS_STATE      = 7,
+	METRIC_CLASS_HISTOGRAM  = 8,
 } metric_class_t;
 
 typedef enum {
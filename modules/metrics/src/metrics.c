@@ -8,6 +8,8 @@
 #include "libmcu/metrics_overrides.h"
 #include "libmcu/compiler.h"
 #include "libmcu/assert.h"
+#include "libmcu/atomic.h"
+#include "libmcu/bitmap.h"
 
 #define METRICS_FIRST_ARG(first, ...)		first
 #define METRICS_ENUM_KEY_(key)			METRICS_##key
@@ -23,6 +25,9 @@ enum {
 #define METRICS_DEFINE_BINARY(key)		METRICS_DEFINE(key)
 #define METRICS_DEFINE_STATE(...)		\
 	METRICS_DEFINE(METRICS_FIRST_ARG(__VA_ARGS__, keep_at_least_one_arg))
+#define METRICS_DEFINE_HISTOGRAM(key, ...)	METRICS_ENUM_KEY(key), \
+	METRICS_ENUM_KEY(key##_LAST_BUCKET) = \
+		METRICS_ENUM_KEY(key) + METRICS_NARGS(__VA_ARGS__),
 #include METRICS_USER_DEFINES
 /* Metric definition macros are optional entries in METRICS_USER_DEFINES.
  * Touch them before undef so -Wunused-macros does not report omitted types. */
@@ -33,7 +38,8 @@ enum {
 	+ defined(METRICS_DEFINE_TIMER) \
 	+ defined(METRICS_DEFINE_BYTES) \
 	+ defined(METRICS_DEFINE_BINARY) \
-	+ defined(METRICS_DEFINE_STATE)
+	+ defined(METRICS_DEFINE_STATE) \
+	+ defined(METRICS_DEFINE_HISTOGRAM)
 #endif
 #undef METRICS_DEFINE
 #undef METRICS_DEFINE_COUNTER
@@ -43,41 +49,191 @@ enum {
 #undef METRICS_DEFINE_BYTES
 #undef METRICS_DEFINE_BINARY
 #undef METRICS_DEFINE_STATE
+#undef METRICS_DEFINE_HISTOGRAM
 	METRICS_KEY_MAX,
 };
 static_assert(METRICS_KEY_MAX < (1U << sizeof(metric_key_t) * 8),
 	"METRICS_KEY_MAX must be less than the maximum value of metric_key_t");
 
-#define METRICS_KEY_MAGIC		METRICS_KEY_MAX
-#define MAGIC_KEY			0xffU
-#define MAGIC_VALUE			((int32_t)(intptr_t)metrics)
+#if defined(METRICS_LOCK_FREE) && !defined(__GNUC__) && !defined(__clang__)
+#error "METRICS_LOCK_FREE requires the atomic builtins"
+#endif
+
+#if !defined(METRICS_SHARDS)
+#define METRICS_SHARDS			1
+#endif
+
+#if METRICS_SHARDS > 1 && !defined(METRICS_LOCK_FREE)
+#error "METRICS_SHARDS requires METRICS_LOCK_FREE"
+#endif
+
+/* In the lock-free mode, updates touch only the value and the set bit of a
+ * metric with atomic operations, and metrics_lock() is left to the
+ * collecting side. */
+#if defined(METRICS_LOCK_FREE)
+#define update_lock()
+#define update_unlock()
+#else
+#define update_lock()			metrics_lock()
+#define update_unlock()			metrics_unlock()
+#endif
+
+#if defined(UNIT_TEST)
+/* Lets tests update metrics in the middle of a collection */
+void metrics_test_interleave(void);
+LIBMCU_WEAK void metrics_test_interleave(void)
+{
+}
+#else
+#define metrics_test_interleave()
+#endif
+
+#if METRICS_SHARDS > 1
+#if !defined(METRICS_SHARD_ALIGN)
+#define METRICS_SHARD_ALIGN		64
+#endif
+#define SHARD_ALIGNED			LIBMCU_ALIGNED(METRICS_SHARD_ALIGN)
+#else
+#define SHARD_ALIGNED
+#endif
 
-struct metrics {
+/* Values and set bits are kept in separate arrays, so values are naturally
+ * aligned and collection walks the set bits only. The first shard is the
+ * main storage and the others are aligned to a cache line not to be bounced
+ * between cores updating the same metric. */
+struct shard {
+	metric_value_t values[METRICS_KEY_MAX];
+	DEFINE_BITMAP(set_bits, METRICS_KEY_MAX);
+} SHARD_ALIGNED;
+
+LIBMCU_NOINIT static struct shard shards[METRICS_SHARDS];
+LIBMCU_NOINIT static uint32_t checksum;
+/* Metrics changed since the last checkpoint of metrics_collect_delta() */
+LIBMCU_NOINIT static DEFINE_BITMAP(dirty_bits, METRICS_KEY_MAX);
+/* Checkpoint the cursors are compared against, never 0 so that a zeroed
+ * cursor gets a full snapshot. Guarded by metrics_lock() */
+static metrics_cursor_t generation = 1;
+#if defined(METRICS_LOCK_FREE)
+/* Values taken out by metrics_collect_reset(), guarded by metrics_lock() */
+static metric_value_t snapshot[METRICS_KEY_MAX];
+#endif
+#if defined(METRICS_LOCK_FREE)
+/* How the shards and a snapshot put back of a metric are merged, by the last
+ * update made to it */
+LIBMCU_NOINIT static uint8_t merge_ops[METRICS_KEY_MAX];
+#endif
+
+enum merge_op {
+	MERGE_SUM,
+	MERGE_MIN,
+	MERGE_MAX,
+	MERGE_ABSOLUTE, /* keeps the main storage, the latest written */
+};
+
+#define METRICS_DEFINE(key)
+#define METRICS_DEFINE_COUNTER(key)
+#define METRICS_DEFINE_GAUGE(key, mn, mx)
+#define METRICS_DEFINE_PERCENTAGE(key)
+#define METRICS_DEFINE_TIMER(key, u)
+#define METRICS_DEFINE_BYTES(key)
+#define METRICS_DEFINE_BINARY(key)
+#define METRICS_DEFINE_STATE(...)
+#define METRICS_DEFINE_HISTOGRAM(key, ...)	\
+	static const metric_value_t histogram_bounds_##key[] = { __VA_ARGS__ };
+#include METRICS_USER_DEFINES
+#if defined(METRICS_DEFINE) \
+	+ defined(METRICS_DEFINE_COUNTER) \
+	+ defined(METRICS_DEFINE_GAUGE) \
+	+ defined(METRICS_DEFINE_PERCENTAGE) \
+	+ defined(METRICS_DEFINE_TIMER) \
+	+ defined(METRICS_DEFINE_BYTES) \
+	+ defined(METRICS_DEFINE_BINARY) \
+	+ defined(METRICS_DEFINE_STATE) \
+	+ defined(METRICS_DEFINE_HISTOGRAM)
+#endif
+#undef METRICS_DEFINE_HISTOGRAM
+
+/* A histogram takes a key for each bucket in a row, starting from its own.
+ * Bucket i counts values below bounds[i] and not below bounds[i-1], and the
+ * last one the values not below the last bound. Buckets are plain counters,
+ * updated lock-free in the lock-free mode and encoded only once hit. */
+struct histogram {
 	metric_key_t key;
-	metric_value_t value;
-	bool is_set;
-} LIBMCU_PACKED;
+	uint8_t nr_bounds;
+	const metric_value_t *bounds;
+};
+
+static const struct histogram histograms[] = {
+#define METRICS_DEFINE_HISTOGRAM(key, ...)	{ METRICS_ENUM_KEY(key), \
+	(uint8_t)METRICS_NARGS(__VA_ARGS__), histogram_bounds_##key },
+#include METRICS_USER_DEFINES
+#if defined(METRICS_DEFINE_HISTOGRAM)
+#endif
+#undef METRICS_DEFINE
+#undef METRICS_DEFINE_COUNTER
+#undef METRICS_DEFINE_GAUGE
+#undef METRICS_DEFINE_PERCENTAGE
+#undef METRICS_DEFINE_TIMER
+#undef METRICS_DEFINE_BYTES
+#undef METRICS_DEFINE_BINARY
+#undef METRICS_DEFINE_STATE
+#undef METRICS_DEFINE_HISTOGRAM
+	{ METRICS_KEY_MAX, 0, NULL }, /* sentinel */
+};
+
+static const struct histogram *find_histogram(const metric_key_t key)
+{
+	for (const struct histogram *h = histograms; h->bounds; h++) {
+		if (key >= h->key && key <= h->key + h->nr_bounds) {
+			return h;
+		}
+	}
+
+	return NULL;
+}
+
+/* Binary search for the first bound greater than the value */
+static metric_key_t find_bucket(const struct histogram *h,
+		const metric_value_t value)
+{
+	uint8_t lo = 0;
+	uint8_t hi = h->nr_bounds;
+
+	while (lo < hi) {
+		const uint8_t mid = (uint8_t)((lo + hi) / 2);
 
-LIBMCU_NOINIT static struct metrics metrics[METRICS_KEY_MAX+1/*magic*/];
+		if (value < h->bounds[mid]) {
+			hi = mid;
+		} else {
+			lo = (uint8_t)(mid + 1);
+		}
+	}
+
+	return (metric_key_t)(h->key + lo);
+}
 
 #if defined(METRICS_SCHEMA_IBS)
-static const struct metric_schema schema_table[] = {
-#define METRICS_DEFINE(key) \
+/* Histogram buckets are left out, getting their ranges from the bounds. See
+ * get_schema(). */
+static const struct metric_schema schema_table[METRICS_KEY_MAX] = {
+#define METRICS_DEFINE(key) [METRICS_ENUM_KEY(key)] = \
 	{ METRIC_CLASS_UNTYPED, METRIC_UNIT_NONE, INT32_MIN, INT32_MAX },
-#define METRICS_DEFINE_COUNTER(key) \
+#define METRICS_DEFINE_COUNTER(key) [METRICS_ENUM_KEY(key)] = \
 	{ METRIC_CLASS_COUNTER, METRIC_UNIT_NONE, 0, INT32_MAX },
-#define METRICS_DEFINE_GAUGE(key, mn, mx) \
+#define METRICS_DEFINE_GAUGE(key, mn, mx) [METRICS_ENUM_KEY(key)] = \
 	{ METRIC_CLASS_GAUGE, METRIC_UNIT_NONE, (mn), (mx) },
-#define METRICS_DEFINE_PERCENTAGE(key) \
+#define METRICS_DEFINE_PERCENTAGE(key) [METRICS_ENUM_KEY(key)] = \
 	{ METRIC_CLASS_PERCENTAGE, METRIC_UNIT_NONE, 0, 100 },
-#define METRICS_DEFINE_TIMER(key, u) \
+#define METRICS_DEFINE_TIMER(key, u) [METRICS_ENUM_KEY(key)] = \
 	{ METRIC_CLASS_TIMER, METRIC_UNIT_##u, 0, INT32_MAX },
-#define METRICS_DEFINE_BYTES(key) \
+#define METRICS_DEFINE_BYTES(key) [METRICS_ENUM_KEY(key)] = \
 	{ METRIC_CLASS_BYTES, METRIC_UNIT_NONE, 0, INT32_MAX },
-#define METRICS_DEFINE_BINARY(key) \
+#define METRICS_DEFINE_BINARY(key) [METRICS_ENUM_KEY(key)] = \
 	{ METRIC_CLASS_BINARY, METRIC_UNIT_NONE, 0, 1 },
-#define METRICS_DEFINE_STATE(...) \
+#define METRICS_DEFINE_STATE(...) [METRICS_ENUM_KEY(METRICS_FIRST_ARG( \
+		__VA_ARGS__, keep_at_least_one_arg))] = \
 	{ METRIC_CLASS_STATE, METRIC_UNIT_NONE, INT32_MIN, INT32_MAX },
+#define METRICS_DEFINE_HISTOGRAM(key, ...)
 #include METRICS_USER_DEFINES
 #if defined(METRICS_DEFINE) \
 	+ defined(METRICS_DEFINE_COUNTER) \
@@ -86,7 +242,8 @@ static const struct metric_schema schema_table[] = {
 	+ defined(METRICS_DEFINE_TIMER) \
 	+ defined(METRICS_DEFINE_BYTES) \
 	+ defined(METRICS_DEFINE_BINARY) \
-	+ defined(METRICS_DEFINE_STATE)
+	+ defined(METRICS_DEFINE_STATE) \
+	+ defined(METRICS_DEFINE_HISTOGRAM)
 #endif
 #undef METRICS_DEFINE
 #undef METRICS_DEFINE_COUNTER
@@ -96,13 +253,38 @@ static const struct metric_schema schema_table[] = {
 #undef METRICS_DEFINE_BYTES
 #undef METRICS_DEFINE_BINARY
 #undef METRICS_DEFINE_STATE
+#undef METRICS_DEFINE_HISTOGRAM
 };
 
+static void get_schema(const metric_key_t key, struct metric_schema *schema)
+{
+	const struct histogram *h = find_histogram(key);
+
+	if (h == NULL) {
+		*schema = schema_table[key];
+		return;
+	}
+
+	const uint8_t bucket = (uint8_t)(key - h->key);
+
+	*schema = (struct metric_schema) {
+		.type = METRIC_CLASS_HISTOGRAM,
+		.unit = METRIC_UNIT_NONE,
+		.range_min = bucket? h->bounds[bucket - 1] : INT32_MIN,
+		.range_max = bucket < h->nr_bounds?
+			h->bounds[bucket] - 1 : INT32_MAX,
+	};
+}
+
+/* Histogram buckets hold counts, not values in the range of the bucket */
 static void assert_value_in_schema_range(const metric_key_t key,
 		const metric_value_t value)
 {
 	const struct metric_schema *s = &schema_table[key];
-	assert(value >= s->range_min && value <= s->range_max);
+
+	if (find_histogram(key) == NULL) {
+		assert(value >= s->range_min && value <= s->range_max);
+	}
 }
 #else
 #define assert_value_in_schema_range(key, value)  ((void)0)
@@ -111,8 +293,9 @@ static void assert_value_in_schema_range(const metric_key_t key,
 #if !defined(METRICS_NO_KEY_STRING)
 #define METRICS_STRING_KEY_(key)		#key
 #define METRICS_STRING_KEY(key)			METRICS_STRING_KEY_(key)
-static char const *key_strings[] = {
-#define METRICS_DEFINE(key)			METRICS_STRING_KEY(key),
+static char const *key_strings[METRICS_KEY_MAX] = {
+#define METRICS_DEFINE(key)			\
+	[METRICS_ENUM_KEY(key)] = METRICS_STRING_KEY(key),
 #define METRICS_DEFINE_COUNTER(key)		METRICS_DEFINE(key)
 #define METRICS_DEFINE_GAUGE(key, mn, mx)	METRICS_DEFINE(key)
 #define METRICS_DEFINE_PERCENTAGE(key)		METRICS_DEFINE(key)
@@ -121,6 +304,7 @@ static char const *key_strings[] = {
 #define METRICS_DEFINE_BINARY(key)		METRICS_DEFINE(key)
 #define METRICS_DEFINE_STATE(...)		\
 	METRICS_DEFINE(METRICS_FIRST_ARG(__VA_ARGS__, keep_at_least_one_arg))
+#define METRICS_DEFINE_HISTOGRAM(key, ...)	METRICS_DEFINE(key)
 #include METRICS_USER_DEFINES
 #if defined(METRICS_DEFINE) \
 	+ defined(METRICS_DEFINE_COUNTER) \
@@ -129,7 +313,8 @@ static char const *key_strings[] = {
 	+ defined(METRICS_DEFINE_TIMER) \
 	+ defined(METRICS_DEFINE_BYTES) \
 	+ defined(METRICS_DEFINE_BINARY) \
-	+ defined(METRICS_DEFINE_STATE)
+	+ defined(METRICS_DEFINE_STATE) \
+	+ defined(METRICS_DEFINE_HISTOGRAM)
 #endif
 #undef METRICS_DEFINE
 #undef METRICS_DEFINE_COUNTER
@@ -139,6 +324,7 @@ static char const *key_strings[] = {
 #undef METRICS_DEFINE_BYTES
 #undef METRICS_DEFINE_BINARY
 #undef METRICS_DEFINE_STATE
+#undef METRICS_DEFINE_HISTOGRAM
 };
 #if defined(METRICS_STRING_KEY) + defined(METRICS_STRING_KEY_)
 #endif
@@ -158,127 +344,540 @@ static bool is_valid_key(const metric_key_t key)
 	return key < METRICS_KEY_MAX;
 }
 
-static struct metrics *get_item_by_index(const metric_key_t index)
+#if defined(METRICS_LOCK_FREE)
+static unsigned int get_shard(void)
 {
-	return &metrics[index];
+#if METRICS_SHARDS > 1
+	return metrics_get_shard() % METRICS_SHARDS;
+#else
+	return 0;
+#endif
 }
+#endif
 
-static struct metrics *get_obj_from_key(const metric_key_t key)
+static metric_value_t *get_value_in(const unsigned int shard,
+		const metric_key_t key)
 {
 	assert(is_valid_key(key));
-	return get_item_by_index(key);
+	return &shards[shard].values[key];
+}
+
+static bitmap_t get_set_bits_in(const unsigned int shard)
+{
+	return shards[shard].set_bits;
+}
+
+static bitmap_static_t get_bit(const metric_key_t key)
+{
+	return (bitmap_static_t)1 << BITMAP_REMAIN(key);
+}
+
+static bool is_bit_set(const bitmap_static_t *bits, const metric_key_t key)
+{
+	return (libmcu_atomic_load_relaxed(&bits[BITMAP_DIV(key)])
+			& get_bit(key)) != 0;
+}
+
+static void set_bit(bitmap_t bits, const metric_key_t key)
+{
+#if defined(METRICS_LOCK_FREE)
+	bitmap_static_t *word = &bits[BITMAP_DIV(key)];
+	const bitmap_static_t bit = get_bit(key);
+
+	/* Checked first not to write to the shared word on every update */
+	if (!(libmcu_atomic_load_relaxed(word) & bit)) {
+		libmcu_atomic_fetch_or(word, bit);
+	}
+#else
+	bitmap_set(bits, key);
+#endif
+}
+
+static void clear_bit(bitmap_t bits, const metric_key_t key)
+{
+#if defined(METRICS_LOCK_FREE)
+	libmcu_atomic_fetch_and(&bits[BITMAP_DIV(key)], ~get_bit(key));
+#else
+	bitmap_clear(bits, key);
+#endif
+}
+
+static int find_next_set(const bitmap_t bits, const int pos)
+{
+	return bitmap_find_next_set(bits, METRICS_KEY_MAX, pos);
+}
+
+static void mark_changed(const metric_key_t key)
+{
+	set_bit(dirty_bits, key);
+}
+
+/* Takes the changed bits out, leaving them clear for the next checkpoint */
+static void take_changed(bitmap_t changed)
+{
+	for (int i = 0; i < BITMAP_ARRAY_SIZE(METRICS_KEY_MAX); i++) {
+#if defined(METRICS_LOCK_FREE)
+		changed[i] = libmcu_atomic_exchange(&dirty_bits[i], 0);
+#else
+		changed[i] = dirty_bits[i];
+		dirty_bits[i] = 0;
+#endif
+	}
+}
+
+static void put_back_changed(const bitmap_t changed)
+{
+	for (int i = 0; i < BITMAP_ARRAY_SIZE(METRICS_KEY_MAX); i++) {
+#if defined(METRICS_LOCK_FREE)
+		libmcu_atomic_fetch_or(&dirty_bits[i], changed[i]);
+#else
+		dirty_bits[i] |= changed[i];
+#endif
+	}
+}
+
+static bool is_metric_set(const metric_key_t key)
+{
+	for (unsigned int i = 0; i < METRICS_SHARDS; i++) {
+		if (is_bit_set(get_set_bits_in(i), key)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void unset_metric_in(const unsigned int shard, const metric_key_t key)
+{
+	if (is_bit_set(get_set_bits_in(shard), key)) {
+		clear_bit(get_set_bits_in(shard), key);
+		libmcu_atomic_store_relaxed(get_value_in(shard, key), 0);
+	}
+}
+
+static void unset_metric(const metric_key_t key)
+{
+	for (unsigned int i = 0; i < METRICS_SHARDS; i++) {
+		unset_metric_in(i, key);
+	}
+}
+
+/* Takes the union of the shards, so that a metric set in any is counted */
+static void copy_set_bits(bitmap_t bits)
+{
+	for (int i = 0; i < BITMAP_ARRAY_SIZE(METRICS_KEY_MAX); i++) {
+		bits[i] = 0;
+		for (unsigned int j = 0; j < METRICS_SHARDS; j++) {
+			bits[i] |= libmcu_atomic_load_relaxed(
+					&get_set_bits_in(j)[i]);
+		}
+	}
 }
 
-static bool is_metric_set(const struct metrics *p)
+/* Values change on every update, so the checksum covers what the storage
+ * is rather than what it holds: memory left over by a different build or
+ * garbage at cold boot does not match. */
+static uint32_t compute_checksum(void)
 {
-	return p->is_set;
+	const uintptr_t layout[] = {
+		(uintptr_t)shards,
+		(uintptr_t)dirty_bits,
+		sizeof(shards),
+		METRICS_KEY_MAX,
+		METRICS_SHARDS,
+	};
+	const uint8_t *p = (const uint8_t *)layout;
+	uint32_t hash = 2166136261U; /* FNV-1a */
+
+	for (size_t i = 0; i < sizeof(layout); i++) {
+		hash = (hash ^ p[i]) * 16777619U;
+	}
+
+	return hash;
 }
 
 static bool validate_metrics(void)
 {
-	struct metrics *p = get_item_by_index(METRICS_KEY_MAGIC);
+	return checksum == compute_checksum();
+}
 
-	if (p->key != MAGIC_KEY || p->value != MAGIC_VALUE) {
-		return false;
+static bool is_better(const enum merge_op op,
+		const metric_value_t a, const metric_value_t b)
+{
+	if (op == MERGE_MIN) {
+		return a < b;
+	} else if (op == MERGE_MAX) {
+		return a > b;
 	}
 
-	for (metric_key_t i = 0; i < METRICS_KEY_MAX; i++) {
-		if (get_item_by_index(i)->key != i) {
-			return false;
+	return false;
+}
+
+static metric_value_t merge(const enum merge_op op,
+		const metric_value_t a, const metric_value_t b)
+{
+	if (op == MERGE_SUM) {
+		return a + b;
+	}
+	return is_better(op, b, a)? b : a;
+}
+
+static void set_merge_op(const metric_key_t key, const enum merge_op op)
+{
+#if defined(METRICS_LOCK_FREE)
+	if (libmcu_atomic_load_relaxed(&merge_ops[key]) != op) {
+		libmcu_atomic_store_relaxed(&merge_ops[key], (uint8_t)op);
+	}
+#else
+	unused(key);
+	unused(op);
+#endif
+}
+
+static enum merge_op get_merge_op(const metric_key_t key)
+{
+#if defined(METRICS_LOCK_FREE)
+	const uint8_t op = libmcu_atomic_load_relaxed(&merge_ops[key]);
+	return (enum merge_op)op;
+#else
+	unused(key);
+	return MERGE_SUM;
+#endif
+}
+
+static metric_value_t get_metric_value(const metric_key_t key)
+{
+	metric_value_t value = 0;
+	bool is_set = false;
+
+	for (unsigned int i = 0; i < METRICS_SHARDS; i++) {
+		if (is_bit_set(get_set_bits_in(i), key)) {
+			const metric_value_t v = libmcu_atomic_load_relaxed(
+					get_value_in(i, key));
+			value = is_set? merge(get_merge_op(key), value, v) : v;
+			is_set = true;
 		}
 	}
 
-	return true;
+	return value;
 }
 
+/* The value is written before the set bit, so a metric seen set has its
+ * value in place. Absolute values always go to the main storage, dropping
+ * what the other shards have. */
 static void set_metric_value(const metric_key_t key, const metric_value_t value)
 {
+	const bool is_changed =
+		!is_metric_set(key) || get_metric_value(key) != value;
+
 	assert_value_in_schema_range(key, value);
-	struct metrics *p = get_obj_from_key(key);
-	p->value  = value;
-	p->is_set = true;
+	set_merge_op(key, MERGE_ABSOLUTE);
+
+	for (unsigned int i = 1; i < METRICS_SHARDS; i++) {
+		unset_metric_in(i, key);
+	}
+
+	libmcu_atomic_store_relaxed(get_value_in(0, key), value);
+	set_bit(get_set_bits_in(0), key);
+
+	if (is_changed) {
+		mark_changed(key);
+	}
 }
 
-static metric_value_t get_metric_value(const metric_key_t key)
+static void add_metric_value(const metric_key_t key, const metric_value_t n)
 {
-	return get_obj_from_key(key)->value;
+#if defined(METRICS_LOCK_FREE)
+	const unsigned int shard = get_shard();
+	const metric_value_t value =
+		libmcu_atomic_fetch_add(get_value_in(shard, key), n) + n;
+	unused(value);
+	assert_value_in_schema_range(key, value);
+	set_merge_op(key, MERGE_SUM);
+	set_bit(get_set_bits_in(shard), key);
+	if (n != 0) {
+		mark_changed(key);
+	}
+#else
+	set_metric_value(key, get_metric_value(key) + n);
+#endif
 }
 
-static void set_metric_value_if_min(const metric_key_t key,
-		const metric_value_t value)
+#if defined(METRICS_LOCK_FREE)
+static void set_metric_value_if_in(const unsigned int shard,
+		const metric_key_t key, const metric_value_t value,
+		const enum merge_op op)
 {
-	const struct metrics *p = get_obj_from_key(key);
+	metric_value_t *p = get_value_in(shard, key);
+	bitmap_t bits = get_set_bits_in(shard);
+	metric_value_t current = libmcu_atomic_load_relaxed(p);
+	bool is_set = is_bit_set(bits, key);
 
-	if (!is_metric_set(p) || value < p->value) {
+	set_merge_op(key, op);
+
+	/* A failed swap means someone else has written the value in between,
+	 * so it is compared against from then on even if not marked set
+	 * yet. */
+	while (!is_set || is_better(op, value, current)) {
+		if (libmcu_atomic_compare_exchange(p, &current, value)) {
+			set_bit(bits, key);
+			mark_changed(key);
+			break;
+		}
+		is_set = true;
+	}
+}
+#endif
+
+static void set_metric_value_if(const metric_key_t key,
+		const metric_value_t value, const enum merge_op op)
+{
+	assert_value_in_schema_range(key, value);
+#if defined(METRICS_LOCK_FREE)
+	set_metric_value_if_in(get_shard(), key, value, op);
+#else
+	if (!is_metric_set(key) ||
+			is_better(op, value, get_metric_value(key))) {
 		set_metric_value(key, value);
 	}
+#endif
 }
 
-static void set_metric_value_if_max(const metric_key_t key,
+static void set_metric_value_if_min(const metric_key_t key,
 		const metric_value_t value)
 {
-	const struct metrics *p = get_obj_from_key(key);
+	set_metric_value_if(key, value, MERGE_MIN);
+}
 
-	if (!is_metric_set(p) || value > p->value) {
-		set_metric_value(key, value);
-	}
+static void set_metric_value_if_max(const metric_key_t key,
+		const metric_value_t value)
+{
+	set_metric_value_if(key, value, MERGE_MAX);
 }
 
 static void iterate_all(void (*callback_each)(const metric_key_t key,
 				const metric_value_t value, void *ctx),
 		void *ctx)
 {
-	for (metric_key_t i = 0; i < METRICS_KEY_MAX; i++) {
-		struct metrics const *p = get_item_by_index(i);
-		if (is_metric_set(p)) {
-			callback_each(p->key, p->value, ctx);
-		}
+	DEFINE_BITMAP(bits, METRICS_KEY_MAX);
+
+	copy_set_bits(bits);
+
+	for (int i = find_next_set(bits, 0); i >= 0;
+			i = find_next_set(bits, i + 1)) {
+		const metric_key_t key = (metric_key_t)i;
+		callback_each(key, get_metric_value(key), ctx);
 	}
 }
 
-static void reset_all(void)
+/* Cursors left at the previous checkpoint get a full snapshot next time */
+static void advance_checkpoint(void)
 {
-	for (metric_key_t i = 0; i < METRICS_KEY_MAX; i++) {
-		get_item_by_index(i)->key = i;
-		get_item_by_index(i)->value = 0;
-		get_item_by_index(i)->is_set = false;
+	if (++generation == 0) {
+		generation = 1;
 	}
 }
 
-static uint32_t count_metrics_updated(void)
+static void reset_all(void)
 {
-	uint32_t nr_updated = 0;
+	for (unsigned int i = 0; i < METRICS_SHARDS; i++) {
+		for (metric_key_t j = 0; j < METRICS_KEY_MAX; j++) {
+			libmcu_atomic_store_relaxed(get_value_in(i, j), 0);
+		}
+		for (int j = 0; j < BITMAP_ARRAY_SIZE(METRICS_KEY_MAX); j++) {
+			libmcu_atomic_store_relaxed(&get_set_bits_in(i)[j], 0);
+		}
+	}
 
 	for (metric_key_t i = 0; i < METRICS_KEY_MAX; i++) {
-		struct metrics const *p = get_item_by_index(i);
-		if (is_metric_set(p)) {
-			nr_updated++;
-		}
+		set_merge_op(i, MERGE_SUM);
 	}
 
-	return nr_updated;
+	bitmap_create_static(dirty_bits, METRICS_KEY_MAX, false);
+	advance_checkpoint();
 }
 
-static size_t encode_all(uint8_t *buf, const size_t bufsize, void *ctx)
+static uint32_t count_metrics_updated(const bitmap_t bits)
+{
+	return (uint32_t)bitmap_count(bits, METRICS_KEY_MAX);
+}
+
+/* Encodes the metrics marked in @p bits, a copy taken so that the count in
+ * the header agrees with the entries. Values are read from @p values if
+ * given, or merged from the live ones otherwise. */
+static size_t encode_all(uint8_t *buf, const size_t bufsize, void *ctx,
+		const bitmap_t bits, const metric_value_t *values)
 {
 	size_t written = metrics_encode_header(buf, bufsize,
-			METRICS_KEY_MAX, count_metrics_updated(), ctx);
+			METRICS_KEY_MAX, count_metrics_updated(bits), ctx);
 
-	for (metric_key_t i = 0; i < METRICS_KEY_MAX; i++) {
-		struct metrics const *p = get_item_by_index(i);
-		if (is_metric_set(p)) {
-			uint8_t *dst = buf ? &buf[written] : NULL;
-			size_t remaining = (buf && bufsize > written)
-					? bufsize - written : 0;
+	for (int i = find_next_set(bits, 0); i >= 0;
+			i = find_next_set(bits, i + 1)) {
+		const metric_key_t key = (metric_key_t)i;
+		uint8_t *dst = buf ? &buf[written] : NULL;
+		size_t remaining = (buf && bufsize > written)
+				? bufsize - written : 0;
+		const metric_value_t value = values?
+			values[key] : get_metric_value(key);
 #if defined(METRICS_SCHEMA_IBS)
-			written += metrics_encode_each(dst, remaining, p->key,
-					p->value, &schema_table[i], ctx);
+		struct metric_schema schema;
+		get_schema(key, &schema);
+		written += metrics_encode_each(dst, remaining, key,
+				value, &schema, ctx);
 #else
-			written += metrics_encode_each(dst, remaining,
-					p->key, p->value, ctx);
+		written += metrics_encode_each(dst, remaining,
+				key, value, ctx);
 #endif
+	}
+
+	return written;
+}
+
+#if defined(METRICS_LOCK_FREE)
+/* Takes the set metrics out of every shard into the snapshot, merged and
+ * leaving them unset and zero. An update racing with it lands either in
+ * this snapshot or in the next. */
+static void take_snapshot(bitmap_t bits)
+{
+	bitmap_create_static(bits, METRICS_KEY_MAX, false);
+
+	for (unsigned int i = 0; i < METRICS_SHARDS; i++) {
+		bitmap_t shard_bits = get_set_bits_in(i);
+		DEFINE_BITMAP(taken, METRICS_KEY_MAX);
+
+		for (int j = 0; j < BITMAP_ARRAY_SIZE(METRICS_KEY_MAX); j++) {
+			taken[j] = libmcu_atomic_exchange(&shard_bits[j], 0);
+		}
+
+		for (int j = find_next_set(taken, 0); j >= 0;
+				j = find_next_set(taken, j + 1)) {
+			const metric_key_t key = (metric_key_t)j;
+			const metric_value_t value = libmcu_atomic_exchange(
+					get_value_in(i, key), 0);
+
+			if (bitmap_get(bits, j)) {
+				snapshot[key] = merge(get_merge_op(key),
+						snapshot[key], value);
+			} else {
+				snapshot[key] = value;
+				bitmap_set(bits, j);
+			}
+		}
+	}
+}
+
+/* Puts back the snapshot that could not be collected into the main storage.
+ * Updates made in the meantime are merged, which keeps counters exact. An
+ * absolute value written in the meantime is newer, so the snapshot one is
+ * dropped then. */
+static void restore_snapshot(const bitmap_t bits)
+{
+	for (int i = find_next_set(bits, 0); i >= 0;
+			i = find_next_set(bits, i + 1)) {
+		const metric_key_t key = (metric_key_t)i;
+		const enum merge_op op = get_merge_op(key);
+
+		if (op == MERGE_SUM) {
+			libmcu_atomic_fetch_add(get_value_in(0, key),
+					snapshot[key]);
+			set_bit(get_set_bits_in(0), key);
+			mark_changed(key);
+		} else {
+			set_metric_value_if_in(0, key, snapshot[key], op);
 		}
 	}
+}
+
+static size_t collect_reset(uint8_t *buf, const size_t bufsize, void *ctx)
+{
+	DEFINE_BITMAP(bits, METRICS_KEY_MAX);
+	size_t required;
+	size_t written = 0;
+
+	take_snapshot(bits);
+
+	required = encode_all(NULL, 0, ctx, bits, snapshot);
+	if (required > 0 && bufsize >= required) {
+		written = encode_all(buf, bufsize, ctx, bits, snapshot);
+	}
+	if (written == 0 || written < required || written > bufsize) {
+		restore_snapshot(bits);
+		written = 0;
+	} else {
+		advance_checkpoint();
+	}
+
+	return written;
+}
+#else
+static size_t collect_reset(uint8_t *buf, const size_t bufsize, void *ctx)
+{
+	DEFINE_BITMAP(bits, METRICS_KEY_MAX);
+	size_t required;
+	size_t written = 0;
+
+	copy_set_bits(bits);
+
+	required = encode_all(NULL, 0, ctx, bits, NULL);
+	if (required > 0 && bufsize >= required) {
+		written = encode_all(buf, bufsize, ctx, bits, NULL);
+		if (written >= required && written <= bufsize) {
+			reset_all();
+		} else {
+			written = 0;
+		}
+	}
+
+	return written;
+}
+#endif
+
+static size_t collect_delta(uint8_t *buf, const size_t bufsize, void *ctx,
+		metrics_cursor_t *cursor)
+{
+	DEFINE_BITMAP(bits, METRICS_KEY_MAX);
+	DEFINE_BITMAP(changed, METRICS_KEY_MAX);
+	const bool is_full = *cursor != generation;
+
+	/* The changed bits go first since a metric is set before marked
+	 * changed. Copying the set bits first, an update in between would be
+	 * taken as changed without being in the copy and never reported. */
+	if (buf == NULL) { /* dry-run leaves the changes in place */
+		for (int i = 0; i < BITMAP_ARRAY_SIZE(METRICS_KEY_MAX); i++) {
+			changed[i] = libmcu_atomic_load_acquire(&dirty_bits[i]);
+		}
+	} else {
+		take_changed(changed);
+	}
+
+	metrics_test_interleave();
+	copy_set_bits(bits);
+
+	for (int i = 0; !is_full && i < BITMAP_ARRAY_SIZE(METRICS_KEY_MAX);
+			i++) {
+		bits[i] &= changed[i];
+	}
+
+	if (count_metrics_updated(bits) == 0) {
+		return 0;
+	}
+
+	const size_t required = encode_all(NULL, 0, ctx, bits, NULL);
+	size_t written = 0;
+
+	if (buf == NULL) {
+		return required;
+	} else if (bufsize >= required) {
+		written = encode_all(buf, bufsize, ctx, bits, NULL);
+	}
+
+	if (written == 0 || written < required || written > bufsize) {
+		put_back_changed(changed);
+		return 0;
+	}
+
+	advance_checkpoint();
+	*cursor = generation;
 
 	return written;
 }
@@ -293,9 +892,9 @@ void metrics_set(const metric_key_t key, const metric_value_t val)
 	if (!is_valid_key(key)) {
 		return;
 	}
-	metrics_lock();
+	update_lock();
 	set_metric_value(key, val);
-	metrics_unlock();
+	update_unlock();
 }
 
 void metrics_set_if_min(const metric_key_t key, const metric_value_t val)
@@ -303,9 +902,9 @@ void metrics_set_if_min(const metric_key_t key, const metric_value_t val)
 	if (!is_valid_key(key)) {
 		return;
 	}
-	metrics_lock();
+	update_lock();
 	set_metric_value_if_min(key, val);
-	metrics_unlock();
+	update_unlock();
 }
 
 void metrics_set_if_max(const metric_key_t key, const metric_value_t val)
@@ -313,9 +912,9 @@ void metrics_set_if_max(const metric_key_t key, const metric_value_t val)
 	if (!is_valid_key(key)) {
 		return;
 	}
-	metrics_lock();
+	update_lock();
 	set_metric_value_if_max(key, val);
-	metrics_unlock();
+	update_unlock();
 }
 
 void metrics_set_max_min(const metric_key_t k_max, const metric_key_t k_min,
@@ -324,10 +923,10 @@ void metrics_set_max_min(const metric_key_t k_max, const metric_key_t k_min,
 	if (!is_valid_key(k_max) || !is_valid_key(k_min)) {
 		return;
 	}
-	metrics_lock();
+	update_lock();
 	set_metric_value_if_max(k_max, val);
 	set_metric_value_if_min(k_min, val);
-	metrics_unlock();
+	update_unlock();
 }
 
 metric_value_t metrics_get(const metric_key_t key)
@@ -337,9 +936,9 @@ metric_value_t metrics_get(const metric_key_t key)
 	if (!is_valid_key(key)) {
 		return 0;
 	}
-	metrics_lock();
+	update_lock();
 	value = get_metric_value(key);
-	metrics_unlock();
+	update_unlock();
 
 	return value;
 }
@@ -349,9 +948,9 @@ void metrics_increase(const metric_key_t key)
 	if (!is_valid_key(key)) {
 		return;
 	}
-	metrics_lock();
-	set_metric_value(key, get_metric_value(key) + 1);
-	metrics_unlock();
+	update_lock();
+	add_metric_value(key, 1);
+	update_unlock();
 }
 
 void metrics_increase_by(const metric_key_t key, const metric_value_t n)
@@ -359,9 +958,9 @@ void metrics_increase_by(const metric_key_t key, const metric_value_t n)
 	if (!is_valid_key(key)) {
 		return;
 	}
-	metrics_lock();
-	set_metric_value(key, get_metric_value(key) + n);
-	metrics_unlock();
+	update_lock();
+	add_metric_value(key, n);
+	update_unlock();
 }
 
 void metrics_set_pct(const metric_key_t key, const metric_value_t num,
@@ -370,9 +969,54 @@ void metrics_set_pct(const metric_key_t key, const metric_value_t num,
 	if (!is_valid_key(key) || denom == 0) {
 		return;
 	}
-	metrics_lock();
+	update_lock();
 	set_metric_value(key, (metric_value_t)((int64_t)num * 100 / denom));
-	metrics_unlock();
+	update_unlock();
+}
+
+void metrics_observe(const metric_key_t key, const metric_value_t val)
+{
+	const struct histogram *h;
+
+	if (!is_valid_key(key) || (h = find_histogram(key)) == NULL) {
+		return;
+	}
+	update_lock();
+	add_metric_value(find_bucket(h, val), 1);
+	update_unlock();
+}
+
+metric_value_t metrics_get_percentile(const metric_key_t key,
+		const uint8_t pct)
+{
+	const struct histogram *h;
+	int64_t total = 0;
+	int64_t sum = 0;
+
+	if (!is_valid_key(key) || (h = find_histogram(key)) == NULL ||
+			pct > 100) {
+		return 0;
+	}
+
+	update_lock();
+	for (uint8_t i = 0; i <= h->nr_bounds; i++) {
+		total += get_metric_value((metric_key_t)(h->key + i));
+	}
+
+	/* The rank of the observation at the percentile, at least the first */
+	const int64_t rank = (total * pct + 99) / 100;
+	metric_value_t value = 0;
+
+	for (uint8_t i = 0; total > 0 && i <= h->nr_bounds; i++) {
+		sum += get_metric_value((metric_key_t)(h->key + i));
+		if (sum >= rank && sum > 0) {
+			value = i < h->nr_bounds? h->bounds[i] : INT32_MAX;
+			break;
+		}
+	}
+	update_unlock();
+
+	return value;
 }
 
 bool metrics_is_set(const metric_key_t key)
@@ -380,9 +1024,9 @@ bool metrics_is_set(const metric_key_t key)
 	if (!is_valid_key(key)) {
 		return false;
 	}
-	metrics_lock();
-	const bool is_set = is_metric_set(get_obj_from_key(key));
-	metrics_unlock();
+	update_lock();
+	const bool is_set = is_metric_set(key);
+	update_unlock();
 	return is_set;
 }
 
@@ -398,21 +1042,19 @@ void metrics_unset(const metric_key_t key)
 	if (!is_valid_key(key)) {
 		return;
 	}
-	metrics_lock();
-	struct metrics *p = get_obj_from_key(key);
-	if (is_metric_set(p)) {
-		p->value = 0;
-		p->is_set = false;
-	}
-	metrics_unlock();
+	update_lock();
+	unset_metric(key);
+	update_unlock();
 }
 
 size_t metrics_collect(void *buf, const size_t bufsize, void *ctx)
 {
+	DEFINE_BITMAP(bits, METRICS_KEY_MAX);
 	size_t written;
 
 	metrics_lock();
-	written = encode_all((uint8_t *)buf, bufsize, ctx);
+	copy_set_bits(bits);
+	written = encode_all((uint8_t *)buf, bufsize, ctx, bits, NULL);
 	metrics_unlock();
 
 	return written;
@@ -420,23 +1062,30 @@ size_t metrics_collect(void *buf, const size_t bufsize, void *ctx)
 
 size_t metrics_collect_reset(void *buf, const size_t bufsize, void *ctx)
 {
-	size_t required;
-	size_t written = 0;
+	size_t written;
 
 	if (buf == NULL || bufsize == 0) {
 		return 0;
 	}
 
 	metrics_lock();
-	required = encode_all(NULL, 0, ctx);
-	if (required > 0 && bufsize >= required) {
-		written = encode_all((uint8_t *)buf, bufsize, ctx);
-		if (written >= required && written <= bufsize) {
-			reset_all();
-		} else {
-			written = 0;
-		}
+	written = collect_reset((uint8_t *)buf, bufsize, ctx);
+	metrics_unlock();
+
+	return written;
+}
+
+size_t metrics_collect_delta(void *buf, const size_t bufsize, void *ctx,
+		metrics_cursor_t *cursor)
+{
+	size_t written;
+
+	if (cursor == NULL) {
+		return 0;
 	}
+
+	metrics_lock();
+	written = collect_delta((uint8_t *)buf, bufsize, ctx, cursor);
 	metrics_unlock();
 
 	return written;
@@ -456,9 +1105,13 @@ size_t metrics_count(void)
 
 size_t metrics_count_set(void)
 {
+	DEFINE_BITMAP(bits, METRICS_KEY_MAX);
+
 	metrics_lock();
-	const uint32_t n = count_metrics_updated();
+	copy_set_bits(bits);
 	metrics_unlock();
+
+	const uint32_t n = count_metrics_updated(bits);
 	return n;
 }
 
@@ -468,6 +1121,12 @@ const char *metrics_stringify_key(const metric_key_t key)
 	if (!is_valid_key(key)) {
 		return "";
 	}
+
+	const struct histogram *h = find_histogram(key);
+	if (h) { /* buckets are named after the histogram */
+		return key_strings[h->key];
+	}
+
 	return key_strings[key];
 }
 #endif
@@ -476,9 +1135,6 @@ void metrics_init(const bool force)
 {
 	if (force || !validate_metrics()) {
 		initialize_metrics();
-
-		struct metrics *p = get_item_by_index(METRICS_KEY_MAGIC);
-		p->key = MAGIC_KEY;
-		p->value = MAGIC_VALUE;
+		checksum = compute_checksum();
 	}
 }
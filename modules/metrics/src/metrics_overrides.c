@@ -19,6 +19,11 @@ LIBMCU_WEAK void metrics_unlock(void)
 	/* platform specific implementation */
 }
 
+LIBMCU_WEAK unsigned int metrics_get_shard(void)
+{
+	return 0;
+}
+
 LIBMCU_WEAK const char *metrics_get_serial_number_string(void)
 {
 	return "";
@@ -12,6 +12,7 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 #if !defined(PUBSUB_TOPIC_NAME_MAXLEN)
 #define PUBSUB_TOPIC_NAME_MAXLEN		32
@@ -30,8 +31,25 @@ typedef enum {
 	PUBSUB_INVALID_PARAM			= -5,
 	PUBSUB_EXIST_SUBSCRIBER			= -6,
 	PUBSUB_NO_EXIST_SUBSCRIBER		= -7,
+	PUBSUB_TIMEOUT				= -8,
 } pubsub_error_t;
 
+/** What to do when the queue of an async subscriber is full */
+typedef enum {
+	PUBSUB_BACKPRESSURE_DROP_NEW,
+	PUBSUB_BACKPRESSURE_DROP_OLDEST,
+	/** The publisher waits up to `timeout_ms` for space, dropping the
+	 * message on timeout */
+	PUBSUB_BACKPRESSURE_BLOCK,
+} pubsub_backpressure_t;
+
+struct pubsub_async_param {
+	/** The number of messages the queue holds */
+	size_t queue_len;
+	pubsub_backpressure_t backpressure;
+	uint32_t timeout_ms;
+};
+
 typedef union {
 #if defined(__amd64__) || defined(__x86_64__) || defined(__aarch64__) \
 	|| defined(__ia64__) || defined(__ppc64__)
@@ -42,6 +60,8 @@ typedef union {
 	long _align;
 } pubsub_subscribe_static_t;
 
+struct lm_buf;
+
 typedef pubsub_subscribe_static_t * pubsub_subscribe_t;
 typedef void (*pubsub_callback_t)(void *context, const void *msg, size_t msglen);
 
@@ -52,6 +72,12 @@ typedef void (*pubsub_callback_t)(void *context, const void *msg, size_t msglen)
  * context of the caller, which takes time to finish all. So a kind of task,
  * such a jobqueue, would help it run in another context.
  *
+ * @note No lock is held while callbacks run. Publishing works on a snapshot
+ *       of the subscriptions taken at the start, so publishers do not block
+ *       each other and callbacks may publish, subscribe or unsubscribe. A
+ *       subscription removed while a publish is under way may still get
+ *       called by that publish.
+ *
  * @param[in] topic is where the message gets publshed to
  * @param[in] msg A message to publish
  * @param[in] msglen The length of the message
@@ -59,6 +85,20 @@ typedef void (*pubsub_callback_t)(void *context, const void *msg, size_t msglen)
  * @return error code in @ref pubsub_error_t
  */
 pubsub_error_t pubsub_publish(const char *topic, const void *msg, size_t msglen);
+/**
+ * @brief Publish a reference counted buffer to a topic without copying
+ *
+ * Async subscribers queue a reference to @p buf rather than a copy of the
+ * data. Callbacks receive lm_buf_data() of @p buf as the message, so they
+ * may keep it by taking a reference to lm_buf_from_data(msg). The same goes
+ * for async callbacks whatever way messages were published.
+ *
+ * @param[in] topic is where the message gets publshed to
+ * @param[in] buf buffer to publish. The caller keeps its own reference
+ *
+ * @return error code in @ref pubsub_error_t
+ */
+pubsub_error_t pubsub_publish_buf(const char *topic, struct lm_buf *buf);
 
 /**
  * @note `topic_filter` should be kept in valid memory space even after
@@ -71,6 +111,56 @@ pubsub_subscribe_t pubsub_subscribe(const char *topic_filter,
 		pubsub_callback_t cb, void *context);
 pubsub_error_t pubsub_unsubscribe(pubsub_subscribe_t handle);
 
+/**
+ * @brief Subscribe to have messages delivered in the subscriber's own context
+ *
+ * A message published is copied once into a reference counted buffer, which
+ * is shared by all the async subscribers of the topic, and queued to each of
+ * them. @p cb is then called by pubsub_dispatch() in the context of the
+ * subscriber, e.g. its own thread, an ao or an actor, so that publishers do
+ * not wait for slow subscribers.
+ *
+ * @note It depends on msgq and its waiter implemented by the port.
+ *
+ * @param[in] topic_filter topic filter as of pubsub_subscribe()
+ * @param[in] cb callback to be called by pubsub_dispatch()
+ * @param[in] context context passed to @p cb
+ * @param[in] param queue length and backpressure policy
+ *
+ * @return subscription handle, or NULL on failure
+ */
+pubsub_subscribe_t pubsub_subscribe_async(const char *topic_filter,
+		pubsub_callback_t cb, void *context,
+		const struct pubsub_async_param *param);
+/**
+ * @brief Deliver the oldest message queued to an async subscriber
+ *
+ * pubsub_unsubscribe() wakes up the calls in progress on @p handle, which
+ * then return @ref PUBSUB_NO_EXIST_SUBSCRIBER. The subscription is freed only
+ * after the last of them has returned, so it is safe to unsubscribe from
+ * another thread while a dispatcher waits here. @p handle must not be passed
+ * again once this returned @ref PUBSUB_NO_EXIST_SUBSCRIBER, nor after
+ * pubsub_unsubscribe() returned with no call in progress.
+ *
+ * @param[in] handle handle returned by pubsub_subscribe_async()
+ * @param[in] timeout_ms time to wait for a message. MSGQ_WAIT_FOREVER to
+ *            wait forever
+ *
+ * @return @ref PUBSUB_SUCCESS when a message is delivered,
+ *         @ref PUBSUB_TIMEOUT when no message arrives in time,
+ *         @ref PUBSUB_NO_EXIST_SUBSCRIBER when unsubscribed
+ */
+pubsub_error_t pubsub_dispatch(pubsub_subscribe_t handle, uint32_t timeout_ms);
+/**
+ * @brief Count the messages dropped for an async subscriber
+ *
+ * @param[in] handle handle returned by pubsub_subscribe_async()
+ *
+ * @return the number of messages dropped by the backpressure policy or on
+ *         allocation failure
+ */
+size_t pubsub_count_dropped(pubsub_subscribe_t handle);
+
 int pubsub_count(const char *topic);
 
 pubsub_error_t pubsub_create(const char *topic);
@@ -9,14 +9,15 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
+#include <errno.h>
 
 #include "libmcu/compiler.h"
 #include "libmcu/assert.h"
-
-#if !defined(PUBSUB_MIN_SUBSCRIPTION_CAPACITY)
-#define PUBSUB_MIN_SUBSCRIPTION_CAPACITY		4
-#endif
+#include "libmcu/atomic.h"
+#include "libmcu/msgq.h"
+#include "libmcu/buf.h"
 
 /* NOTE: It sets the least significant bit of `subscriber->context` to
  * differentiate static subscriber from one created dynamically. */
@@ -27,22 +28,116 @@
 #define GET_CONTEXT_STATIC(ctx)				\
 	(void *)((uintptr_t)(ctx) | 1UL)
 
+#define SUBS_LIST_MIN_CAPACITY				2
+
+/* Levels of a topic hashed once per publish and shared by the branches of
+ * the trie walk. Deeper levels are hashed as they are reached. */
+#if !defined(PUBSUB_TOPIC_CACHED_LEVELS)
+#define PUBSUB_TOPIC_CACHED_LEVELS			8
+#endif
+
 struct subscription {
 	const char *topic_filter;
 	pubsub_callback_t callback;
 	void *context;
-	intptr_t _placeholder_for_compatibility_to_tiny_pubsub;
+	struct subscription *next; /* in order of subscription */
 };
 static_assert(sizeof(struct subscription)
 		== sizeof(pubsub_subscribe_static_t), "");
 
+struct subs_list {
+	const struct subscription **items;
+	size_t length;
+	size_t capacity;
+};
+
+/* A level in the segment trie of topic filters. A filter is indexed at the
+ * node of its last word, or of the word before '#'. */
+struct topic_node {
+	struct topic_node *children; /* literal words */
+	struct topic_node *sibling;
+	struct topic_node *single_level; /* '+' */
+	struct subs_list exact; /* filters ending at this level */
+	struct subs_list multi_level; /* filters followed by '#' */
+	const char *word;
+	size_t len;
+	uint32_t hash;
+};
+
+struct topic_level {
+	const char *word;
+	const char *next; /* NULL if the last level */
+	size_t len;
+	uint32_t hash;
+};
+
+struct topic_levels {
+	size_t nr_cached;
+	struct topic_level cache[PUBSUB_TOPIC_CACHED_LEVELS];
+};
+
+typedef void (*visit_func_t)(const struct subscription *sub, void *arg);
+
+struct async_subscription {
+	struct subscription sub; /* the handle given to the user */
+	pubsub_callback_t callback;
+	void *context;
+	struct msgq *queue;
+	struct msgq_waiter *waiter;
+	pthread_mutex_t lock;
+	pubsub_backpressure_t backpressure;
+	uint32_t timeout_ms;
+	size_t dropped;
+	/* held by the subscription and by each pubsub_dispatch() in progress.
+	 * The last one to drop it frees the subscription */
+	unsigned int refcnt;
+	bool closed; /* unsubscribed, waking up the waiters */
+	struct async_subscription *next_retired;
+};
+
+struct publication {
+	const char *topic;
+	const void *msg;
+	size_t msglen;
+	unsigned int count;
+	/* Shared by all the async subscribers, only the pointer queued. Copied
+	 * on the first of them unless published as a buffer already */
+	struct lm_buf *shared;
+};
+
+/* An immutable index of the subscriptions at a point in time. Publishers
+ * take a reference to the current one and run callbacks with no lock held,
+ * while subscribe and unsubscribe build a new one and swap it in. The last
+ * one to drop the reference frees it. */
+struct snapshot {
+	/* copies of the subscriptions so that the handles can go away while
+	 * the snapshot is still in use. `next` of an entry points to the
+	 * handle it is copied from */
+	struct subscription *entries;
+	size_t nr_entries;
+	struct topic_node root;
+	/* filters with wildcards in the middle of a word, e.g. "a+",
+	 * which are matched one by one */
+	struct subs_list irregular;
+	unsigned int refcnt;
+	/* Swapped in after this one, on which a reference is held so that
+	 * snapshots are freed in order */
+	struct snapshot *successor;
+	/* async subscriptions removed since this one was taken. Freed along
+	 * with this one as no snapshot older than this refers to them */
+	struct async_subscription *retired;
+};
+
 static struct {
 	struct {
-		pthread_mutex_t lock;
-		const struct subscription **pool; // dynamically allocated array
-		uint8_t capacity;
-		uint8_t length;
+		pthread_mutex_t lock; /* serializes subscribe and unsubscribe */
+		struct subscription *list;
+		size_t length;
 	} subscription;
+	struct {
+		pthread_mutex_t lock; /* guards the pointer and references */
+		struct snapshot *current;
+	} snapshot;
 } m;
 
 static void get_next_topic_word(const char **s)
@@ -82,122 +177,503 @@ static bool is_topic_matched_with(const char *filter, const char *topic)
 	return false;
 }
 
-static unsigned int count_subscribers(const char *topic)
+static size_t get_word_len(const char *word)
+{
+	const char *p = word;
+	get_next_topic_word(&p);
+	return (size_t)(p - word);
+}
+
+/* Returns the next word or NULL if @p word is the last one. */
+static const char *get_next_word(const char *word, size_t len)
 {
-	uint8_t count = 0;
+	return word[len] == '/'? &word[len + 1] : NULL;
+}
 
-	for (uint8_t i = 0; i < m.subscription.capacity; i++) {
-		const struct subscription *sub = m.subscription.pool[i];
-		if (sub != NULL &&
-				is_topic_matched_with(sub->topic_filter, topic)) {
-			count++;
+static uint32_t hash_word(const char *word, size_t len)
+{
+	uint32_t hash = 2166136261U; /* FNV-1a */
+
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ (uint8_t)word[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+static bool is_word(const char *word, size_t len, char c)
+{
+	return len == 1 && word[0] == c;
+}
+
+/* Regular filters have wildcards only as a whole word, with '#' only at
+ * the end, so that they can be indexed word by word. */
+static bool is_regular_filter(const char *filter)
+{
+	for (const char *word = filter; word != NULL;) {
+		const size_t len = get_word_len(word);
+		const char *next = get_next_word(word, len);
+
+		if (is_word(word, len, '#')) {
+			return next == NULL;
 		}
+		if (!is_word(word, len, '+') &&
+				(memchr(word, '+', len) || memchr(word, '#', len))) {
+			return false;
+		}
+
+		word = next;
 	}
 
-	return (unsigned int)count;
+	return true;
 }
 
-static size_t copy_subscriptions(const struct subscription **new_subs,
-		const struct subscription **old_subs, size_t n)
+static bool subs_list_add(struct subs_list *list,
+		const struct subscription *sub)
 {
-	size_t count = 0;
+	if (list->length >= list->capacity) {
+		const size_t capacity = list->capacity?
+			list->capacity * 2 : SUBS_LIST_MIN_CAPACITY;
+		const struct subscription **items =
+			(const struct subscription **)realloc(list->items,
+					capacity * sizeof(*items));
+		if (items == NULL) {
+			return false;
+		}
+		list->items = items;
+		list->capacity = capacity;
+	}
+
+	list->items[list->length++] = sub;
+
+	return true;
+}
 
-	for (size_t i = 0; i < n; i++) {
-		if (old_subs[i] != NULL) {
-			new_subs[count++] = old_subs[i];
+static struct topic_node *find_child(const struct topic_node *node,
+		const char *word, size_t len, uint32_t hash)
+{
+	for (struct topic_node *p = node->children; p; p = p->sibling) {
+		if (p->hash == hash && p->len == len &&
+				memcmp(p->word, word, len) == 0) {
+			return p;
 		}
 	}
 
-	return count;
+	return NULL;
 }
 
-static bool expand_subscription_capacity(void)
+static struct topic_node *create_node(const char *word, size_t len)
 {
-	uint8_t capacity = m.subscription.capacity;
-	uint8_t new_capacity = (uint8_t)(capacity * 2U);
-	assert((uint16_t)capacity * 2U < (1U << 8));
+	struct topic_node *node = (struct topic_node *)
+		calloc(1, sizeof(*node) + len);
+
+	if (node != NULL) {
+		memcpy(node + 1, word, len);
+		node->word = (const char *)(node + 1);
+		node->len = len;
+		node->hash = hash_word(word, len);
+	}
 
-	const struct subscription **new_subs = (const struct subscription **)
-		calloc(new_capacity, sizeof(struct subscription *));
-	if (new_subs == NULL) {
-		return false;
+	return node;
+}
+
+static struct topic_node *obtain_child(struct topic_node *node,
+		const char *word, size_t len)
+{
+	struct topic_node **child = &node->single_level;
+
+	if (!is_word(word, len, '+')) {
+		struct topic_node *p =
+			find_child(node, word, len, hash_word(word, len));
+		if (p != NULL) {
+			return p;
+		}
+		child = &node->children;
+	} else if (*child != NULL) {
+		return *child;
 	}
 
-	const struct subscription **old_subs = m.subscription.pool;
-	uint8_t count = (uint8_t)copy_subscriptions(new_subs, old_subs,
-			(size_t)capacity);
-	assert(count < new_capacity);
-	assert(count == m.subscription.length);
+	struct topic_node *new_node = create_node(word, len);
 
-	m.subscription.capacity = new_capacity;
-	m.subscription.pool = new_subs;
-	free(old_subs);
+	if (new_node != NULL) {
+		new_node->sibling = is_word(word, len, '+')? NULL : *child;
+		*child = new_node;
+	}
 
-	PUBSUB_DEBUG("Expanded from %u to %u", capacity, new_capacity);
-	return true;
+	return new_node;
 }
 
-static void shrink_subscription_capacity(void)
+static void free_node(struct topic_node *node)
 {
-	uint8_t capacity = m.subscription.capacity;
-	uint8_t new_capacity = capacity / 2U;
+	while (node->children) {
+		struct topic_node *child = node->children;
+		node->children = child->sibling;
+		free_node(child);
+		free(child);
+	}
 
-	if (capacity <= PUBSUB_MIN_SUBSCRIPTION_CAPACITY) {
-		return;
+	if (node->single_level) {
+		free_node(node->single_level);
+		free(node->single_level);
+	}
+
+	free(node->exact.items);
+	free(node->multi_level.items);
+	*node = (struct topic_node) { 0, };
+}
+
+static bool add_to_index(struct snapshot *snapshot,
+		const struct subscription *sub)
+{
+	struct topic_node *node = &snapshot->root;
+
+	if (!is_regular_filter(sub->topic_filter)) {
+		return subs_list_add(&snapshot->irregular, sub);
+	}
+
+	for (const char *word = sub->topic_filter; word != NULL;) {
+		const size_t len = get_word_len(word);
+		const char *next = get_next_word(word, len);
+
+		if (is_word(word, len, '#')) {
+			return subs_list_add(&node->multi_level, sub);
+		}
+
+		if ((node = obtain_child(node, word, len)) == NULL) {
+			return false;
+		}
+
+		word = next;
+	}
+
+	return subs_list_add(&node->exact, sub);
+}
+
+static void visit_list(const struct subs_list *list,
+		visit_func_t visit, void *arg)
+{
+	for (size_t i = 0; i < list->length; i++) {
+		const struct subscription *sub = list->items[i];
+		if (libmcu_atomic_load_ptr_acquire(&sub->callback,
+				pubsub_callback_t) != NULL) {
+			(*visit)(sub, arg);
+		}
+	}
+}
+
+static void visit_irregular(const struct subs_list *list, const char *topic,
+		visit_func_t visit, void *arg)
+{
+	for (size_t i = 0; i < list->length; i++) {
+		const struct subscription *sub = list->items[i];
+		if (libmcu_atomic_load_ptr_acquire(&sub->callback,
+				pubsub_callback_t) != NULL &&
+				is_topic_matched_with(sub->topic_filter, topic)) {
+			(*visit)(sub, arg);
+		}
+	}
+}
+
+static void get_level(struct topic_level *level, const char *word)
+{
+	level->word = word;
+	level->len = get_word_len(word);
+	level->next = get_next_word(word, level->len);
+	level->hash = hash_word(word, level->len);
+}
+
+/* Levels are reached in order, so the cache fills up one by one. */
+static const struct topic_level *get_cached_level(struct topic_levels *levels,
+		const char *word, size_t depth, struct topic_level *uncached)
+{
+	if (depth >= PUBSUB_TOPIC_CACHED_LEVELS) {
+		get_level(uncached, word);
+		return uncached;
+	}
+
+	if (depth >= levels->nr_cached) {
+		get_level(&levels->cache[depth], word);
+		levels->nr_cached = depth + 1;
 	}
-	if (m.subscription.length * 2U >= capacity) {
+
+	return &levels->cache[depth];
+}
+
+/* Wildcards match only when something is left in the topic, the way
+ * is_topic_matched_with() does: "a/+" and "a/#" do not match "a/" while
+ * "+/b" matches "/b". */
+static bool is_rest_empty(const struct topic_level *level)
+{
+	return level->next == NULL && level->len == 0;
+}
+
+/* Filters indexed are compiled into the trie level by level, so reaching a
+ * list is a match with no need to compare the filter string again.
+ * @p word is NULL when all the words of the topic are consumed. */
+static void visit_node(const struct topic_node *node, const char *word,
+		size_t depth, struct topic_levels *levels,
+		visit_func_t visit, void *arg)
+{
+	struct topic_level uncached;
+
+	if (word == NULL) {
+		visit_list(&node->exact, visit, arg);
 		return;
 	}
 
-	const struct subscription **new_subs = (const struct subscription **)
-		calloc(new_capacity, sizeof(struct subscription *));
-	if (new_subs == NULL) {
+	const struct topic_level *level =
+		get_cached_level(levels, word, depth, &uncached);
+
+	if (is_rest_empty(level)) {
+		const struct topic_node *child =
+			find_child(node, word, 0, level->hash);
+		if (child != NULL) {
+			visit_node(child, NULL, depth + 1, levels, visit, arg);
+		}
 		return;
 	}
 
-	const struct subscription **old_subs = m.subscription.pool;
-	uint8_t count = (uint8_t)copy_subscriptions(new_subs, old_subs,
-			(size_t)capacity);
-	assert(count < new_capacity);
-	assert(count == m.subscription.length);
+	visit_list(&node->multi_level, visit, arg);
 
-	m.subscription.capacity = new_capacity;
-	m.subscription.pool = new_subs;
-	free(old_subs);
+	const struct topic_node *child =
+		find_child(node, word, level->len, level->hash);
 
-	PUBSUB_DEBUG("Shrunken from %u to %u", capacity, new_capacity);
+	if (child != NULL) {
+		visit_node(child, level->next, depth + 1, levels, visit, arg);
+	}
+	if (node->single_level != NULL) {
+		visit_node(node->single_level, level->next, depth + 1,
+				levels, visit, arg);
+	}
 }
 
-static bool register_subscription(const struct subscription *sub)
+static void drain_async(struct async_subscription *async)
 {
-	if (m.subscription.length >= m.subscription.capacity) {
-		if (!expand_subscription_capacity()) {
-			PUBSUB_DEBUG("can't expand");
-			return false;
+	struct lm_buf *msg;
+
+	while (msgq_pop(async->queue, &msg, sizeof(msg))
+			== (int)sizeof(msg)) {
+		lm_buf_unref(msg);
+	}
+}
+
+static void destroy_async(struct async_subscription *async)
+{
+	drain_async(async);
+	msgq_destroy(async->queue);
+	msgq_waiter_destroy(async->waiter);
+	pthread_mutex_destroy(&async->lock);
+	free(async);
+}
+
+static struct async_subscription *get_async(struct async_subscription *async)
+{
+	libmcu_atomic_fetch_add(&async->refcnt, 1);
+	return async;
+}
+
+static void put_async(struct async_subscription *async)
+{
+	if (libmcu_atomic_sub_fetch(&async->refcnt, 1) == 0) {
+		destroy_async(async);
+	}
+}
+
+/* A single notification is enough to wake up all the waiters, as each of
+ * them passes it on to the next one on the way out. */
+static void close_async(struct async_subscription *async)
+{
+	libmcu_atomic_store_release(&async->closed, true);
+	msgq_waiter_notify(async->waiter, MSGQ_EVENT_READABLE);
+	msgq_waiter_notify(async->waiter, MSGQ_EVENT_WRITABLE);
+}
+
+static void destroy_snapshot(struct snapshot *snapshot)
+{
+	while (snapshot->retired) {
+		struct async_subscription *async = snapshot->retired;
+		snapshot->retired = async->next_retired;
+		put_async(async);
+	}
+
+	free_node(&snapshot->root);
+	free(snapshot->irregular.items);
+	free(snapshot->entries);
+	free(snapshot);
+}
+
+static struct snapshot *build_snapshot(void)
+{
+	struct snapshot *snapshot = (struct snapshot *)
+		calloc(1, sizeof(*snapshot));
+
+	if (snapshot == NULL) {
+		return NULL;
+	}
+
+	snapshot->refcnt = 1; /* held by m.snapshot.current */
+
+	if (m.subscription.length == 0) {
+		return snapshot;
+	}
+
+	snapshot->entries = (struct subscription *)
+		calloc(m.subscription.length, sizeof(*snapshot->entries));
+	if (snapshot->entries == NULL) {
+		goto out_err;
+	}
+
+	for (const struct subscription *sub = m.subscription.list;
+			sub; sub = sub->next) {
+		struct subscription *entry =
+			&snapshot->entries[snapshot->nr_entries++];
+		*entry = *sub;
+		entry->next = (struct subscription *)(uintptr_t)sub;
+
+		if (!add_to_index(snapshot, entry)) {
+			goto out_err;
 		}
 	}
 
-	for (uint8_t i = 0; i < m.subscription.capacity; i++) {
-		if (m.subscription.pool[i] == NULL) {
-			m.subscription.pool[i] = sub;
-			m.subscription.length++;
-			PUBSUB_DEBUG("%p added for \"%s\"",
-					sub, sub->topic_filter);
-			return true;
+	return snapshot;
+out_err:
+	destroy_snapshot(snapshot);
+	return NULL;
+}
+
+static struct snapshot *get_snapshot(void)
+{
+	pthread_mutex_lock(&m.snapshot.lock);
+	struct snapshot *snapshot = m.snapshot.current;
+	if (snapshot != NULL) {
+		snapshot->refcnt++;
+	}
+	pthread_mutex_unlock(&m.snapshot.lock);
+
+	return snapshot;
+}
+
+static void put_snapshot(struct snapshot *snapshot)
+{
+	while (snapshot != NULL) {
+		pthread_mutex_lock(&m.snapshot.lock);
+		const unsigned int refcnt = --snapshot->refcnt;
+		pthread_mutex_unlock(&m.snapshot.lock);
+
+		if (refcnt != 0) {
+			break;
+		}
+
+		struct snapshot *successor = snapshot->successor;
+		destroy_snapshot(snapshot);
+		snapshot = successor;
+	}
+}
+
+/* Returns the old one, which the caller should put once done. */
+static struct snapshot *swap_snapshot(struct snapshot *snapshot)
+{
+	pthread_mutex_lock(&m.snapshot.lock);
+	struct snapshot *old = m.snapshot.current;
+	m.snapshot.current = snapshot;
+	if (old != NULL && snapshot != NULL) {
+		old->successor = snapshot;
+		snapshot->refcnt++;
+	}
+	pthread_mutex_unlock(&m.snapshot.lock);
+
+	return old;
+}
+
+static void visit_subscribers(const char *topic, visit_func_t visit, void *arg)
+{
+	struct snapshot *snapshot = get_snapshot();
+
+	if (snapshot != NULL) {
+		struct topic_levels levels = { .nr_cached = 0, };
+
+		visit_node(&snapshot->root, topic, 0, &levels, visit, arg);
+		visit_irregular(&snapshot->irregular, topic, visit, arg);
+		put_snapshot(snapshot);
+	}
+}
+
+static void count_subscriber(const struct subscription *sub, void *arg)
+{
+	unused(sub);
+	((struct publication *)arg)->count++;
+}
+
+static unsigned int count_subscribers(const char *topic)
+{
+	struct publication pub = { .topic = topic, };
+	visit_subscribers(topic, count_subscriber, &pub);
+	return pub.count;
+}
+
+/* Rebuilds the snapshot of the subscriptions and swaps it in, returning the
+ * old one to be put by the caller after unlocking. */
+static bool update_snapshot(struct snapshot **old)
+{
+	struct snapshot *snapshot = build_snapshot();
+
+	if (snapshot == NULL) {
+		return false;
+	}
+
+	*old = swap_snapshot(snapshot);
+
+	return true;
+}
+
+/* Marks the entries copied from @p sub in the current snapshot as removed,
+ * for when no new snapshot can be built. */
+static void remove_from_snapshot(const struct subscription *sub)
+{
+	struct snapshot *snapshot = m.snapshot.current;
+
+	for (size_t i = 0; snapshot && i < snapshot->nr_entries; i++) {
+		struct subscription *entry = &snapshot->entries[i];
+		if (entry->next == sub) {
+			libmcu_atomic_store_ptr_release(&entry->callback,
+					NULL);
 		}
 	}
+}
 
-	assert(0); // can not reach down here
-	return false;
+static bool register_subscription(struct subscription *sub,
+		struct snapshot **old)
+{
+	struct subscription **p = &m.subscription.list;
+	while (*p) {
+		p = &(*p)->next;
+	}
+	sub->next = NULL;
+	*p = sub;
+	m.subscription.length++;
+
+	if (!update_snapshot(old)) {
+		*p = NULL;
+		m.subscription.length--;
+		PUBSUB_DEBUG("can't index \"%s\"", sub->topic_filter);
+		return false;
+	}
+
+	PUBSUB_DEBUG("%p added for \"%s\"", sub, sub->topic_filter);
+	return true;
 }
 
-static bool unregister_subscription(const struct subscription *sub)
+static bool unregister_subscription(struct subscription *sub,
+		struct snapshot **old)
 {
-	for (uint8_t i = 0; i < m.subscription.capacity; i++) {
-		if (m.subscription.pool[i] == sub) {
-			m.subscription.pool[i] = NULL;
+	for (struct subscription **p = &m.subscription.list;
+			*p; p = &(*p)->next) {
+		if (*p == sub) {
+			*p = sub->next;
 			m.subscription.length--;
-			shrink_subscription_capacity();
+			if (!update_snapshot(old)) {
+				remove_from_snapshot(sub);
+			}
 			PUBSUB_DEBUG("%p removed from \"%s\"",
 					sub, sub->topic_filter);
 			return true;
@@ -208,17 +684,139 @@ static bool unregister_subscription(const struct subscription *sub)
 	return false;
 }
 
-static void publish_internal(const char *topic, const void *msg, size_t msglen)
+/* Marks async subscriptions. Never called. */
+static void enqueue_marker(void *context, const void *msg, size_t msglen)
 {
-	for (uint8_t i = 0; i < m.subscription.capacity; i++) {
-		const struct subscription *sub = m.subscription.pool[i];
-		if (sub == NULL) {
-			continue;
+	unused(context);
+	unused(msg);
+	unused(msglen);
+}
+
+static bool is_async(const struct subscription *sub)
+{
+	return sub->callback == enqueue_marker;
+}
+
+static int lock_async(void *ctx)
+{
+	return pthread_mutex_lock(&((struct async_subscription *)ctx)->lock);
+}
+
+static int unlock_async(void *ctx)
+{
+	return pthread_mutex_unlock(&((struct async_subscription *)ctx)->lock);
+}
+
+/* Waits no more once closed, so that neither dispatchers nor publishers are
+ * left blocked on the queue of a subscription gone. */
+static int wait_async(void *ctx, const enum msgq_event event,
+		const uint32_t timeout_ms)
+{
+	struct async_subscription *async = (struct async_subscription *)ctx;
+
+	if (libmcu_atomic_load_acquire(&async->closed)) {
+		msgq_waiter_notify(async->waiter, event);
+		return -ECANCELED;
+	}
+
+	return msgq_waiter_wait(async->waiter, event, timeout_ms);
+}
+
+static void notify_async(void *ctx, const enum msgq_event event)
+{
+	msgq_waiter_notify(((struct async_subscription *)ctx)->waiter, event);
+}
+
+static struct lm_buf *get_shared_message(struct publication *pub)
+{
+	if (pub->shared == NULL) {
+		/* the reference is held by the publisher until done */
+		struct lm_buf *msg = lm_buf_new(pub->msglen);
+
+		if (msg == NULL) {
+			return NULL;
 		}
-		if (is_topic_matched_with(sub->topic_filter, topic)) {
-			sub->callback(GET_SUBSCRIBER_CONTEXT(sub), msg, msglen);
+
+		if (pub->msglen) {
+			memcpy(lm_buf_data(msg), pub->msg, pub->msglen);
 		}
+
+		pub->shared = msg;
+	}
+
+	return lm_buf_ref(pub->shared);
+}
+
+static int push_message(struct async_subscription *async, struct lm_buf *msg)
+{
+	int err;
+
+	switch (async->backpressure) {
+	case PUBSUB_BACKPRESSURE_BLOCK:
+		return msgq_push_timed(async->queue, &msg, sizeof(msg),
+				async->timeout_ms);
+	case PUBSUB_BACKPRESSURE_DROP_OLDEST:
+		while ((err = msgq_push(async->queue, &msg, sizeof(msg)))
+				== -ENOMEM) {
+			struct lm_buf *oldest;
+
+			if (msgq_pop(async->queue, &oldest, sizeof(oldest))
+					!= (int)sizeof(oldest)) {
+				break;
+			}
+
+			lm_buf_unref(oldest);
+			libmcu_atomic_fetch_add(&async->dropped, 1);
+		}
+		return err;
+	case PUBSUB_BACKPRESSURE_DROP_NEW: /* fall through */
+	default:
+		return msgq_push(async->queue, &msg, sizeof(msg));
+	}
+}
+
+static void enqueue(struct async_subscription *async, struct publication *pub)
+{
+	struct lm_buf *msg = get_shared_message(pub);
+
+	if (msg == NULL || push_message(async, msg) != 0) {
+		lm_buf_unref(msg);
+		libmcu_atomic_fetch_add(&async->dropped, 1);
+	}
+}
+
+static void deliver(const struct subscription *sub, void *arg)
+{
+	struct publication *pub = (struct publication *)arg;
+	const pubsub_callback_t callback = libmcu_atomic_load_ptr_acquire(
+			&sub->callback, pubsub_callback_t);
+
+	if (callback == NULL) {
+		return;
+	}
+
+	if (callback == enqueue_marker) {
+		enqueue((struct async_subscription *)
+				GET_SUBSCRIBER_CONTEXT(sub), pub);
+		return;
 	}
+
+	(*callback)(GET_SUBSCRIBER_CONTEXT(sub), pub->msg, pub->msglen);
+}
+
+static void publish_internal(const char *topic, const void *msg, size_t msglen,
+		struct lm_buf *buf)
+{
+	struct publication pub = {
+		.topic = topic,
+		.msg = msg,
+		.msglen = msglen,
+		.shared = buf? lm_buf_ref(buf) : NULL,
+	};
+
+	visit_subscribers(topic, deliver, &pub);
+
+	lm_buf_unref(pub.shared);
 }
 
 static void subscriptions_lock(void)
@@ -231,9 +829,30 @@ static void subscriptions_unlock(void)
 	pthread_mutex_unlock(&m.subscription.lock);
 }
 
+/* Publishers may still be pushing to the queue through the snapshots taken
+ * before, so it is put along with the newest of those. Closing it lets go
+ * of the dispatchers and publishers blocked on it. */
+static void retire_async(struct async_subscription *async,
+		struct snapshot *old)
+{
+	struct snapshot *snapshot = old? old : m.snapshot.current;
+
+	close_async(async);
+	drain_async(async);
+
+	if (snapshot == NULL) {
+		put_async(async);
+		return;
+	}
+
+	async->next_retired = snapshot->retired;
+	snapshot->retired = async;
+}
+
 static struct subscription *subscribe_core(struct subscription *sub,
 		const char *topic_filter, pubsub_callback_t cb, void *context)
 {
+	struct snapshot *old = NULL;
 	bool result = false;
 
 	if ((topic_filter == NULL) || (cb == NULL)) {
@@ -246,10 +865,12 @@ static struct subscription *subscribe_core(struct subscription *sub,
 
 	subscriptions_lock();
 	{
-		result = register_subscription(sub);
+		result = register_subscription(sub, &old);
 	}
 	subscriptions_unlock();
 
+	put_snapshot(old);
+
 	if (!result) {
 		return NULL;
 	}
@@ -277,11 +898,18 @@ pubsub_error_t pubsub_publish(const char *topic, const void *msg, size_t msglen)
 		return PUBSUB_INVALID_PARAM;
 	}
 
-	subscriptions_lock();
-	{
-		publish_internal(topic, msg, msglen);
+	publish_internal(topic, msg, msglen, NULL);
+
+	return PUBSUB_SUCCESS;
+}
+
+pubsub_error_t pubsub_publish_buf(const char *topic, struct lm_buf *buf)
+{
+	if (topic == NULL || buf == NULL) {
+		return PUBSUB_INVALID_PARAM;
 	}
-	subscriptions_unlock();
+
+	publish_internal(topic, lm_buf_data(buf), lm_buf_len(buf), buf);
 
 	return PUBSUB_SUCCESS;
 }
@@ -312,28 +940,130 @@ pubsub_subscribe_t pubsub_subscribe(const char *topic_filter,
 	return (pubsub_subscribe_t)handle;
 }
 
+pubsub_subscribe_t pubsub_subscribe_async(const char *topic_filter,
+		pubsub_callback_t cb, void *context,
+		const struct pubsub_async_param *param)
+{
+	struct async_subscription *async;
+
+	if (cb == NULL || param == NULL || param->queue_len == 0) {
+		return NULL;
+	}
+
+	if ((async = (struct async_subscription *)
+			calloc(1, sizeof(*async))) == NULL) {
+		return NULL;
+	}
+
+	async->callback = cb;
+	async->context = context;
+	async->backpressure = param->backpressure;
+	async->timeout_ms = param->timeout_ms;
+	async->refcnt = 1; /* held by the subscription */
+	pthread_mutex_init(&async->lock, NULL);
+
+	if ((async->queue = msgq_create(msgq_calc_size(param->queue_len,
+			sizeof(struct lm_buf *)))) == NULL ||
+			(async->waiter = msgq_waiter_create()) == NULL) {
+		goto out_err;
+	}
+
+	msgq_set_sync(async->queue, lock_async, unlock_async, async);
+	msgq_set_wait(async->queue, wait_async, notify_async, async);
+
+	if (subscribe_core(&async->sub, topic_filter,
+			enqueue_marker, async) == NULL) {
+		goto out_err;
+	}
+
+	return (pubsub_subscribe_t)&async->sub;
+out_err:
+	msgq_destroy(async->queue);
+	msgq_waiter_destroy(async->waiter);
+	pthread_mutex_destroy(&async->lock);
+	free(async);
+	return NULL;
+}
+
+pubsub_error_t pubsub_dispatch(pubsub_subscribe_t handle, uint32_t timeout_ms)
+{
+	struct subscription *sub = (struct subscription *)handle;
+	pubsub_error_t err = PUBSUB_SUCCESS;
+	struct lm_buf *msg;
+
+	if (sub == NULL || !is_async(sub)) {
+		return PUBSUB_INVALID_PARAM;
+	}
+
+	/* kept until done even if unsubscribed in the meantime */
+	struct async_subscription *async = get_async(
+			(struct async_subscription *)
+			GET_SUBSCRIBER_CONTEXT(sub));
+
+	if (libmcu_atomic_load_acquire(&async->closed)) {
+		err = PUBSUB_NO_EXIST_SUBSCRIBER;
+	} else if (msgq_pop_timed(async->queue, &msg, sizeof(msg), timeout_ms)
+			!= (int)sizeof(msg)) {
+		err = libmcu_atomic_load_acquire(&async->closed)?
+			PUBSUB_NO_EXIST_SUBSCRIBER : PUBSUB_TIMEOUT;
+	} else {
+		(*async->callback)(async->context,
+				lm_buf_data(msg), lm_buf_len(msg));
+		lm_buf_unref(msg);
+	}
+
+	put_async(async);
+
+	return err;
+}
+
+size_t pubsub_count_dropped(pubsub_subscribe_t handle)
+{
+	struct subscription *sub = (struct subscription *)handle;
+
+	if (sub == NULL || !is_async(sub)) {
+		return 0;
+	}
+
+	return libmcu_atomic_load_relaxed(&((struct async_subscription *)
+				GET_SUBSCRIBER_CONTEXT(sub))->dropped);
+}
+
 pubsub_error_t pubsub_unsubscribe(pubsub_subscribe_t handle)
 {
 	struct subscription *sub = (struct subscription *)handle;
+	struct snapshot *old = NULL;
 	bool result = false;
 
 	if (sub == NULL || sub->topic_filter == NULL) {
 		return PUBSUB_INVALID_PARAM;
 	}
 
+	/* async ones are freed along with the snapshot once put */
+	const bool to_free = !IS_SUBSCRIBER_STATIC(sub) && !is_async(sub);
+
 	subscriptions_lock();
 	{
-		result = unregister_subscription(sub);
+		result = unregister_subscription(sub, &old);
+
+		if (result) {
+			PUBSUB_DEBUG("Unsubscribe from \"%s\"",
+					sub->topic_filter);
+		}
+		if (result && is_async(sub)) {
+			retire_async((struct async_subscription *)
+					GET_SUBSCRIBER_CONTEXT(sub), old);
+		}
 	}
 	subscriptions_unlock();
 
+	put_snapshot(old);
+
 	if (!result) {
 		return PUBSUB_NO_EXIST_SUBSCRIBER;
 	}
 
-	PUBSUB_DEBUG("Unsubscribe from \"%s\"", sub->topic_filter);
-
-	if (!IS_SUBSCRIBER_STATIC(sub)) {
+	if (to_free) {
 		free(sub);
 	}
 
@@ -348,11 +1078,7 @@ int pubsub_count(const char *topic)
 		return PUBSUB_INVALID_PARAM;
 	}
 
-	subscriptions_lock();
-	{
-		count = (int)count_subscribers(topic);
-	}
-	subscriptions_unlock();
+	count = (int)count_subscribers(topic);
 
 	return count;
 }
@@ -360,31 +1086,36 @@ int pubsub_count(const char *topic)
 void pubsub_init(void)
 {
 	pthread_mutex_init(&m.subscription.lock, NULL);
+	pthread_mutex_init(&m.snapshot.lock, NULL);
 
+	m.subscription.list = NULL;
 	m.subscription.length = 0;
-	m.subscription.capacity = PUBSUB_MIN_SUBSCRIPTION_CAPACITY;
-	m.subscription.pool = (const struct subscription **)
-		calloc(m.subscription.capacity, sizeof(struct subscription *));
-
-	assert(m.subscription.pool != NULL);
+	m.snapshot.current = NULL;
 }
 
 void pubsub_deinit(void)
 {
 	subscriptions_lock();
 
-	for (uint8_t i = 0; i < m.subscription.capacity; i++) {
-		const struct subscription *sub = m.subscription.pool[i];
-		if (sub == NULL) {
-			continue;
-		}
-		if (!IS_SUBSCRIBER_STATIC(sub)) {
-			intptr_t *p = (intptr_t *)&sub;
-			free((void *)*p);
+	struct subscription *sub = m.subscription.list;
+
+	while (sub != NULL) {
+		struct subscription *next = sub->next;
+		if (is_async(sub)) {
+			struct async_subscription *async =
+				(struct async_subscription *)
+				GET_SUBSCRIBER_CONTEXT(sub);
+			close_async(async);
+			put_async(async);
+		} else if (!IS_SUBSCRIBER_STATIC(sub)) {
+			free(sub);
 		}
+		sub = next;
 	}
 
-	free(m.subscription.pool);
+	m.subscription.list = NULL;
+	m.subscription.length = 0;
+	put_snapshot(swap_snapshot(NULL));
 }
 
 const char *pubsub_stringify_error(pubsub_error_t err)
@@ -406,6 +1137,8 @@ const char *pubsub_stringify_error(pubsub_error_t err)
 		return "exist subscriber";
 	case PUBSUB_NO_EXIST_SUBSCRIBER:
 		return "no exist subscriber";
+	case PUBSUB_TIMEOUT:
+		return "timeout";
 	default:
 		break;
 	}
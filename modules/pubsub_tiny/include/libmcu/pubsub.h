@@ -44,6 +44,7 @@ typedef union {
 
 typedef pubsub_subscribe_static_t * pubsub_subscribe_t;
 typedef void (*pubsub_callback_t)(void *context, const void *msg, size_t msglen);
+typedef struct pubsub_topic *pubsub_topic_handle_t;
 
 /** Publish a message to a topic
  *
@@ -58,6 +59,22 @@ typedef void (*pubsub_callback_t)(void *context, const void *msg, size_t msglen)
  */
 pubsub_error_t pubsub_publish(const char *topic, const void *msg, size_t msglen);
 
+/** Resolve a topic to publish to with no lookup
+ *
+ * Topics are looked up in a hash table keyed on the pointer of their name,
+ * which is cheap already. A hot publisher may still resolve the topic once
+ * and publish with pubsub_publish_handle() afterward.
+ *
+ * @note The handle gets invalid once the topic is destroyed.
+ *
+ * @param topic topic created by pubsub_create()
+ *
+ * @return topic handle, or NULL if no such topic exists
+ */
+pubsub_topic_handle_t pubsub_topic_handle(const char *topic);
+pubsub_error_t pubsub_publish_handle(pubsub_topic_handle_t topic,
+		const void *msg, size_t msglen);
+
 /* NOTE: `topic_filter` must be kept even after registering the subscription
  * because we don't newly allocate memory for the topic filter but use its
  * pointer ever afterward. */
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <pthread.h>
 
 #include "libmcu/list.h"
@@ -17,6 +18,13 @@
 #if !defined(PUBSUB_TOPIC_DESTROY_MESSAGE)
 #define PUBSUB_TOPIC_DESTROY_MESSAGE			"topic destroyed"
 #endif
+/* Must be a power of 2. The table doubles when more than 3/4 full */
+#if !defined(PUBSUB_TOPIC_TABLE_MIN_SIZE)
+#define PUBSUB_TOPIC_TABLE_MIN_SIZE			8
+#endif
+static_assert((PUBSUB_TOPIC_TABLE_MIN_SIZE &
+		(PUBSUB_TOPIC_TABLE_MIN_SIZE - 1)) == 0,
+		"PUBSUB_TOPIC_TABLE_MIN_SIZE must be a power of 2.");
 
 /* NOTE: It sets the least significant bit of `subscriber->context` to
  * differentiate static subscriber from one created dynamically. */
@@ -27,9 +35,8 @@
 #define GET_CONTEXT_STATIC(ctx)				\
 	(void *)((uintptr_t)(ctx) | 1UL)
 
-typedef struct {
+typedef struct pubsub_topic {
 	const char *name;
-	struct list pubsub_node; // list entry for the pubsub_list
 	struct list subscriptions; // list head for subscriptions
 } topic_t;
 
@@ -42,19 +49,101 @@ typedef struct {
 static_assert(sizeof(subscribe_t) == sizeof(pubsub_subscribe_static_t),
 	"The size of public and private subscribe data type must be the same.");
 
+/* Topics are identified by the pointer of their name, which is the key of
+ * the open addressing table with linear probing. */
 static struct {
-	struct list pubsub_list;
+	topic_t **table;
+	size_t capacity;
+	size_t nr_topics;
 	pthread_mutex_t pubsub_list_lock;
 } m;
 
-static void add_topic(topic_t *topic)
+static size_t hash_topic(const char *topic_name, size_t capacity)
+{
+	uintptr_t key = (uintptr_t)topic_name;
+	uint32_t hash = (uint32_t)(key ^ (key >> 16));
+
+	hash *= 0x9e3779b1U;
+	hash ^= hash >> 15;
+
+	return (size_t)hash & (capacity - 1);
+}
+
+static size_t find_slot(topic_t * const *table, size_t capacity,
+		const char *topic_name)
+{
+	size_t i = hash_topic(topic_name, capacity);
+
+	while (table[i] != NULL && table[i]->name != topic_name) {
+		i = (i + 1) & (capacity - 1);
+	}
+
+	return i;
+}
+
+static int resize_table(size_t capacity)
+{
+	topic_t **table = (topic_t **)calloc(capacity, sizeof(*table));
+
+	if (table == NULL) {
+		return PUBSUB_NO_MEMORY;
+	}
+
+	for (size_t i = 0; i < m.capacity; i++) {
+		if (m.table[i] != NULL) {
+			table[find_slot(table, capacity, m.table[i]->name)] =
+				m.table[i];
+		}
+	}
+
+	free(m.table);
+	m.table = table;
+	m.capacity = capacity;
+
+	return PUBSUB_SUCCESS;
+}
+
+static int add_topic(topic_t *topic)
 {
-	list_add(&topic->pubsub_node, &m.pubsub_list);
+	if ((m.nr_topics + 1) * 4 > m.capacity * 3) {
+		const size_t capacity = m.capacity?
+			m.capacity * 2 : PUBSUB_TOPIC_TABLE_MIN_SIZE;
+		int err;
+
+		if ((err = resize_table(capacity)) != PUBSUB_SUCCESS) {
+			return err;
+		}
+	}
+
+	m.table[find_slot(m.table, m.capacity, topic->name)] = topic;
+	m.nr_topics++;
+
+	return PUBSUB_SUCCESS;
 }
 
+/* Shifts back the entries following in the probe sequence so that no
+ * tombstone is left behind. */
 static void remove_topic(const topic_t *topic)
 {
-	list_del(&topic->pubsub_node, &m.pubsub_list);
+	const size_t mask = m.capacity - 1;
+	size_t i = find_slot(m.table, m.capacity, topic->name);
+	size_t j = i;
+
+	m.table[i] = NULL;
+	m.nr_topics--;
+
+	while (m.table[j = (j + 1) & mask] != NULL) {
+		const size_t home = hash_topic(m.table[j]->name, m.capacity);
+
+		/* leave it if its home lies cyclically in (i, j] */
+		if (((j - home) & mask) < ((j - i) & mask)) {
+			continue;
+		}
+
+		m.table[i] = m.table[j];
+		m.table[j] = NULL;
+		i = j;
+	}
 }
 
 static void initialize_subscriptions(topic_t *topic)
@@ -89,19 +178,11 @@ static int count_subscribers(topic_t *topic)
 
 static topic_t *find_topic(const char *topic_name)
 {
-	topic_t *topic = NULL;
-
-	struct list *i;
-	list_for_each(i, &m.pubsub_list) {
-		topic = list_entry(i, topic_t, pubsub_node);
-		if (topic->name == topic_name) {
-			break;
-		} else {
-			topic = NULL;
-		}
+	if (m.table == NULL) {
+		return NULL;
 	}
 
-	return topic;
+	return m.table[find_slot(m.table, m.capacity, topic_name)];
 }
 
 static void publish_internal(const topic_t *topic,
@@ -159,7 +240,7 @@ pubsub_error_t pubsub_create(const char *topic_name)
 {
 	const topic_t *duplicated;
 	topic_t *topic;
-	pubsub_error_t err = PUBSUB_EXIST_TOPIC;
+	int err = PUBSUB_EXIST_TOPIC;
 	size_t topic_len = (topic_name == NULL)? 0 :
 		strnlen(topic_name, PUBSUB_TOPIC_NAME_MAXLEN);
 
@@ -175,18 +256,18 @@ pubsub_error_t pubsub_create(const char *topic_name)
 	pubsub_lock();
 	{
 		if ((duplicated = find_topic(topic_name)) == NULL) {
-			add_topic(topic);
+			err = add_topic(topic);
 		}
 	}
 	pubsub_unlock();
 
-	if (duplicated == NULL) {
+	if (duplicated == NULL && err == PUBSUB_SUCCESS) {
 		PUBSUB_DEBUG("%s topic created", topic->name);
 		return PUBSUB_SUCCESS;
 	}
 
 	free(topic);
-	return err;
+	return (pubsub_error_t)err;
 }
 
 pubsub_error_t pubsub_destroy(const char *topic_name)
@@ -246,6 +327,41 @@ pubsub_error_t pubsub_publish(const char *topic_name,
 	return PUBSUB_SUCCESS;
 }
 
+pubsub_topic_handle_t pubsub_topic_handle(const char *topic_name)
+{
+	topic_t *topic;
+
+	if (topic_name == NULL) {
+		return NULL;
+	}
+
+	pubsub_lock();
+	{
+		topic = find_topic(topic_name);
+	}
+	pubsub_unlock();
+
+	return topic;
+}
+
+pubsub_error_t pubsub_publish_handle(pubsub_topic_handle_t topic,
+		const void *msg, size_t msglen)
+{
+	if (!topic || !msg || !msglen) {
+		return PUBSUB_INVALID_PARAM;
+	}
+
+	pubsub_lock();
+	{
+		publish_internal(topic, msg, msglen);
+	}
+	pubsub_unlock();
+
+	PUBSUB_DEBUG("Publish to %s", topic->name);
+
+	return PUBSUB_SUCCESS;
+}
+
 pubsub_subscribe_t pubsub_subscribe_static(pubsub_subscribe_t handle,
 		const char *topic_name, pubsub_callback_t cb, void *context)
 {
@@ -320,12 +436,18 @@ int pubsub_count(const char *topic_name)
 
 void pubsub_init(void)
 {
-	list_init(&m.pubsub_list);
+	m.table = NULL;
+	m.capacity = 0;
+	m.nr_topics = 0;
 	pthread_mutex_init(&m.pubsub_list_lock, NULL);
 }
 
 void pubsub_deinit(void)
 {
+	free(m.table);
+	m.table = NULL;
+	m.capacity = 0;
+	m.nr_topics = 0;
 }
 
 const char *pubsub_stringify_error(pubsub_error_t err)
@@ -0,0 +1,26 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "libmcu/atomic.h"
+#include "libmcu/compiler.h"
+#include "cmsis_compiler.h"
+
+/* Atomic operations do not nest, so one saved state is enough. Masking
+ * interrupts makes them atomic on a single core only. */
+static uint32_t saved_primask;
+
+LIBMCU_WEAK void libmcu_atomic_lock(void)
+{
+	const uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	saved_primask = primask;
+}
+
+LIBMCU_WEAK void libmcu_atomic_unlock(void)
+{
+	__set_PRIMASK(saved_primask);
+}
@@ -4,7 +4,7 @@
  * SPDX-License-Identifier: MIT
  */
 
-#include "libmcu/metrics.h"
+#include "libmcu/metrics_overrides.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -20,3 +20,8 @@ void metrics_unlock(void)
 {
 	taskEXIT_CRITICAL(&spinlock);
 }
+
+unsigned int metrics_get_shard(void)
+{
+	return (unsigned int)xPortGetCoreID();
+}
@@ -5,10 +5,54 @@
  */
 
 #include "libmcu/logging.h"
+#include "libmcu/logging_overrides.h"
+#include "libmcu/atomic.h"
 #include <pthread.h>
+#include <stdbool.h>
 
 static pthread_mutex_t lock;
 
+static struct {
+	pthread_once_t once;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool pending;
+} drain = {
+	.once = PTHREAD_ONCE_INIT,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void *drain_thread(void *arg)
+{
+	(void)arg;
+
+	while (1) {
+		pthread_mutex_lock(&drain.lock);
+		while (!libmcu_atomic_load_acquire(&drain.pending)) {
+			pthread_cond_wait(&drain.cond, &drain.lock);
+		}
+		pthread_mutex_unlock(&drain.lock);
+
+		/* Cleared before draining so that logs queued from now on
+		 * wake the thread up again unless drained in this pass. */
+		(void)libmcu_atomic_exchange(&drain.pending, false);
+
+		logging_drain(0);
+	}
+
+	return NULL;
+}
+
+static void start_drain_thread(void)
+{
+	pthread_t thread;
+
+	if (pthread_create(&thread, NULL, drain_thread, NULL) == 0) {
+		pthread_detach(thread);
+	}
+}
+
 void logging_lock_init(void)
 {
 	pthread_mutex_init(&lock, NULL);
@@ -23,3 +67,18 @@ void logging_unlock(void)
 {
 	pthread_mutex_unlock(&lock);
 }
+
+/* Only the producer turning the flag on takes the lock to wake the thread
+ * up. The others return right away as a drain is pending anyway. */
+void logging_async_notify(void)
+{
+	if (libmcu_atomic_exchange(&drain.pending, true)) {
+		return;
+	}
+
+	pthread_once(&drain.once, start_drain_thread);
+
+	pthread_mutex_lock(&drain.lock);
+	pthread_cond_signal(&drain.cond);
+	pthread_mutex_unlock(&drain.lock);
+}
@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "libmcu/msgq.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+
+#define NR_EVENTS		2
+
+struct msgq_waiter {
+	pthread_mutex_t lock;
+	pthread_cond_t cond[NR_EVENTS];
+	/* A notification arriving between a failed pop and the wait must not
+	 * get lost, so it is kept even when nobody waits yet. It is a flag
+	 * rather than a count, as every push and pop notifies, which costs at
+	 * most one spurious wakeup instead of one per message. */
+	bool pending[NR_EVENTS];
+};
+
+static void get_deadline(struct timespec *ts, const uint32_t timeout_ms)
+{
+	clock_gettime(CLOCK_MONOTONIC, ts);
+
+	ts->tv_sec += (time_t)(timeout_ms / 1000);
+	ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+int msgq_waiter_wait(void *ctx, const enum msgq_event event,
+		const uint32_t timeout_ms)
+{
+	struct msgq_waiter *waiter = (struct msgq_waiter *)ctx;
+	struct timespec deadline;
+	int err = 0;
+
+	if (timeout_ms != MSGQ_WAIT_FOREVER) {
+		get_deadline(&deadline, timeout_ms);
+	}
+
+	pthread_mutex_lock(&waiter->lock);
+
+	while (!waiter->pending[event] && err == 0) {
+		if (timeout_ms == MSGQ_WAIT_FOREVER) {
+			err = pthread_cond_wait(&waiter->cond[event],
+					&waiter->lock);
+		} else {
+			err = pthread_cond_timedwait(&waiter->cond[event],
+					&waiter->lock, &deadline);
+		}
+	}
+
+	if (waiter->pending[event]) {
+		waiter->pending[event] = false;
+		err = 0;
+	}
+
+	pthread_mutex_unlock(&waiter->lock);
+
+	return err? -ETIMEDOUT : 0;
+}
+
+void msgq_waiter_notify(void *ctx, const enum msgq_event event)
+{
+	struct msgq_waiter *waiter = (struct msgq_waiter *)ctx;
+
+	pthread_mutex_lock(&waiter->lock);
+	waiter->pending[event] = true;
+	pthread_cond_signal(&waiter->cond[event]);
+	pthread_mutex_unlock(&waiter->lock);
+}
+
+struct msgq_waiter *msgq_waiter_create(void)
+{
+	struct msgq_waiter *waiter;
+
+	if ((waiter = (struct msgq_waiter *)calloc(1, sizeof(*waiter)))) {
+		pthread_condattr_t attr;
+
+		/* Timeouts are not to be stretched or cut by wall-clock steps */
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+		pthread_mutex_init(&waiter->lock, NULL);
+
+		for (int i = 0; i < NR_EVENTS; i++) {
+			pthread_cond_init(&waiter->cond[i], &attr);
+		}
+
+		pthread_condattr_destroy(&attr);
+	}
+
+	return waiter;
+}
+
+void msgq_waiter_destroy(struct msgq_waiter *waiter)
+{
+	if (waiter) {
+		for (int i = 0; i < NR_EVENTS; i++) {
+			pthread_cond_destroy(&waiter->cond[i]);
+		}
+
+		pthread_mutex_destroy(&waiter->lock);
+		free(waiter);
+	}
+}
@@ -0,0 +1,18 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "libmcu/atomic.h"
+#include "libmcu/compiler.h"
+
+/* Only for code never preempted in the middle of an atomic operation, e.g.
+ * a single thread not sharing the objects with interrupts. */
+LIBMCU_WEAK void libmcu_atomic_lock(void)
+{
+}
+
+LIBMCU_WEAK void libmcu_atomic_unlock(void)
+{
+}
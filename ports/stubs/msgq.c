@@ -0,0 +1,43 @@
+/*
+ * SPDX-FileCopyrightText: 2026 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "libmcu/msgq.h"
+#include "libmcu/compiler.h"
+#include <errno.h>
+
+struct msgq_waiter {
+	int unused;
+};
+
+LIBMCU_WEAK
+int msgq_waiter_wait(void *ctx, const enum msgq_event event,
+		const uint32_t timeout_ms)
+{
+	unused(ctx);
+	unused(event);
+	unused(timeout_ms);
+	return -ETIMEDOUT;
+}
+
+LIBMCU_WEAK
+void msgq_waiter_notify(void *ctx, const enum msgq_event event)
+{
+	unused(ctx);
+	unused(event);
+}
+
+LIBMCU_WEAK
+struct msgq_waiter *msgq_waiter_create(void)
+{
+	static struct msgq_waiter waiter;
+	return &waiter;
+}
+
+LIBMCU_WEAK
+void msgq_waiter_destroy(struct msgq_waiter *waiter)
+{
+	unused(waiter);
+}
@@ -12,6 +12,10 @@ if (NOT "common" IN_LIST LIBMCU_MODULES)
 	list(APPEND LIBMCU_MODULES common)
 endif()
 
+if ("metrics" IN_LIST LIBMCU_MODULES AND NOT "bitmap" IN_LIST LIBMCU_MODULES)
+	list(APPEND LIBMCU_MODULES bitmap)
+endif()
+
 foreach(module ${LIBMCU_MODULES})
 	file(GLOB LIBMCU_${module}_SRCS
 		${CMAKE_CURRENT_LIST_DIR}/../modules/${module}/src/*.c)
@@ -21,5 +25,10 @@ foreach(module ${LIBMCU_MODULES})
 	list(APPEND LIBMCU_MODULES_INCS_LIST ${LIBMCU_${module}_INCS})
 endforeach()
 
+# Rate limited logging is built only along with the ratelim module
+if (NOT "ratelim" IN_LIST LIBMCU_MODULES)
+	list(FILTER LIBMCU_MODULES_SRCS_LIST EXCLUDE REGEX "/logging_ratelim\\.c$")
+endif()
+
 set(LIBMCU_MODULES_SRCS ${LIBMCU_MODULES_SRCS_LIST})
 set(LIBMCU_MODULES_INCS ${LIBMCU_MODULES_INCS_LIST})
@@ -12,9 +12,19 @@ ifeq ($(filter common, $(LIBMCU_MODULES)),)
 LIBMCU_MODULES += common
 endif
 
+ifneq ($(filter metrics, $(LIBMCU_MODULES)),)
+ifeq ($(filter bitmap, $(LIBMCU_MODULES)),)
+LIBMCU_MODULES += bitmap
+endif
+endif
+
 LIBMCU_MODULES_SRCS := $(foreach d, \
 	$(addprefix $(libmcu-basedir)modules/, $(LIBMCU_MODULES)), \
 	$(shell find $(d)/src -maxdepth 1 -type f -regex ".*\.c"))
+# Rate limited logging is built only along with the ratelim module
+ifeq ($(filter ratelim, $(LIBMCU_MODULES)),)
+LIBMCU_MODULES_SRCS := $(filter-out %/logging_ratelim.c,$(LIBMCU_MODULES_SRCS))
+endif
 ifneq ($(filter ratelim, $(LIBMCU_MODULES)),)
 LIBMCU_RATELIM_PORT ?= posix
 ifneq ($(filter $(LIBMCU_RATELIM_PORT),posix stubs),$(LIBMCU_RATELIM_PORT))
@@ -22,5 +32,11 @@ $(error Unsupported LIBMCU_RATELIM_PORT: $(LIBMCU_RATELIM_PORT))
 endif
 LIBMCU_MODULES_SRCS += $(libmcu-basedir)ports/$(LIBMCU_RATELIM_PORT)/ratelim.c
 endif
+ifneq ($(LIBMCU_ATOMIC_PORT),)
+ifneq ($(filter $(LIBMCU_ATOMIC_PORT),stubs armcm),$(LIBMCU_ATOMIC_PORT))
+$(error Unsupported LIBMCU_ATOMIC_PORT: $(LIBMCU_ATOMIC_PORT))
+endif
+LIBMCU_MODULES_SRCS += $(libmcu-basedir)ports/$(LIBMCU_ATOMIC_PORT)/atomic.c
+endif
 LIBMCU_MODULES_INCS := $(foreach d, $(LIBMCU_MODULES), \
 	$(addprefix $(libmcu-basedir)modules/, $(d))/include)
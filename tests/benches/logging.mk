@@ -0,0 +1,24 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = logging_bench
+
+SRC_FILES = \
+	../modules/logging/src/logging.c \
+	../ports/posix/logging.c \
+
+TEST_SRC_FILES = \
+	src/bench/logging_bench.cpp \
+	src/test_all.cpp \
+	mocks/assert.cpp \
+
+INCLUDE_DIRS = \
+	src/bench \
+	../modules/logging/include \
+	../modules/common/include \
+	$(CPPUTEST_HOME)/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+CPPUTEST_LDFLAGS = -lpthread
+
+include runners/MakefileRunner
@@ -0,0 +1,31 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = metrics_bench
+
+SRC_FILES = \
+	../modules/metrics/src/metrics.c \
+	../modules/metrics/src/metrics_overrides.c \
+	../modules/bitmap/src/bitmap.c \
+
+TEST_SRC_FILES = \
+	src/bench/metrics_bench.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	src/bench \
+	src/metrics \
+	../modules/metrics/include \
+	../modules/bitmap/include \
+	stubs/overrides \
+	../modules/common/include \
+	$(CPPUTEST_HOME)/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = \
+	-DMETRICS_USER_DEFINES=\"my_metrics.def\" \
+	-DLIBMCU_NOINIT= \
+	-DMETRICS_LOCK_FREE \
+	-DMETRICS_SHARDS=8
+CPPUTEST_LDFLAGS = -lpthread
+
+include runners/MakefileRunner
@@ -0,0 +1,30 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = pubsub_bench
+
+SRC_FILES = \
+	../modules/pubsub/src/pubsub.c \
+	../modules/common/src/buf.c \
+	../modules/common/src/msgq.c \
+	../modules/common/src/ringbuf.c \
+	../modules/common/src/bitops.c \
+	../ports/posix/msgq.c \
+	stubs/bitops.c \
+	stubs/board.cpp \
+
+TEST_SRC_FILES = \
+	src/bench/pubsub_bench.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	src/bench \
+	stubs/overrides \
+	../modules/pubsub/include \
+	../modules/common/include \
+	$(CPPUTEST_HOME)/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+CPPUTEST_LDFLAGS = -lpthread
+
+include runners/MakefileRunner
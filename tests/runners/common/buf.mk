@@ -0,0 +1,20 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = buf
+
+SRC_FILES = \
+	../modules/common/src/buf.c \
+
+TEST_SRC_FILES = \
+	src/common/buf_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	../modules/common/include \
+	$(CPPUTEST_HOME)/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+CPPUTEST_LDFLAGS = -lpthread
+
+include runners/MakefileRunner
@@ -0,0 +1,24 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = MessageQueuePosix
+
+SRC_FILES = \
+	../modules/common/src/msgq.c \
+	../modules/common/src/ringbuf.c \
+	../modules/common/src/bitops.c \
+	../ports/posix/msgq.c \
+	stubs/bitops.c \
+
+TEST_SRC_FILES = \
+	src/common/msgq_posix_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	../modules/common/include \
+	$(CPPUTEST_HOME)/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+CPPUTEST_LDFLAGS = -lpthread
+
+include runners/MakefileRunner
@@ -0,0 +1,21 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = ringbuf_spsc
+
+SRC_FILES = \
+	stubs/bitops.c \
+	../modules/common/src/ringbuf.c \
+
+TEST_SRC_FILES = \
+	src/common/ringbuf_spsc_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	../modules/common/include \
+	$(CPPUTEST_HOME)/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DRINGBUF_CACHE_LINE_SIZE=64
+CPPUTEST_LDFLAGS = -lpthread
+
+include runners/MakefileRunner
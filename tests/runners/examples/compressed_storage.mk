@@ -0,0 +1,28 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = compressed_storage
+
+SRC_FILES = \
+	stubs/bitops.c \
+	../examples/compressed_storage.c \
+	../examples/memory_storage.c \
+	../modules/common/src/ringbuf.c \
+	../modules/logging/src/logging.c \
+	../modules/logging/src/logging_overrides.c \
+
+TEST_SRC_FILES = \
+	src/examples/compressed_storage_test.cpp \
+	src/test_all.cpp \
+	mocks/assert.cpp \
+
+INCLUDE_DIRS = \
+	../examples \
+	../modules/common/include \
+	../modules/logging/include \
+	$(CPPUTEST_HOME)/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DLOGGING_MAX_BACKENDS=2
+CPPUTEST_LDFLAGS = -lpthread
+
+include runners/MakefileRunner
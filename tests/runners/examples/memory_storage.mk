@@ -0,0 +1,25 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = memory_storage
+
+SRC_FILES = \
+	stubs/bitops.c \
+	../examples/memory_storage.c \
+	../modules/common/src/ringbuf.c \
+
+TEST_SRC_FILES = \
+	src/examples/memory_storage_test.cpp \
+	src/test_all.cpp \
+	mocks/assert.cpp \
+
+INCLUDE_DIRS = \
+	../examples \
+	../modules/common/include \
+	../modules/logging/include \
+	$(CPPUTEST_HOME)/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+CPPUTEST_LDFLAGS = -lpthread
+
+include runners/MakefileRunner
@@ -8,6 +8,7 @@ SRC_FILES = \
 
 TEST_SRC_FILES = \
 	src/logging/logging_test.cpp \
+	src/logging/logging_compile_level_test.cpp \
 	src/test_all.cpp \
 
 INCLUDE_DIRS = \
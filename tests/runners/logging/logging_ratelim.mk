@@ -0,0 +1,25 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = logging_ratelim
+
+SRC_FILES = \
+	../modules/logging/src/logging.c \
+	../modules/logging/src/logging_overrides.c \
+	../modules/logging/src/logging_ratelim.c \
+	../modules/ratelim/src/ratelim.c \
+
+TEST_SRC_FILES = \
+	src/logging/logging_ratelim_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	stubs/overrides \
+	../modules/logging/include \
+	../modules/ratelim/include \
+	../modules/common/include \
+	$(CPPUTEST_HOME)/include \
+
+CPPUTEST_CPPFLAGS = -DLOGGING_RATELIM_BURST=3 -DLOGGING_RATELIM_PER_MINUTE=1
+MOCKS_SRC_DIRS =
+
+include runners/MakefileRunner
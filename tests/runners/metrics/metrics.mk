@@ -6,15 +6,18 @@ SRC_FILES = \
 	stubs/logging.c \
 	../modules/metrics/src/metrics.c \
 	../modules/metrics/src/metrics_overrides.c \
+	../modules/bitmap/src/bitmap.c \
 
 TEST_SRC_FILES = \
 	src/metrics/test_metrics.cpp \
+	src/metrics/test_metrics_delta.cpp \
 	src/test_all.cpp \
 
 INCLUDE_DIRS = \
 	src/metrics \
 	../modules/logging/include \
 	../modules/metrics/include \
+	../modules/bitmap/include \
 	stubs/overrides \
 	../modules/common/include \
 	$(CPPUTEST_HOME)/include \
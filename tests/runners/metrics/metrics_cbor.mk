@@ -5,6 +5,7 @@ COMPONENT_NAME = metrics_cbor
 SRC_FILES = \
 	stubs/logging.c \
 	../modules/metrics/src/metrics.c \
+	../modules/bitmap/src/bitmap.c \
 	../ports/metrics/cbor_encoder.c \
 	../../cbor/src/common.c \
 	../../cbor/src/encoder.c \
@@ -19,6 +20,7 @@ INCLUDE_DIRS = \
 	src/metrics \
 	../modules/logging/include \
 	../modules/metrics/include \
+	../modules/bitmap/include \
 	../modules/common/include \
 	../../cbor/include \
 	stubs/overrides \
@@ -0,0 +1,28 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = metrics_histogram
+
+SRC_FILES = \
+	../modules/metrics/src/metrics.c \
+	../modules/metrics/src/metrics_overrides.c \
+	../modules/bitmap/src/bitmap.c \
+
+TEST_SRC_FILES = \
+	src/metrics/test_metrics_histogram.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	src/metrics \
+	../modules/metrics/include \
+	../modules/bitmap/include \
+	stubs/overrides \
+	../modules/common/include \
+	$(CPPUTEST_HOME)/include \
+
+CPPUTEST_CPPFLAGS = \
+	-DMETRICS_USER_DEFINES=\"histogram_metrics.def\" \
+	-DLIBMCU_NOINIT=
+
+MOCKS_SRC_DIRS =
+
+include runners/MakefileRunner
@@ -6,6 +6,7 @@ SRC_FILES = \
 	stubs/logging.c \
 	../modules/metrics/src/metrics.c \
 	../modules/metrics/src/metrics_overrides.c \
+	../modules/bitmap/src/bitmap.c \
 
 TEST_SRC_FILES = \
 	src/metrics/test_metrics_schema.cpp \
@@ -15,6 +16,7 @@ INCLUDE_DIRS = \
 	src/metrics \
 	../modules/logging/include \
 	../modules/metrics/include \
+	../modules/bitmap/include \
 	stubs/overrides \
 	../modules/common/include \
 	$(CPPUTEST_HOME)/include \
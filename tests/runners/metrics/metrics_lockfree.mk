@@ -0,0 +1,35 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = metrics_lockfree
+
+SRC_FILES = \
+	stubs/logging.c \
+	../modules/metrics/src/metrics.c \
+	../modules/metrics/src/metrics_overrides.c \
+	../modules/bitmap/src/bitmap.c \
+
+TEST_SRC_FILES = \
+	src/metrics/test_metrics.cpp \
+	src/metrics/test_metrics_delta.cpp \
+	src/metrics/test_metrics_lockfree.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	src/metrics \
+	../modules/logging/include \
+	../modules/metrics/include \
+	../modules/bitmap/include \
+	stubs/overrides \
+	../modules/common/include \
+	$(CPPUTEST_HOME)/include \
+
+CPPUTEST_CPPFLAGS = \
+	-DMETRICS_USER_DEFINES=\"my_metrics.def\" \
+	-DMETRICS_KEY_STRING \
+	-DLIBMCU_NOINIT= \
+	-DMETRICS_LOCK_FREE
+CPPUTEST_LDFLAGS = -lpthread
+
+MOCKS_SRC_DIRS =
+
+include runners/MakefileRunner
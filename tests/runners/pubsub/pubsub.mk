@@ -3,7 +3,14 @@
 COMPONENT_NAME = pubsub
 
 SRC_FILES = \
-	../modules/pubsub/src/pubsub.c
+	../modules/pubsub/src/pubsub.c \
+	../modules/common/src/buf.c \
+	../modules/common/src/msgq.c \
+	../modules/common/src/ringbuf.c \
+	../modules/common/src/bitops.c \
+	../ports/posix/msgq.c \
+	stubs/bitops.c \
+	stubs/board.cpp \
 
 TEST_SRC_FILES = \
 	src/pubsub/pubsub_test.cpp \
@@ -16,6 +23,7 @@ INCLUDE_DIRS = \
 	$(CPPUTEST_HOME)/include \
 
 CPPUTEST_CPPFLAGS = -DPUBSUB_MIN_SUBSCRIPTION_CAPACITY=1
+CPPUTEST_LDFLAGS = -lpthread
 
 MOCKS_SRC_DIRS =
 
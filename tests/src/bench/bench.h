@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_TESTS_BENCH_H
+#define LIBMCU_TESTS_BENCH_H
+
+#include <initializer_list>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_COLUMN_WIDTH		16
+
+static inline uint64_t bench_get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void bench_print_header(std::initializer_list<const char *> cols)
+{
+	printf("\n");
+	for (const char *col : cols) {
+		printf("%*s", BENCH_COLUMN_WIDTH, col);
+	}
+	printf("\n");
+}
+
+/* One row of a table: @p n being what is scaled, e.g. the number of threads,
+ * and @p values the rates measured for it. */
+static inline void bench_print_row(unsigned int n,
+		std::initializer_list<double> values)
+{
+	printf("%*u", BENCH_COLUMN_WIDTH, n);
+	for (double value : values) {
+		printf("%*.0f", BENCH_COLUMN_WIDTH, value);
+	}
+	printf("\n");
+}
+
+#endif /* LIBMCU_TESTS_BENCH_H */
@@ -0,0 +1,134 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libmcu/logging.h"
+#include "bench.h"
+
+#define MAX_THREADS			8
+#define LOGS_PER_THREAD			20000U
+
+static unsigned int last_index[MAX_THREADS];
+static size_t nr_delivered;
+static size_t nr_out_of_order;
+
+static uint32_t get_time_ms(void)
+{
+	return (uint32_t)(bench_get_time_ns() / 1000000U);
+}
+
+/* Called with the logging lock held in sync mode and by the drain thread in
+ * async mode, so no more synchronization is needed here. */
+static size_t check_order(const void *data, size_t datasize)
+{
+	char buf[128];
+	unsigned int id, index;
+
+	logging_stringify(buf, sizeof(buf), data);
+
+	if (sscanf(strrchr(buf, ':') + 2, "%u %u", &id, &index) == 2 &&
+			id < MAX_THREADS) {
+		if (index + 1 <= last_index[id]) {
+			nr_out_of_order++;
+		}
+		last_index[id] = index + 1;
+	}
+
+	__atomic_fetch_add(&nr_delivered, 1, __ATOMIC_RELEASE);
+
+	return datasize;
+}
+
+static const struct logging_backend backend = {
+	.write = check_order,
+};
+
+static void *producer(void *arg)
+{
+	const unsigned int id = (unsigned int)(uintptr_t)arg;
+
+	for (unsigned int i = 0; i < LOGS_PER_THREAD; i++) {
+		info("%u %u", id, i);
+	}
+
+	return NULL;
+}
+
+TEST_GROUP(logging_bench) {
+	uint8_t queue[64 * 1024];
+
+	void setup(void) {
+		logging_init(get_time_ms);
+		logging_add_backend(&backend);
+
+		memset(last_index, 0, sizeof(last_index));
+		nr_delivered = 0;
+		nr_out_of_order = 0;
+	}
+	void teardown(void) {
+		logging_set_async(NULL, 0);
+	}
+
+	double run(unsigned int nr_threads) {
+		pthread_t threads[MAX_THREADS];
+		const uint64_t t0 = bench_get_time_ns();
+
+		for (unsigned int i = 0; i < nr_threads; i++) {
+			pthread_create(&threads[i], NULL,
+					producer, (void *)(uintptr_t)i);
+		}
+		for (unsigned int i = 0; i < nr_threads; i++) {
+			pthread_join(threads[i], NULL);
+		}
+
+		const uint64_t elapsed = bench_get_time_ns() - t0;
+
+		return (double)(nr_threads * LOGS_PER_THREAD) * 1e9
+			/ (double)elapsed;
+	}
+
+	void wait_until_drained(size_t total) {
+		const uint64_t deadline = bench_get_time_ns() + 5000000000ULL;
+
+		while (__atomic_load_n(&nr_delivered, __ATOMIC_ACQUIRE)
+				+ logging_count_dropped() < total &&
+				bench_get_time_ns() < deadline) {
+			sched_yield();
+		}
+	}
+};
+
+TEST(logging_bench, throughput_ShouldScaleWithThreads_WhenAsyncModeEnabled) {
+	bench_print_header({"threads", "sync (logs/s)", "async (logs/s)",
+			"dropped"});
+
+	for (unsigned int n = 1; n <= MAX_THREADS; n *= 2) {
+		const size_t total = n * LOGS_PER_THREAD;
+
+		setup();
+		const double sync_rate = run(n);
+		LONGS_EQUAL(total, nr_delivered);
+
+		setup();
+		LONGS_EQUAL(0, logging_set_async(queue, sizeof(queue)));
+		const double async_rate = run(n);
+		wait_until_drained(total);
+
+		bench_print_row(n, {sync_rate, async_rate,
+				(double)logging_count_dropped()});
+
+		LONGS_EQUAL(total, __atomic_load_n(&nr_delivered,
+					__ATOMIC_ACQUIRE) + logging_count_dropped());
+		LONGS_EQUAL(0, nr_out_of_order);
+		teardown();
+	}
+}
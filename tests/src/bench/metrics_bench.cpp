@@ -0,0 +1,76 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <pthread.h>
+
+#include "libmcu/metrics.h"
+#include "libmcu/metrics_overrides.h"
+#include "bench.h"
+
+#define MAX_THREADS			8
+#define INCREMENTS			1000000
+
+static bool sharded;
+static thread_local unsigned int shard;
+
+unsigned int metrics_get_shard(void)
+{
+	return sharded? shard : 0;
+}
+
+static void *increase(void *arg)
+{
+	shard = (unsigned int)(uintptr_t)arg;
+
+	for (int i = 0; i < INCREMENTS; i++) {
+		metrics_increase(UnexpectedRebootCount);
+	}
+
+	return NULL;
+}
+
+TEST_GROUP(metrics_bench) {
+	void setup(void) {
+		metrics_init(true);
+	}
+	void teardown(void) {
+	}
+
+	double run(unsigned int n) {
+		pthread_t threads[MAX_THREADS];
+
+		metrics_reset();
+
+		const uint64_t t0 = bench_get_time_ns();
+		for (unsigned int i = 0; i < n; i++) {
+			pthread_create(&threads[i], NULL,
+					increase, (void *)(uintptr_t)i);
+		}
+		for (unsigned int i = 0; i < n; i++) {
+			pthread_join(threads[i], NULL);
+		}
+		const uint64_t elapsed = bench_get_time_ns() - t0;
+
+		LONGS_EQUAL(n * INCREMENTS, metrics_get(UnexpectedRebootCount));
+
+		return (double)n * INCREMENTS * 1e9 / (double)elapsed;
+	}
+};
+
+TEST(metrics_bench, increase_ShouldScale_WhenSharded) {
+	bench_print_header({"threads", "shared (ops/s)", "sharded (ops/s)"});
+
+	for (unsigned int n = 1; n <= MAX_THREADS; n *= 2) {
+		sharded = false;
+		const double shared_rate = run(n);
+		sharded = true;
+		const double sharded_rate = run(n);
+
+		bench_print_row(n, {shared_rate, sharded_rate});
+	}
+}
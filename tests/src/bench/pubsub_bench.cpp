@@ -0,0 +1,115 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libmcu/pubsub.h"
+#include "libmcu/buf.h"
+#include "bench.h"
+
+#define MAX_SUBSCRIBERS			64
+#define MESSAGES			20000U
+#define MSGLEN				256U
+#define NR_BUFS				4
+
+static const char *topic = "bench/topic";
+static size_t nr_received;
+
+/* Each subscriber keeps the message for a while the way it would when
+ * handing it over to its own context: a copy of its own, or a reference to
+ * the shared buffer. */
+static void copy_callback(void *context, const void *msg, size_t msglen)
+{
+	void *copy = malloc(msglen);
+	memcpy(copy, msg, msglen);
+	nr_received += ((const uint8_t *)copy)[0] == 0xa5;
+	free(copy);
+}
+
+static void ref_callback(void *context, const void *msg, size_t msglen)
+{
+	struct lm_buf *buf = lm_buf_ref(lm_buf_from_data(msg));
+	nr_received += ((const uint8_t *)lm_buf_data(buf))[0] == 0xa5;
+	lm_buf_unref(buf);
+}
+
+TEST_GROUP(pubsub_bench) {
+	pubsub_subscribe_t subs[MAX_SUBSCRIBERS];
+	uintptr_t mem[NR_BUFS * (sizeof(struct lm_buf) + MSGLEN)
+		/ sizeof(uintptr_t)];
+	struct lm_buf_pool pool;
+
+	void setup(void) {
+		pubsub_init();
+		lm_buf_pool_init(&pool, mem, sizeof(mem), MSGLEN);
+		nr_received = 0;
+	}
+	void teardown(void) {
+		pubsub_deinit();
+	}
+
+	void subscribe(unsigned int n, pubsub_callback_t cb) {
+		for (unsigned int i = 0; i < n; i++) {
+			subs[i] = pubsub_subscribe(topic, cb, NULL);
+		}
+	}
+
+	void unsubscribe(unsigned int n) {
+		for (unsigned int i = 0; i < n; i++) {
+			pubsub_unsubscribe(subs[i]);
+		}
+	}
+
+	double run_copy(unsigned int n) {
+		uint8_t msg[MSGLEN];
+		memset(msg, 0xa5, sizeof(msg));
+
+		subscribe(n, copy_callback);
+		const uint64_t t0 = bench_get_time_ns();
+		for (unsigned int i = 0; i < MESSAGES; i++) {
+			pubsub_publish(topic, msg, sizeof(msg));
+		}
+		const uint64_t elapsed = bench_get_time_ns() - t0;
+		unsubscribe(n);
+
+		return (double)MESSAGES * 1e9 / (double)elapsed;
+	}
+
+	double run_ref(unsigned int n) {
+		subscribe(n, ref_callback);
+		const uint64_t t0 = bench_get_time_ns();
+		for (unsigned int i = 0; i < MESSAGES; i++) {
+			struct lm_buf *buf = lm_buf_alloc(&pool, MSGLEN);
+			memset(lm_buf_data(buf), 0xa5, MSGLEN);
+			pubsub_publish_buf(topic, buf);
+			lm_buf_unref(buf);
+		}
+		const uint64_t elapsed = bench_get_time_ns() - t0;
+		unsubscribe(n);
+
+		return (double)MESSAGES * 1e9 / (double)elapsed;
+	}
+};
+
+TEST(pubsub_bench, fanout_ShouldDeliverAll_WhenCopiedOrReferenced) {
+	bench_print_header({"subscribers", "copy (msgs/s)", "lm_buf (msgs/s)"});
+
+	for (unsigned int n = 1; n <= MAX_SUBSCRIBERS; n *= 2) {
+		nr_received = 0;
+		const double copy_rate = run_copy(n);
+		LONGS_EQUAL(n * MESSAGES, nr_received);
+
+		nr_received = 0;
+		const double ref_rate = run_ref(n);
+		LONGS_EQUAL(n * MESSAGES, nr_received);
+		LONGS_EQUAL(NR_BUFS, lm_buf_pool_available(&pool));
+
+		bench_print_row(n, {copy_rate, ref_rate});
+	}
+}
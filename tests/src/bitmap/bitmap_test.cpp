@@ -86,3 +86,32 @@ TEST(bitmap, clear_ShouldKeepClear_WhenTargetBitIsClear) {
 	bitmap_clear(bitmap, 0);
 	LONGS_EQUAL(false, bitmap_get(bitmap, 0));
 }
+
+TEST(bitmap, find_next_set_ShouldReturnMinusOne_WhenNoBitIsSet) {
+	LONGS_EQUAL(-1, bitmap_find_next_set(bitmap, DEFAULT_BITMAP_LENGTH, 0));
+}
+
+TEST(bitmap, find_next_set_ShouldReturnBitsInOrder_WhenIterated) {
+	const int expected[] = { 0, 5, 63, 64, 99 };
+	int i = 0;
+
+	for (unsigned int j = 0; j < sizeof(expected)/sizeof(*expected); j++) {
+		bitmap_set(bitmap, expected[j]);
+	}
+
+	for (int pos = bitmap_find_next_set(bitmap, DEFAULT_BITMAP_LENGTH, 0);
+			pos >= 0; pos = bitmap_find_next_set(bitmap,
+					DEFAULT_BITMAP_LENGTH, pos + 1)) {
+		LONGS_EQUAL(expected[i++], pos);
+	}
+
+	LONGS_EQUAL(5, i);
+}
+
+TEST(bitmap, find_next_set_ShouldIgnoreBitsBeyondLength) {
+	bitmap_static_t arr[BITMAP_ARRAY_SIZE(DEFAULT_BITMAP_LENGTH)];
+	memset(arr, 0xff, sizeof(arr));
+
+	LONGS_EQUAL(50, bitmap_find_next_set(arr, 60, 50));
+	LONGS_EQUAL(-1, bitmap_find_next_set(arr, 60, 60));
+}
@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <errno.h>
+
+#include "libmcu/buf.h"
+
+#define BUFSIZE				32
+#define NR_BUFS				4
+#define SLOT_SIZE			(sizeof(struct lm_buf) + BUFSIZE)
+
+#define NR_THREADS			4
+#define ROUNDS				20000
+
+TEST_GROUP(buf) {
+	uintptr_t mem[NR_BUFS * SLOT_SIZE / sizeof(uintptr_t)];
+	struct lm_buf_pool pool;
+
+	void setup(void) {
+		LONGS_EQUAL(0, lm_buf_pool_init(&pool, mem, sizeof(mem),
+					BUFSIZE));
+	}
+	void teardown(void) {
+	}
+};
+
+TEST(buf, pool_init_ShouldReturnEinval_WhenNoBufferFits) {
+	LONGS_EQUAL(-EINVAL, lm_buf_pool_init(&pool, mem, SLOT_SIZE - 1,
+				BUFSIZE));
+	LONGS_EQUAL(-EINVAL, lm_buf_pool_init(NULL, mem, sizeof(mem),
+				BUFSIZE));
+}
+
+TEST(buf, alloc_ShouldReturnBuffersUntilPoolRunsOut) {
+	struct lm_buf *bufs[NR_BUFS];
+
+	LONGS_EQUAL(NR_BUFS, lm_buf_pool_available(&pool));
+
+	for (int i = 0; i < NR_BUFS; i++) {
+		bufs[i] = lm_buf_alloc(&pool, BUFSIZE);
+		CHECK(bufs[i] != NULL);
+		LONGS_EQUAL(BUFSIZE, lm_buf_len(bufs[i]));
+	}
+
+	POINTERS_EQUAL(NULL, lm_buf_alloc(&pool, 1));
+	LONGS_EQUAL(0, lm_buf_pool_available(&pool));
+
+	for (int i = 0; i < NR_BUFS; i++) {
+		lm_buf_unref(bufs[i]);
+	}
+	LONGS_EQUAL(NR_BUFS, lm_buf_pool_available(&pool));
+}
+
+TEST(buf, alloc_ShouldReturnNull_WhenLengthExceedsBufferSize) {
+	POINTERS_EQUAL(NULL, lm_buf_alloc(&pool, BUFSIZE + 1));
+}
+
+TEST(buf, unref_ShouldKeepBuffer_UntilLastReferenceDropped) {
+	struct lm_buf *buf = lm_buf_alloc(&pool, 5);
+	memcpy(lm_buf_data(buf), "hello", 5);
+
+	POINTERS_EQUAL(buf, lm_buf_ref(buf));
+	lm_buf_unref(buf);
+	LONGS_EQUAL(NR_BUFS - 1, lm_buf_pool_available(&pool));
+	MEMCMP_EQUAL("hello", lm_buf_data(buf), 5);
+
+	lm_buf_unref(buf);
+	LONGS_EQUAL(NR_BUFS, lm_buf_pool_available(&pool));
+}
+
+TEST(buf, from_data_ShouldReturnBufferHoldingData) {
+	struct lm_buf *buf = lm_buf_alloc(&pool, 1);
+	POINTERS_EQUAL(buf, lm_buf_from_data(lm_buf_data(buf)));
+	lm_buf_unref(buf);
+
+	buf = lm_buf_new(1);
+	POINTERS_EQUAL(buf, lm_buf_from_data(lm_buf_data(buf)));
+	lm_buf_unref(buf);
+}
+
+TEST(buf, new_ShouldReturnNull_WhenAllocationFail) {
+	cpputest_malloc_set_out_of_memory();
+	POINTERS_EQUAL(NULL, lm_buf_new(1));
+	cpputest_malloc_set_not_out_of_memory();
+}
+
+static void *churn(void *arg) {
+	struct lm_buf_pool *pool = (struct lm_buf_pool *)arg;
+	uintptr_t nr_corrupted = 0;
+
+	for (int i = 0; i < ROUNDS; i++) {
+		struct lm_buf *buf = lm_buf_alloc(pool, sizeof(pthread_t));
+		if (buf == NULL) {
+			continue;
+		}
+
+		const pthread_t self = pthread_self();
+		memcpy(lm_buf_data(buf), &self, sizeof(self));
+		lm_buf_ref(buf);
+		lm_buf_unref(buf);
+		if (memcmp(lm_buf_data(buf), &self, sizeof(self)) != 0) {
+			nr_corrupted++;
+		}
+		lm_buf_unref(buf);
+	}
+
+	return (void *)nr_corrupted;
+}
+
+TEST(buf, alloc_ShouldNotHandOutSameBufferTwice_WhenCalledConcurrently) {
+	pthread_t threads[NR_THREADS];
+
+	for (int i = 0; i < NR_THREADS; i++) {
+		pthread_create(&threads[i], NULL, churn, &pool);
+	}
+	for (int i = 0; i < NR_THREADS; i++) {
+		void *nr_corrupted;
+		pthread_join(threads[i], &nr_corrupted);
+		POINTERS_EQUAL(NULL, nr_corrupted);
+	}
+
+	LONGS_EQUAL(NR_BUFS, lm_buf_pool_available(&pool));
+}
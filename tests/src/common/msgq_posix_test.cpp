@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libmcu/msgq.h"
+#include "libmcu/board.h"
+
+uint32_t board_get_time_since_boot_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void *push_later(void *arg) {
+	struct msgq *q = (struct msgq *)arg;
+	usleep(20000);
+	msgq_push(q, "hello", 5);
+	return NULL;
+}
+
+TEST_GROUP(MessageQueuePosix) {
+	struct msgq_waiter *waiter;
+	struct msgq *msgq;
+
+	void setup(void) {
+		waiter = msgq_waiter_create();
+		msgq = msgq_create(64);
+		msgq_set_wait(msgq, msgq_waiter_wait, msgq_waiter_notify,
+				waiter);
+	}
+	void teardown(void) {
+		msgq_destroy(msgq);
+		msgq_waiter_destroy(waiter);
+	}
+};
+
+TEST(MessageQueuePosix, wait_ShouldReturnETIMEDOUT_WhenNotNotified) {
+	const uint32_t t0 = board_get_time_since_boot_ms();
+	LONGS_EQUAL(-ETIMEDOUT,
+			msgq_waiter_wait(waiter, MSGQ_EVENT_READABLE, 20));
+	CHECK(board_get_time_since_boot_ms() - t0 >= 20);
+}
+
+TEST(MessageQueuePosix, wait_ShouldReturnAtOnce_WhenNotifiedBeforeWaiting) {
+	msgq_waiter_notify(waiter, MSGQ_EVENT_READABLE);
+	LONGS_EQUAL(0, msgq_waiter_wait(waiter, MSGQ_EVENT_READABLE,
+				MSGQ_WAIT_FOREVER));
+}
+
+TEST(MessageQueuePosix, wait_ShouldKeepEventsApart) {
+	msgq_waiter_notify(waiter, MSGQ_EVENT_WRITABLE);
+	LONGS_EQUAL(-ETIMEDOUT,
+			msgq_waiter_wait(waiter, MSGQ_EVENT_READABLE, 1));
+	LONGS_EQUAL(0, msgq_waiter_wait(waiter, MSGQ_EVENT_WRITABLE, 1));
+}
+
+TEST(MessageQueuePosix, wait_ShouldWakeOnlyOnce_WhenNotifiedManyTimes) {
+	for (int i = 0; i < 10; i++) {
+		msgq_waiter_notify(waiter, MSGQ_EVENT_READABLE);
+	}
+
+	LONGS_EQUAL(0, msgq_waiter_wait(waiter, MSGQ_EVENT_READABLE, 1));
+	LONGS_EQUAL(-ETIMEDOUT,
+			msgq_waiter_wait(waiter, MSGQ_EVENT_READABLE, 1));
+}
+
+TEST(MessageQueuePosix, pop_timed_ShouldSleepUntilTimeout_WhenPushedAndPoppedBefore) {
+	char buf[8];
+
+	for (int i = 0; i < 10; i++) {
+		LONGS_EQUAL(0, msgq_push(msgq, "hello", 5));
+		LONGS_EQUAL(5, msgq_pop(msgq, buf, sizeof(buf)));
+	}
+
+	LONGS_EQUAL(-ETIMEDOUT, msgq_pop_timed(msgq, buf, sizeof(buf), 20));
+	LONGS_EQUAL(-ETIMEDOUT,
+			msgq_waiter_wait(waiter, MSGQ_EVENT_READABLE, 1));
+}
+
+TEST(MessageQueuePosix, pop_timed_ShouldReturnMessage_WhenPushedFromAnotherThread) {
+	pthread_t thread;
+	char buf[8];
+
+	pthread_create(&thread, NULL, push_later, msgq);
+	LONGS_EQUAL(5, msgq_pop_timed(msgq, buf, sizeof(buf), 1000));
+	MEMCMP_EQUAL("hello", buf, 5);
+	pthread_join(thread, NULL);
+}
@@ -8,6 +8,14 @@
 #include "CppUTest/TestHarness_c.h"
 #include "CppUTestExt/MockSupport.h"
 #include "libmcu/msgq.h"
+#include "libmcu/board.h"
+
+static uint32_t fake_time_ms;
+static struct msgq *waken_by;
+
+uint32_t board_get_time_since_boot_ms(void) {
+	return fake_time_ms;
+}
 
 static int f_lock(void *ctx) {
 	return mock().actualCall(__func__)
@@ -21,12 +29,37 @@ static int f_unlock(void *ctx) {
 		.returnIntValueOrDefault(0);
 }
 
+static int f_wait(void *ctx, const enum msgq_event event,
+		const uint32_t timeout_ms) {
+	int rc = mock().actualCall(__func__)
+		.withParameter("ctx", ctx)
+		.withParameter("event", (int)event)
+		.withParameter("timeout_ms", (unsigned int)timeout_ms)
+		.returnIntValueOrDefault(0);
+	fake_time_ms += 30;
+	if (waken_by && rc == 0) {
+		msgq_set_wait(waken_by, NULL, NULL, NULL);
+		msgq_push(waken_by, "wakeup", 6);
+		msgq_set_wait(waken_by, f_wait, NULL, ctx);
+		waken_by = NULL;
+	}
+	return rc;
+}
+
+static void f_notify(void *ctx, const enum msgq_event event) {
+	mock().actualCall(__func__)
+		.withParameter("ctx", ctx)
+		.withParameter("event", (int)event);
+}
+
 TEST_GROUP(MessageQueue) {
 	struct msgq *msgq;
 	void *sync_ctx;
 
 	void setup(void) {
 		msgq = msgq_create(128);
+		fake_time_ms = 0;
+		waken_by = NULL;
 	}
 	void teardown(void) {
 		msgq_destroy(msgq);
@@ -259,3 +292,353 @@ TEST(MessageQueue, calc_size_ShouldReturnRoundUpToPowerOfTwo) {
 	LONGS_EQUAL(16, msgq_calc_size(1, 8));
 	LONGS_EQUAL(32, msgq_calc_size(1, 9));
 }
+
+TEST(MessageQueue, reserve_ShouldReturnNull_WhenNotEnoughSpace) {
+	POINTERS_EQUAL(NULL, msgq_reserve(msgq, 128));
+}
+
+TEST(MessageQueue, reserve_ShouldPublishMessage_WhenCommitted) {
+	uint8_t *p = (uint8_t *)msgq_reserve(msgq, 16);
+	CHECK(p != NULL);
+	LONGS_EQUAL(0, msgq_len(msgq));
+
+	memcpy(p, "hello", 5);
+	LONGS_EQUAL(0, msgq_commit(msgq, 5));
+	LONGS_EQUAL(5, msgq_next_msg_size(msgq));
+
+	uint8_t buf[16];
+	LONGS_EQUAL(5, msgq_pop(msgq, buf, sizeof(buf)));
+	MEMCMP_EQUAL("hello", buf, 5);
+}
+
+TEST(MessageQueue, reserve_ShouldLeaveQueueEmpty_WhenCanceled) {
+	CHECK(msgq_reserve(msgq, 16) != NULL);
+	msgq_cancel(msgq);
+	LONGS_EQUAL(0, msgq_len(msgq));
+	LONGS_EQUAL(-EINVAL, msgq_commit(msgq, 0));
+}
+
+TEST(MessageQueue, commit_ShouldReturnEINVAL_WhenSizeExceedsReserved) {
+	CHECK(msgq_reserve(msgq, 4) != NULL);
+	LONGS_EQUAL(-EINVAL, msgq_commit(msgq, 5));
+	LONGS_EQUAL(0, msgq_len(msgq));
+}
+
+TEST(MessageQueue, reserve_ShouldHoldLock_UntilCommitted) {
+	mock().expectOneCall("f_lock")
+		.withParameter("ctx", sync_ctx);
+	msgq_set_sync(msgq, f_lock, f_unlock, sync_ctx);
+	CHECK(msgq_reserve(msgq, 8) != NULL);
+	mock().checkExpectations();
+
+	mock().expectOneCall("f_unlock")
+		.withParameter("ctx", sync_ctx);
+	LONGS_EQUAL(0, msgq_commit(msgq, 8));
+}
+
+TEST(MessageQueue, reserve_ShouldReleaseLock_WhenFailed) {
+	mock().expectOneCall("f_lock")
+		.withParameter("ctx", sync_ctx);
+	mock().expectOneCall("f_unlock")
+		.withParameter("ctx", sync_ctx);
+	msgq_set_sync(msgq, f_lock, f_unlock, sync_ctx);
+	POINTERS_EQUAL(NULL, msgq_reserve(msgq, 128));
+}
+
+TEST(MessageQueue, reserve_ShouldPadTail_WhenPayloadWouldWrapAround) {
+	uint8_t buf[128] = { 0, };
+	const size_t meta = sizeof(msgq_msg_meta_t);
+	const size_t first = 128 - meta * 2 - 8; /* leaves meta + 8 at the end */
+
+	msgq_push(msgq, buf, first);
+	msgq_pop(msgq, buf, sizeof(buf));
+
+	uint8_t *p = (uint8_t *)msgq_reserve(msgq, 16);
+	CHECK(p != NULL);
+	memset(p, 0xA5, 16);
+	LONGS_EQUAL(0, msgq_commit(msgq, 16));
+
+	LONGS_EQUAL(16, msgq_next_msg_size(msgq));
+	LONGS_EQUAL(16, msgq_pop(msgq, buf, sizeof(buf)));
+	for (int i = 0; i < 16; i++) {
+		LONGS_EQUAL(0xA5, buf[i]);
+	}
+	LONGS_EQUAL(0, msgq_len(msgq));
+}
+
+TEST(MessageQueue, reserve_ShouldKeepPayloadContiguous_WhenMetaWrapsAround) {
+	uint8_t buf[128] = { 0, };
+	const size_t meta = sizeof(msgq_msg_meta_t);
+	const size_t first = 128 - meta - meta / 2; /* leaves meta / 2 */
+
+	msgq_push(msgq, buf, first);
+	msgq_pop(msgq, buf, sizeof(buf));
+
+	uint8_t *p = (uint8_t *)msgq_reserve(msgq, 5);
+	CHECK(p != NULL);
+	memcpy(p, "hello", 5);
+	LONGS_EQUAL(0, msgq_commit(msgq, 5));
+
+	LONGS_EQUAL(5, msgq_pop(msgq, buf, sizeof(buf)));
+	MEMCMP_EQUAL("hello", buf, 5);
+}
+
+TEST(MessageQueue, push_ShouldInteroperateWithReserve_WhenMixed) {
+	uint8_t buf[128];
+
+	for (int i = 0; i < 64; i++) {
+		uint8_t *p = (uint8_t *)msgq_reserve(msgq, 13);
+		CHECK(p != NULL);
+		memset(p, i, 13);
+		LONGS_EQUAL(0, msgq_commit(msgq, 13));
+		LONGS_EQUAL(0, msgq_push(msgq, "world", 5));
+
+		LONGS_EQUAL(13, msgq_pop(msgq, buf, sizeof(buf)));
+		LONGS_EQUAL(i, buf[12]);
+		LONGS_EQUAL(5, msgq_pop(msgq, buf, sizeof(buf)));
+		MEMCMP_EQUAL("world", buf, 5);
+	}
+}
+
+TEST(MessageQueue, create_compact_ShouldReturnNull_WhenHeaderSizeIsNotSupported) {
+	POINTERS_EQUAL(NULL, msgq_create_compact(128, 0));
+	POINTERS_EQUAL(NULL, msgq_create_compact(128, 3));
+	POINTERS_EQUAL(NULL, msgq_create_compact(128, 8));
+}
+
+TEST(MessageQueue, push_ShouldUseNarrowHeader_WhenCompact) {
+	struct msgq *q = msgq_create_compact(128, 1);
+	LONGS_EQUAL(0, msgq_push(q, "hello", 5));
+	LONGS_EQUAL(6, msgq_len(q));
+	LONGS_EQUAL(5, msgq_next_msg_size(q));
+	msgq_destroy(q);
+
+	q = msgq_create_compact(128, 2);
+	LONGS_EQUAL(0, msgq_push(q, "hello", 5));
+	LONGS_EQUAL(7, msgq_len(q));
+	msgq_destroy(q);
+}
+
+TEST(MessageQueue, push_ShouldReturnEMSGSIZE_WhenMessageDoesNotFitInHeader) {
+	struct msgq *q = msgq_create_compact(256, 1);
+	uint8_t data[128] = { 0, };
+	LONGS_EQUAL(-EMSGSIZE, msgq_push(q, data, 128));
+	LONGS_EQUAL(0, msgq_push(q, data, 127));
+	msgq_destroy(q);
+}
+
+TEST(MessageQueue, push_ShouldKeepPayloadContiguous_WhenCompact) {
+	struct msgq *q = msgq_create_compact(32, 2);
+	uint8_t buf[32] = { 0, };
+
+	for (int i = 0; i < 50; i++) {
+		memset(buf, i, 11);
+		LONGS_EQUAL(0, msgq_push(q, buf, 11));
+
+		size_t size;
+		const uint8_t *p = (const uint8_t *)msgq_peek_pointer(q, &size);
+		CHECK(p != NULL);
+		LONGS_EQUAL(11, size);
+		LONGS_EQUAL(i, p[0]);
+		LONGS_EQUAL(i, p[10]);
+		LONGS_EQUAL(0, msgq_release(q));
+	}
+
+	LONGS_EQUAL(0, msgq_len(q));
+	msgq_destroy(q);
+}
+
+TEST(MessageQueue, push_ShouldRewind_WhenCompactQueueIsEmpty) {
+	struct msgq *q = msgq_create_compact(64, 1);
+	uint8_t buf[64] = { 0, };
+
+	for (int i = 0; i < 2; i++) {
+		LONGS_EQUAL(0, msgq_push(q, buf, 19));
+		LONGS_EQUAL(19, msgq_pop(q, buf, sizeof(buf)));
+	}
+
+	LONGS_EQUAL(0, msgq_push(q, buf, 50));
+	size_t size;
+	CHECK(msgq_peek_pointer(q, &size) != NULL);
+	LONGS_EQUAL(50, size);
+	LONGS_EQUAL(0, msgq_release(q));
+
+	LONGS_EQUAL(0, msgq_push(q, buf, 63));
+	LONGS_EQUAL(63, msgq_pop(q, buf, sizeof(buf)));
+	msgq_destroy(q);
+}
+
+TEST(MessageQueue, peek_pointer_ShouldReturnNull_WhenQueueIsEmpty) {
+	size_t size;
+	POINTERS_EQUAL(NULL, msgq_peek_pointer(msgq, &size));
+	LONGS_EQUAL(-EINVAL, msgq_release(msgq));
+}
+
+TEST(MessageQueue, peek_pointer_ShouldHoldLock_UntilReleased) {
+	msgq_push(msgq, "hello", 5);
+	mock().expectOneCall("f_lock")
+		.withParameter("ctx", sync_ctx);
+	msgq_set_sync(msgq, f_lock, f_unlock, sync_ctx);
+
+	size_t size;
+	const void *p = msgq_peek_pointer(msgq, &size);
+	MEMCMP_EQUAL("hello", p, 5);
+	mock().checkExpectations();
+
+	mock().expectOneCall("f_unlock")
+		.withParameter("ctx", sync_ctx);
+	LONGS_EQUAL(0, msgq_release(msgq));
+	msgq_set_sync(msgq, NULL, NULL, NULL);
+	LONGS_EQUAL(0, msgq_len(msgq));
+}
+
+TEST(MessageQueue, peek_pointer_ShouldReturnNull_WhenPayloadWrapsAround) {
+	uint8_t buf[128] = { 0, };
+	msgq_push(msgq, buf, 128 - sizeof(msgq_msg_meta_t) * 2 - 4);
+	msgq_pop(msgq, buf, sizeof(buf));
+	msgq_push(msgq, "hello world", 11);
+
+	size_t size;
+	POINTERS_EQUAL(NULL, msgq_peek_pointer(msgq, &size));
+	LONGS_EQUAL(11, msgq_pop(msgq, buf, sizeof(buf)));
+}
+
+TEST(MessageQueue, pop_many_ShouldPopMessagesUnderSingleLock) {
+	msgq_push(msgq, "hello", 5);
+	msgq_push(msgq, "world!", 6);
+	msgq_push(msgq, "foo", 3);
+
+	mock().expectOneCall("f_lock")
+		.withParameter("ctx", sync_ctx);
+	mock().expectOneCall("f_unlock")
+		.withParameter("ctx", sync_ctx);
+	msgq_set_sync(msgq, f_lock, f_unlock, sync_ctx);
+
+	uint8_t buf[16];
+	size_t sizes[4];
+	LONGS_EQUAL(2, msgq_pop_many(msgq, buf, 12, sizes, 4));
+	LONGS_EQUAL(5, sizes[0]);
+	LONGS_EQUAL(6, sizes[1]);
+	MEMCMP_EQUAL("helloworld!", buf, 11);
+}
+
+TEST(MessageQueue, pop_many_ShouldReturnENOENT_WhenQueueIsEmpty) {
+	uint8_t buf[16];
+	size_t sizes[4];
+	LONGS_EQUAL(-ENOENT, msgq_pop_many(msgq, buf, sizeof(buf), sizes, 4));
+}
+
+TEST(MessageQueue, pop_many_ShouldStopAtN) {
+	msgq_push(msgq, "a", 1);
+	msgq_push(msgq, "b", 1);
+	msgq_push(msgq, "c", 1);
+
+	uint8_t buf[16];
+	size_t sizes[2];
+	LONGS_EQUAL(2, msgq_pop_many(msgq, buf, sizeof(buf), sizes, 2));
+	MEMCMP_EQUAL("ab", buf, 2);
+	LONGS_EQUAL(1, msgq_next_msg_size(msgq));
+}
+
+TEST(MessageQueue, push_ShouldNotifyReadable_WhenWaitIsSet) {
+	mock().expectOneCall("f_notify")
+		.withParameter("ctx", sync_ctx)
+		.withParameter("event", (int)MSGQ_EVENT_READABLE);
+	msgq_set_wait(msgq, f_wait, f_notify, sync_ctx);
+	LONGS_EQUAL(0, msgq_push(msgq, "hello", 5));
+}
+
+TEST(MessageQueue, pop_ShouldNotifyWritable_WhenMessagePopped) {
+	uint8_t buf[16];
+	msgq_push(msgq, "hello", 5);
+	msgq_set_wait(msgq, f_wait, f_notify, sync_ctx);
+	LONGS_EQUAL(-ERANGE, msgq_pop(msgq, buf, 1));
+
+	mock().expectOneCall("f_notify")
+		.withParameter("ctx", sync_ctx)
+		.withParameter("event", (int)MSGQ_EVENT_WRITABLE);
+	LONGS_EQUAL(5, msgq_pop(msgq, buf, sizeof(buf)));
+}
+
+TEST(MessageQueue, pop_timed_ShouldReturnENOENT_WhenWaitIsNotSet) {
+	uint8_t buf[16];
+	LONGS_EQUAL(-ENOENT, msgq_pop_timed(msgq, buf, sizeof(buf), 100));
+}
+
+TEST(MessageQueue, pop_timed_ShouldReturnMessageWithoutWaiting_WhenAvailable) {
+	uint8_t buf[16];
+	msgq_push(msgq, "hello", 5);
+	msgq_set_wait(msgq, f_wait, NULL, sync_ctx);
+	LONGS_EQUAL(5, msgq_pop_timed(msgq, buf, sizeof(buf), 100));
+}
+
+TEST(MessageQueue, pop_timed_ShouldReturnETIMEDOUT_WhenWaitTimesOut) {
+	uint8_t buf[16];
+	mock().expectOneCall("f_wait")
+		.withParameter("ctx", sync_ctx)
+		.withParameter("event", (int)MSGQ_EVENT_READABLE)
+		.withParameter("timeout_ms", 100U)
+		.andReturnValue(-ETIMEDOUT);
+	msgq_set_wait(msgq, f_wait, NULL, sync_ctx);
+	LONGS_EQUAL(-ETIMEDOUT, msgq_pop_timed(msgq, buf, sizeof(buf), 100));
+}
+
+TEST(MessageQueue, pop_timed_ShouldWaitOnlyForTimeLeft_WhenWokenUpSpuriously) {
+	uint8_t buf[16];
+	const unsigned int expected[] = { 100, 70, 40, 10 };
+	for (size_t i = 0; i < sizeof(expected) / sizeof(*expected); i++) {
+		mock().expectOneCall("f_wait")
+			.withParameter("ctx", sync_ctx)
+			.withParameter("event", (int)MSGQ_EVENT_READABLE)
+			.withParameter("timeout_ms", expected[i]);
+	}
+	msgq_set_wait(msgq, f_wait, NULL, sync_ctx);
+	LONGS_EQUAL(-ETIMEDOUT, msgq_pop_timed(msgq, buf, sizeof(buf), 100));
+}
+
+TEST(MessageQueue, pop_timed_ShouldReturnMessage_WhenPushedWhileWaiting) {
+	uint8_t buf[16];
+	mock().expectOneCall("f_wait")
+		.withParameter("ctx", sync_ctx)
+		.withParameter("event", (int)MSGQ_EVENT_READABLE)
+		.withParameter("timeout_ms", (unsigned int)MSGQ_WAIT_FOREVER);
+	msgq_set_wait(msgq, f_wait, NULL, sync_ctx);
+	waken_by = msgq;
+	LONGS_EQUAL(6, msgq_pop_timed(msgq, buf, sizeof(buf),
+			MSGQ_WAIT_FOREVER));
+	MEMCMP_EQUAL("wakeup", buf, 6);
+}
+
+TEST(MessageQueue, push_timed_ShouldWaitForWritable_WhenQueueIsFull) {
+	uint8_t data[128-sizeof(msgq_msg_meta_t)] = { 0, };
+	msgq_push(msgq, data, sizeof(data));
+
+	mock().expectOneCall("f_wait")
+		.withParameter("ctx", sync_ctx)
+		.withParameter("event", (int)MSGQ_EVENT_WRITABLE)
+		.withParameter("timeout_ms", 10U)
+		.andReturnValue(-ETIMEDOUT);
+	msgq_set_wait(msgq, f_wait, NULL, sync_ctx);
+	LONGS_EQUAL(-ETIMEDOUT, msgq_push_timed(msgq, data, 1, 10));
+}
+
+TEST(MessageQueue, push_timed_ShouldReturnEMSGSIZE_WhenMessageNeverFits) {
+	uint8_t data[128] = { 0, };
+	msgq_set_wait(msgq, f_wait, NULL, sync_ctx);
+	LONGS_EQUAL(-EMSGSIZE, msgq_push_timed(msgq, data, sizeof(data),
+			MSGQ_WAIT_FOREVER));
+	LONGS_EQUAL(-EMSGSIZE, msgq_push(msgq, data,
+			128 - sizeof(msgq_msg_meta_t) + 1));
+	LONGS_EQUAL(0, msgq_push(msgq, data, 128 - sizeof(msgq_msg_meta_t)));
+}
+
+TEST(MessageQueue, push_ShouldKeepFirstError_WhenUnlockFailsAsWell) {
+	uint8_t data[128-sizeof(msgq_msg_meta_t)] = { 0, };
+	msgq_push(msgq, data, sizeof(data));
+
+	mock().expectOneCall("f_lock").withParameter("ctx", sync_ctx);
+	mock().expectOneCall("f_unlock").withParameter("ctx", sync_ctx)
+		.andReturnValue(-EBUSY);
+	msgq_set_sync(msgq, f_lock, f_unlock, sync_ctx);
+	LONGS_EQUAL(-ENOMEM, msgq_push(msgq, data, 1));
+}
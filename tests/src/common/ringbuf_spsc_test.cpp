@@ -0,0 +1,143 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+
+#include "libmcu/ringbuf.h"
+
+#define TOTAL_BYTES			(8UL * 1024 * 1024)
+#define MAX_CHUNK			61
+
+struct spsc_ctx {
+	struct ringbuf *ringbuf;
+	size_t total;
+	size_t mismatches;
+	size_t zerocopy_reads;
+};
+
+static uint8_t expected_byte(size_t seq)
+{
+	return (uint8_t)(seq * 31U + (seq >> 8));
+}
+
+static void *producer(void *arg)
+{
+	struct spsc_ctx *ctx = (struct spsc_ctx *)arg;
+	uint8_t chunk[MAX_CHUNK];
+	size_t seq = 0;
+	size_t chunk_len = 1;
+
+	while (seq < ctx->total) {
+		size_t len = chunk_len;
+		if (len > ctx->total - seq) {
+			len = ctx->total - seq;
+		}
+		for (size_t i = 0; i < len; i++) {
+			chunk[i] = expected_byte(seq + i);
+		}
+
+		size_t written = ringbuf_write(ctx->ringbuf, chunk, len);
+		if (written == 0) {
+			sched_yield();
+			continue;
+		}
+
+		seq += written;
+		chunk_len = chunk_len % MAX_CHUNK + 1;
+	}
+
+	return NULL;
+}
+
+static void *consumer(void *arg)
+{
+	struct spsc_ctx *ctx = (struct spsc_ctx *)arg;
+	uint8_t buf[MAX_CHUNK];
+	size_t seq = 0;
+	size_t chunk_len = MAX_CHUNK;
+
+	while (seq < ctx->total) {
+		size_t n;
+
+		if (seq & 1) { /* alternate between copying and zero-copy */
+			n = ringbuf_read(ctx->ringbuf, 0, buf, chunk_len);
+			for (size_t i = 0; i < n; i++) {
+				if (buf[i] != expected_byte(seq + i)) {
+					ctx->mismatches++;
+				}
+			}
+		} else {
+			const uint8_t *p = (const uint8_t *)
+				ringbuf_peek_pointer(ctx->ringbuf, 0, &n);
+			if (p != NULL) {
+				for (size_t i = 0; i < n; i++) {
+					if (p[i] != expected_byte(seq + i)) {
+						ctx->mismatches++;
+					}
+				}
+				ringbuf_consume(ctx->ringbuf, n);
+				ctx->zerocopy_reads++;
+			} else {
+				n = 0;
+			}
+		}
+
+		if (n == 0) {
+			sched_yield();
+			continue;
+		}
+
+		seq += n;
+		chunk_len = chunk_len > 1? chunk_len - 1 : MAX_CHUNK;
+	}
+
+	return NULL;
+}
+
+TEST_GROUP(RingBufferSPSC) {
+	struct ringbuf ringbuf;
+	uint8_t space[64];
+
+	void setup(void) {
+		ringbuf_create_static(&ringbuf, space, sizeof(space));
+	}
+	void teardown(void) {
+	}
+
+	void run(struct spsc_ctx *ctx) {
+		pthread_t p, c;
+
+		pthread_create(&c, NULL, consumer, ctx);
+		pthread_create(&p, NULL, producer, ctx);
+		pthread_join(p, NULL);
+		pthread_join(c, NULL);
+	}
+};
+
+TEST(RingBufferSPSC, index_ShouldBeOnSeparateCacheLines_WhenPaddedLayoutEnabled) {
+	LONGS_EQUAL(0, offsetof(struct ringbuf, index) % RINGBUF_CACHE_LINE_SIZE);
+	LONGS_EQUAL(0, offsetof(struct ringbuf, outdex) % RINGBUF_CACHE_LINE_SIZE);
+	CHECK(offsetof(struct ringbuf, outdex) - offsetof(struct ringbuf, index)
+			>= RINGBUF_CACHE_LINE_SIZE);
+}
+
+TEST(RingBufferSPSC, ShouldDeliverAllBytesInOrder_WhenProducerAndConsumerRunConcurrently) {
+	struct spsc_ctx ctx = {
+		.ringbuf = &ringbuf,
+		.total = TOTAL_BYTES,
+	};
+
+	run(&ctx);
+
+	LONGS_EQUAL(0, ctx.mismatches);
+	LONGS_EQUAL(0, ringbuf_length(&ringbuf));
+	LONGS_EQUAL(sizeof(space), ringbuf_available(&ringbuf));
+	CHECK(ctx.zerocopy_reads > 0);
+}
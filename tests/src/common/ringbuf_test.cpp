@@ -736,3 +736,141 @@ TEST(RingBuffer, available_ShouldUpdateAfterResize) {
 
 	ringbuf_destroy(handle);
 }
+
+TEST(RingBuffer, reserve_ShouldReturnNull_WhenLengthIsZeroOrExceedsAvailable) {
+	prepare_test();
+	size_t contiguous;
+	POINTERS_EQUAL(NULL, ringbuf_reserve(&ringbuf_obj, 0, &contiguous));
+	POINTERS_EQUAL(NULL, ringbuf_reserve(&ringbuf_obj,
+			SPACE_SIZE + 1, &contiguous));
+}
+
+TEST(RingBuffer, reserve_ShouldNotChangeLength_UntilCommitted) {
+	prepare_test();
+	size_t contiguous;
+	uint8_t *p = (uint8_t *)ringbuf_reserve(&ringbuf_obj, 5, &contiguous);
+	CHECK(p != NULL);
+	LONGS_EQUAL(5, contiguous);
+	LONGS_EQUAL(0, ringbuf_length(&ringbuf_obj));
+
+	memcpy(p, "hello", 5);
+	CHECK_TRUE(ringbuf_commit(&ringbuf_obj, 5));
+	LONGS_EQUAL(5, ringbuf_length(&ringbuf_obj));
+
+	char buf[8];
+	LONGS_EQUAL(5, ringbuf_read(&ringbuf_obj, 0, buf, sizeof(buf)));
+	MEMCMP_EQUAL("hello", buf, 5);
+}
+
+TEST(RingBuffer, reserve_ShouldReturnContiguousSpanUpToEnd_WhenWrapping) {
+	prepare_test();
+	uint8_t tmp[SPACE_SIZE - 3];
+	ringbuf_write(&ringbuf_obj, tmp, sizeof(tmp));
+	ringbuf_consume(&ringbuf_obj, sizeof(tmp));
+
+	size_t contiguous;
+	uint8_t *p = (uint8_t *)ringbuf_reserve(&ringbuf_obj, 5, &contiguous);
+	POINTERS_EQUAL(&ringbuf_space[SPACE_SIZE - 3], p);
+	LONGS_EQUAL(3, contiguous);
+	memcpy(p, "hel", 3);
+	CHECK_TRUE(ringbuf_commit(&ringbuf_obj, 3));
+
+	p = (uint8_t *)ringbuf_reserve(&ringbuf_obj, 2, &contiguous);
+	POINTERS_EQUAL(&ringbuf_space[0], p);
+	LONGS_EQUAL(2, contiguous);
+	memcpy(p, "lo", 2);
+	CHECK_TRUE(ringbuf_commit(&ringbuf_obj, 2));
+
+	char buf[8];
+	LONGS_EQUAL(5, ringbuf_read(&ringbuf_obj, 0, buf, sizeof(buf)));
+	MEMCMP_EQUAL("hello", buf, 5);
+}
+
+TEST(RingBuffer, commit_ShouldReturnFalse_WhenLengthExceedsAvailable) {
+	prepare_test();
+	CHECK_FALSE(ringbuf_commit(&ringbuf_obj, SPACE_SIZE + 1));
+	LONGS_EQUAL(0, ringbuf_length(&ringbuf_obj));
+}
+
+TEST(RingBuffer, writev_ShouldWriteAllSpansAtOnce) {
+	prepare_test();
+	const struct ringbuf_const_iovec iov[] = {
+		{ .base = "hel", .len = 3, },
+		{ .base = "", .len = 0, },
+		{ .base = "lo", .len = 2, },
+	};
+	LONGS_EQUAL(5, ringbuf_writev(&ringbuf_obj, iov, 3));
+	LONGS_EQUAL(5, ringbuf_length(&ringbuf_obj));
+
+	char buf[8];
+	LONGS_EQUAL(5, ringbuf_read(&ringbuf_obj, 0, buf, sizeof(buf)));
+	MEMCMP_EQUAL("hello", buf, 5);
+}
+
+TEST(RingBuffer, writev_ShouldWriteNothing_WhenAllSpansDoNotFit) {
+	prepare_test();
+	uint8_t tmp[SPACE_SIZE - 4];
+	ringbuf_write(&ringbuf_obj, tmp, sizeof(tmp));
+
+	const struct ringbuf_const_iovec iov[] = {
+		{ .base = "hel", .len = 3, },
+		{ .base = "lo", .len = 2, },
+	};
+	LONGS_EQUAL(0, ringbuf_writev(&ringbuf_obj, iov, 2));
+	LONGS_EQUAL(sizeof(tmp), ringbuf_length(&ringbuf_obj));
+}
+
+TEST(RingBuffer, writev_ShouldWrapAround_WhenSpanCrossesEnd) {
+	prepare_test();
+	uint8_t tmp[SPACE_SIZE - 4];
+	ringbuf_write(&ringbuf_obj, tmp, sizeof(tmp));
+	ringbuf_consume(&ringbuf_obj, sizeof(tmp));
+
+	const struct ringbuf_const_iovec iov[] = {
+		{ .base = "hel", .len = 3, },
+		{ .base = "lo world", .len = 8, },
+	};
+	LONGS_EQUAL(11, ringbuf_writev(&ringbuf_obj, iov, 2));
+
+	char buf[16];
+	LONGS_EQUAL(11, ringbuf_read(&ringbuf_obj, 0, buf, sizeof(buf)));
+	MEMCMP_EQUAL("hello world", buf, 11);
+}
+
+TEST(RingBuffer, readv_ShouldFillSpansInOrderAndConsume) {
+	prepare_test();
+	uint8_t tmp[SPACE_SIZE - 4];
+	ringbuf_write(&ringbuf_obj, tmp, sizeof(tmp));
+	ringbuf_consume(&ringbuf_obj, sizeof(tmp));
+	ringbuf_write(&ringbuf_obj, "xxhello world", 13);
+
+	char a[3], b[16];
+	const struct ringbuf_iovec iov[] = {
+		{ .base = a, .len = sizeof(a), },
+		{ .base = b, .len = sizeof(b), },
+	};
+	LONGS_EQUAL(11, ringbuf_readv(&ringbuf_obj, 2, iov, 2));
+	MEMCMP_EQUAL("hel", a, 3);
+	MEMCMP_EQUAL("lo world", b, 8);
+	LONGS_EQUAL(0, ringbuf_length(&ringbuf_obj));
+}
+
+TEST(RingBuffer, readv_ShouldReturnZero_WhenOffsetIsBeyondData) {
+	prepare_test();
+	ringbuf_write(&ringbuf_obj, "hello", 5);
+
+	char buf[8];
+	const struct ringbuf_iovec iov[] = {
+		{ .base = buf, .len = sizeof(buf), },
+	};
+	LONGS_EQUAL(0, ringbuf_readv(&ringbuf_obj, 5, iov, 1));
+	LONGS_EQUAL(5, ringbuf_length(&ringbuf_obj));
+}
+
+TEST(RingBuffer, define_ShouldBeUsableFromCpp) {
+	DEFINE_RINGBUF(rb, 16);
+
+	LONGS_EQUAL(16, ringbuf_capacity(&rb));
+	LONGS_EQUAL(5, ringbuf_write(&rb, "hello", 5));
+	LONGS_EQUAL(5, ringbuf_length(&rb));
+}
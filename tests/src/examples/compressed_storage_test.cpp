@@ -0,0 +1,144 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C" {
+#include "compressed_storage.h"
+#include "memory_storage.h"
+#include <string.h>
+}
+
+#include "libmcu/logging.h"
+
+static uint32_t now;
+
+static uint32_t get_time(void)
+{
+	return now += 7;
+}
+
+static void log_at_other_tag(int i)
+{
+#undef LOGGING_TAG
+#define LOGGING_TAG "other"
+	warn("other tag %d", i);
+}
+
+TEST_GROUP(CompressedStorage) {
+	const struct logging_backend *ops;
+	const struct logging_backend *reference;
+	uint8_t logbuf[512];
+	uint8_t refbuf[512];
+
+	void setup(void) {
+		now = 0;
+		ops = compressed_storage_init(logbuf, sizeof(logbuf));
+		reference = memory_storage_init(refbuf, sizeof(refbuf));
+
+		logging_init(get_time);
+		logging_set_level_global(LOGGING_TYPE_DEBUG);
+		logging_add_backend(ops);
+		logging_add_backend(reference);
+	}
+	void teardown() {
+		logging_remove_backend(ops);
+		logging_remove_backend(reference);
+		logging_set_dictionary(false);
+		compressed_storage_deinit();
+		memory_storage_deinit();
+	}
+
+	void check_same_as_reference(size_t n) {
+		uint8_t expected[LOGGING_MESSAGE_MAXLEN + 64];
+		uint8_t actual[LOGGING_MESSAGE_MAXLEN + 64];
+
+		LONGS_EQUAL(n, logging_count(ops));
+
+		for (size_t i = 0; i < n; i++) {
+			const size_t len = logging_read(reference,
+					expected, sizeof(expected));
+			LONGS_EQUAL(len, logging_peek(ops,
+					actual, sizeof(actual)));
+			LONGS_EQUAL(len, logging_read(ops,
+					actual, sizeof(actual)));
+			MEMCMP_EQUAL(expected, actual, len);
+		}
+
+		LONGS_EQUAL(0, logging_count(ops));
+	}
+};
+
+TEST(CompressedStorage, read_ShouldGiveBackOriginalLogs) {
+	for (int i = 0; i < 3; i++) {
+		info("sensor %d", i);
+		log_at_other_tag(i);
+	}
+	error("done");
+
+	check_same_as_reference(7);
+}
+
+TEST(CompressedStorage, read_ShouldGiveBackOriginalLogs_WhenDictionaryMode) {
+	logging_set_dictionary(true);
+
+	for (int i = 0; i < 3; i++) {
+		info("value %d %s", i, "abc");
+	}
+
+	check_same_as_reference(3);
+}
+
+TEST(CompressedStorage, peek_ShouldNotConsume) {
+	char expected[128];
+	char actual[128];
+	uint8_t log[128];
+
+	info("repeated repeated repeated repeated");
+
+	LONGS_EQUAL(1, logging_count(ops));
+	CHECK(logging_peek(ops, log, sizeof(log)) > 0);
+	logging_stringify(expected, sizeof(expected), log);
+	CHECK(logging_read(ops, log, sizeof(log)) > 0);
+	logging_stringify(actual, sizeof(actual), log);
+
+	STRCMP_EQUAL(expected, actual);
+	STRCMP_CONTAINS("repeated repeated repeated repeated", actual);
+	LONGS_EQUAL(0, logging_count(ops));
+}
+
+TEST(CompressedStorage, read_ShouldReturnZero_WhenBufferTooSmall) {
+	uint8_t log[8];
+
+	info("message");
+
+	LONGS_EQUAL(0, logging_read(ops, log, sizeof(log)));
+	LONGS_EQUAL(1, logging_count(ops));
+}
+
+TEST(CompressedStorage, write_ShouldReturnZero_WhenNotLog) {
+	LONGS_EQUAL(0, ops->write("abc", 3));
+	LONGS_EQUAL(0, ops->count());
+}
+
+TEST(CompressedStorage, write_ShouldKeepMoreLogsThanMemoryStorage) {
+	for (int i = 0; i < 100; i++) {
+		info("temperature=%d humidity=%d", 20 + i % 3, 40 + i % 5);
+	}
+
+	const size_t nr_compressed = logging_count(ops);
+	const size_t nr_plain = logging_count(reference);
+
+	CHECK(nr_compressed >= nr_plain * 2);
+}
+
+TEST(CompressedStorage, read_ShouldGiveBackOriginalLogs_WhenWrappedAround) {
+	for (int i = 0; i < 200; i++) {
+		info("sensor %d", i);
+		log_at_other_tag(i);
+		check_same_as_reference(2);
+	}
+}
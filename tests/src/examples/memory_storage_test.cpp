@@ -0,0 +1,227 @@
+/*
+ * SPDX-FileCopyrightText: 2020 Kyunghwan Kwon <k@mononn.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C" {
+#include "memory_storage.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+}
+
+TEST_GROUP(MemoryStorage) {
+	const struct logging_backend *ops;
+	uint8_t logbuf[64];
+
+	void setup(void) {
+		memset(logbuf, 0, sizeof(logbuf));
+		ops = memory_storage_init(logbuf, sizeof(logbuf));
+	}
+	void teardown() {
+		memory_storage_deinit();
+	}
+};
+
+TEST(MemoryStorage, init_ShouldReturnOps) {
+	CHECK(ops->write);
+	CHECK(ops->read);
+	CHECK(ops->consume);
+	CHECK(ops->count);
+}
+
+TEST(MemoryStorage, write_ShouldReturnSizeWritten_WhenEnoughSpaceLeft) {
+	const char *fixed_data = "12345678901234567890123456789012";
+	size_t data_size = strlen(fixed_data);
+	char buf[sizeof(logbuf)];
+	for (size_t i = 0; i < data_size; i++) {
+		CHECK_EQUAL(data_size, ops->write(fixed_data, data_size));
+		memset(buf, 0, sizeof(buf));
+		CHECK_EQUAL(data_size, ops->peek(buf, data_size));
+		MEMCMP_EQUAL(fixed_data, buf, data_size);
+		CHECK_EQUAL(data_size, ops->consume(data_size));
+	}
+}
+
+TEST(MemoryStorage, write_ShouldReturnZero_WhenNoSpaceLeft) {
+	CHECK_EQUAL(0, ops->write(logbuf, sizeof(logbuf)));
+}
+
+TEST(MemoryStorage, write_ShouldReturnZero_WhenNoEnoughSpaceLeft) {
+	size_t bytes_to_write = sizeof(logbuf) / 2;
+	size_t left_bytes = sizeof(logbuf) - (sizeof(size_t) + bytes_to_write);
+	CHECK_EQUAL(bytes_to_write, ops->write(logbuf, bytes_to_write));
+	CHECK_EQUAL(0, ops->write(logbuf, left_bytes-sizeof(size_t)+1));
+	CHECK_EQUAL(left_bytes - sizeof(size_t), ops->write(logbuf, left_bytes-sizeof(size_t)));
+}
+
+TEST(MemoryStorage, read_ShouldReturnZero_WhenNoDataIsThere) {
+	char buf[sizeof(logbuf)];
+	CHECK_EQUAL(0, ops->read(buf, sizeof(buf)));
+}
+
+TEST(MemoryStorage, read_ShouldReturnSizeRead_WhenItHasData) {
+	const char *fixed_data = "12345678901234567890123456789012";
+	size_t data_size = strlen(fixed_data);
+	char buf[sizeof(logbuf)];
+	CHECK_EQUAL(data_size, ops->write(fixed_data, data_size));
+	CHECK_EQUAL(data_size, ops->read(buf, sizeof(buf)));
+	MEMCMP_EQUAL(fixed_data, buf, data_size);
+}
+
+TEST(MemoryStorage, count_ShouldReturnZero_WhenNoDataIsThere) {
+	CHECK_EQUAL(0, ops->count());
+}
+
+TEST(MemoryStorage, count_ShouldReturnNumberOfDataWritten) {
+	const char *fixed_data = "123";
+	size_t data_size = strlen(fixed_data);
+	CHECK_EQUAL(data_size, ops->write(fixed_data, data_size));
+	CHECK_EQUAL(1, ops->count());
+	CHECK_EQUAL(data_size, ops->write(fixed_data, data_size));
+	CHECK_EQUAL(2, ops->count());
+	CHECK_EQUAL(data_size, ops->write(fixed_data, data_size));
+	CHECK_EQUAL(3, ops->count());
+}
+
+TEST(MemoryStorage, consume_ShouldReturnZero_WhenNoData) {
+	CHECK_EQUAL(0, ops->consume(1));
+}
+
+TEST(MemoryStorage, consume_ShouldReturnSizeConsumed) {
+	const char *fixed_data = "123";
+	size_t data_size = strlen(fixed_data);
+	CHECK_EQUAL(data_size, ops->write(fixed_data, data_size));
+	CHECK_EQUAL(1, ops->count());
+	CHECK_EQUAL(data_size, ops->consume(data_size));
+	CHECK_EQUAL(0, ops->count());
+}
+
+TEST(MemoryStorage, write_batch_ShouldWriteAllLogsInOrder) {
+	const struct logging_record logs[] = {
+		{ .data = "abc", .size = 3, },
+		{ .data = "defg", .size = 4, },
+		{ .data = "hi", .size = 2, },
+	};
+	char buf[sizeof(logbuf)];
+
+	CHECK_EQUAL(3, ops->write_batch(logs, 3));
+	CHECK_EQUAL(3, ops->count());
+
+	for (size_t i = 0; i < 3; i++) {
+		CHECK_EQUAL(logs[i].size, ops->read(buf, sizeof(buf)));
+		MEMCMP_EQUAL(logs[i].data, buf, logs[i].size);
+	}
+}
+
+TEST(MemoryStorage, write_batch_ShouldWriteAsManyAsFit_WhenNotEnoughSpaceForAll) {
+	const struct logging_record log = { .data = "0123456789", .size = 10, };
+	const struct logging_record logs[] = { log, log, log, log, log, };
+	const size_t fit = sizeof(logbuf) / (sizeof(size_t) + log.size);
+
+	CHECK_EQUAL(fit, ops->write_batch(logs, 5));
+	CHECK_EQUAL(fit, ops->count());
+}
+
+TEST(MemoryStorage, cursor_ShouldReadAllLogsIndependently) {
+	struct logging_cursor cli, cloud;
+	char buf[sizeof(logbuf)];
+
+	cli = (struct logging_cursor) { .name = "cli", };
+	cloud = (struct logging_cursor) { .name = "cloud", };
+	CHECK_EQUAL(0, ops->open_cursor(&cli));
+	CHECK_EQUAL(0, ops->open_cursor(&cloud));
+
+	CHECK_EQUAL(3, ops->write("abc", 3));
+	CHECK_EQUAL(4, ops->write("defg", 4));
+	CHECK_EQUAL(2, ops->count_cursor(&cli));
+	CHECK_EQUAL(2, ops->count_cursor(&cloud));
+
+	CHECK_EQUAL(3, ops->peek_cursor(&cli, buf, sizeof(buf)));
+	MEMCMP_EQUAL("abc", buf, 3);
+	CHECK_EQUAL(3, ops->consume_cursor(&cli));
+	CHECK_EQUAL(4, ops->peek_cursor(&cli, buf, sizeof(buf)));
+	MEMCMP_EQUAL("defg", buf, 4);
+	CHECK_EQUAL(4, ops->consume_cursor(&cli));
+	CHECK_EQUAL(0, ops->count_cursor(&cli));
+	CHECK_EQUAL(0, ops->consume_cursor(&cli));
+
+	CHECK_EQUAL(3, ops->peek_cursor(&cloud, buf, sizeof(buf)));
+	MEMCMP_EQUAL("abc", buf, 3);
+
+	ops->close_cursor(&cli);
+	ops->close_cursor(&cloud);
+}
+
+TEST(MemoryStorage, cursor_ShouldReclaimSpace_WhenSlowestCursorMovedPast) {
+	struct logging_cursor fast = { .name = "fast", };
+	struct logging_cursor slow = { .name = "slow", };
+
+	CHECK_EQUAL(0, ops->open_cursor(&fast));
+	CHECK_EQUAL(0, ops->open_cursor(&slow));
+	CHECK_EQUAL(3, ops->write("abc", 3));
+	CHECK_EQUAL(3, ops->write("def", 3));
+
+	ops->consume_cursor(&fast);
+	ops->consume_cursor(&fast);
+	CHECK_EQUAL(2, ops->count());
+
+	ops->consume_cursor(&slow);
+	CHECK_EQUAL(1, ops->count());
+	ops->close_cursor(&slow);
+	CHECK_EQUAL(0, ops->count());
+
+	ops->close_cursor(&fast);
+}
+
+TEST(MemoryStorage, cursor_ShouldNotWrite_WhenSlowestCursorKeepsStorageFull) {
+	struct logging_cursor cursor = { .name = "slow", };
+	const char *fixed_data = "0123456789";
+	const size_t fit = sizeof(logbuf) / (sizeof(size_t) + 10);
+
+	CHECK_EQUAL(0, ops->open_cursor(&cursor));
+	for (size_t i = 0; i < fit; i++) {
+		CHECK_EQUAL(10, ops->write(fixed_data, 10));
+	}
+	CHECK_EQUAL(0, ops->write(fixed_data, 10));
+	CHECK_EQUAL(fit, ops->count_cursor(&cursor));
+	CHECK_EQUAL(0, cursor.missed);
+
+	ops->consume_cursor(&cursor);
+	CHECK_EQUAL(10, ops->write(fixed_data, 10));
+
+	ops->close_cursor(&cursor);
+}
+
+TEST(MemoryStorage, cursor_ShouldCountMissedLogs_WhenOldestDropped) {
+	struct logging_cursor cursor = { .name = "slow", };
+	char buf[sizeof(logbuf)];
+	const size_t fit = sizeof(logbuf) / (sizeof(size_t) + 10);
+
+	memory_storage_set_drop_oldest(true);
+	CHECK_EQUAL(0, ops->open_cursor(&cursor));
+	for (size_t i = 0; i < fit + 2; i++) {
+		snprintf(buf, sizeof(buf), "%010zu", i);
+		CHECK_EQUAL(10, ops->write(buf, 10));
+	}
+
+	CHECK_EQUAL(2, cursor.missed);
+	CHECK_EQUAL(fit, ops->count_cursor(&cursor));
+	CHECK_EQUAL(10, ops->peek_cursor(&cursor, buf, sizeof(buf)));
+	MEMCMP_EQUAL("0000000002", buf, 10);
+
+	ops->close_cursor(&cursor);
+}
+
+TEST(MemoryStorage, open_cursor_ShouldReturnEEXIST_WhenNameInUse) {
+	struct logging_cursor a = { .name = "cli", };
+	struct logging_cursor b = { .name = "cli", };
+
+	CHECK_EQUAL(0, ops->open_cursor(&a));
+	CHECK_EQUAL(-EEXIST, ops->open_cursor(&b));
+
+	ops->close_cursor(&a);
+}
@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#define LOGGING_COMPILE_MIN_LEVEL		2
+#include "libmcu/logging.h"
+
+static const char *TAG = "compile_level";
+
+static int nr_evaluated;
+static size_t nr_written;
+
+static int evaluate(void) {
+	return ++nr_evaluated;
+}
+
+static size_t count_write(const void *data, size_t datasize) {
+	(void)data;
+	nr_written++;
+	return datasize;
+}
+
+static const struct logging_backend backend = {
+	.write = count_write,
+};
+
+TEST_GROUP(logging_compile_level) {
+	void setup(void) {
+		logging_init(NULL);
+		logging_add_backend(&backend);
+
+		nr_evaluated = 0;
+		nr_written = 0;
+	}
+	void teardown(void) {
+	}
+};
+
+TEST(logging_compile_level, ShouldRemoveLogs_WhenBelowCompileMinLevel) {
+	debug("%d", evaluate());
+	info("%d", evaluate());
+
+	LONGS_EQUAL(0, nr_evaluated);
+	LONGS_EQUAL(0, nr_written);
+}
+
+TEST(logging_compile_level, ShouldKeepLogs_WhenAtOrAboveCompileMinLevel) {
+	warn("%d", evaluate());
+	error("%d", evaluate());
+
+	LONGS_EQUAL(2, nr_evaluated);
+	LONGS_EQUAL(2, nr_written);
+}
@@ -0,0 +1,118 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+
+#include "libmcu/logging_ratelim.h"
+
+/* Expands to a call site of its own at each use, as the state of a call
+ * site outlives a test. */
+#define burst(type, n) do {						\
+	for (int _i = 0; _i < (n); _i++) {				\
+		LOGGING_RATELIMITED(type, "timeout %d", evaluate(_i));	\
+	}								\
+} while (0)
+
+static ratelim_time_t now;
+static size_t nr_written;
+static char logs[16][128];
+static int nr_evaluated;
+
+ratelim_time_t ratelim_get_time_seconds(void)
+{
+	return now;
+}
+
+static size_t backend_write(const void *data, size_t datasize)
+{
+	if (nr_written < sizeof(logs) / sizeof(*logs)) {
+		logging_stringify(logs[nr_written], sizeof(*logs), data);
+	}
+	nr_written++;
+	return datasize;
+}
+
+static const struct logging_backend backend = {
+	.write = backend_write,
+};
+
+static int evaluate(int v)
+{
+	nr_evaluated++;
+	return v;
+}
+
+TEST_GROUP(logging_ratelim) {
+	void setup(void) {
+		nr_written = 0;
+		nr_evaluated = 0;
+		memset(logs, 0, sizeof(logs));
+
+		logging_init(NULL);
+		logging_set_level_global(LOGGING_TYPE_INFO);
+		logging_add_backend(&backend);
+	}
+	void teardown(void) {
+	}
+};
+
+TEST(logging_ratelim, ShouldSuppressLogsOverBurst) {
+	burst(LOGGING_TYPE_ERROR, 10);
+	LONGS_EQUAL(3, nr_written);
+	STRCMP_CONTAINS("timeout 2", logs[2]);
+}
+
+TEST(logging_ratelim, ShouldNotEvaluateArguments_WhenSuppressed) {
+	burst(LOGGING_TYPE_ERROR, 10);
+	LONGS_EQUAL(3, nr_evaluated);
+}
+
+TEST(logging_ratelim, ShouldCollapseSuppressedLogs_WhenLetThroughAgain) {
+	for (int i = 0; i < 2; i++) {
+		burst(LOGGING_TYPE_ERROR, 10);
+		now += 60;
+	}
+
+	LONGS_EQUAL(5, nr_written);
+	STRCMP_CONTAINS("last message repeated 7 times", logs[3]);
+	STRCMP_CONTAINS("timeout 0", logs[4]);
+}
+
+TEST(logging_ratelim, ShouldKeepStatePerCallSite) {
+	burst(LOGGING_TYPE_ERROR, 10);
+	burst(LOGGING_TYPE_WARN, 10);
+	LONGS_EQUAL(6, nr_written);
+}
+
+TEST(logging_ratelim, ShouldNotTakeToken_WhenLevelDisabled) {
+	for (int i = 0; i < 2; i++) {
+		if (i == 1) {
+			logging_set_level_global(LOGGING_TYPE_DEBUG);
+		}
+		burst(LOGGING_TYPE_DEBUG, 3);
+	}
+
+	LONGS_EQUAL(3, nr_written);
+	LONGS_EQUAL(3, nr_evaluated);
+}
+
+TEST(logging_ratelim, ShouldCountAsSuppressed_WhenBucketIsHeld) {
+	struct logging_ratelim ratelim = { .busy = 1, };
+	const struct logging_context ctx = { .tag = "ratelim", };
+
+	CHECK_FALSE(logging_ratelim_request(&ratelim,
+			LOGGING_TYPE_ERROR, &ctx));
+	LONGS_EQUAL(1, ratelim.suppressed);
+	LONGS_EQUAL(0, nr_written);
+
+	ratelim.busy = 0;
+	CHECK_TRUE(logging_ratelim_request(&ratelim,
+			LOGGING_TYPE_ERROR, &ctx));
+	LONGS_EQUAL(1, nr_written);
+	STRCMP_CONTAINS("last message repeated 1 times", logs[0]);
+}
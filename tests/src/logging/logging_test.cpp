@@ -288,6 +288,14 @@ TEST(logging, count_ShouldReturnTotalNumberOfLogsSaved_WhenMultiTagsGiven) {
 	LONGS_EQUAL(3, logging_count(&backend));
 }
 
+TEST(logging, open_cursor_ShouldReturnENOTSUP_WhenBackendHasNoCursorSupport) {
+	struct logging_cursor cursor;
+	uint8_t buf[64];
+	LONGS_EQUAL(-ENOTSUP, logging_open_cursor(&backend, &cursor, "cli"));
+	LONGS_EQUAL(0, logging_read_cursor(&backend, &cursor, buf, sizeof(buf)));
+	LONGS_EQUAL(0, logging_count_cursor(&backend, &cursor));
+}
+
 TEST(logging, read_ShouldReturnZero_WhenBufIsNull) {
 	LONGS_EQUAL(0, logging_read(&backend, NULL, 100));
 }
@@ -312,3 +320,407 @@ TEST(logging, read_ShouldReturnLogSize) {
 TEST(logging, LOGGING_TAG_ShouldReturnCurrentTag) {
 	STRCMP_EQUAL(TAG, LOGGING_TAG);
 }
+
+static char captured[256];
+static size_t captured_size;
+static size_t nr_captured;
+
+static size_t capture_write(const void *data, size_t datasize) {
+	logging_stringify(captured, sizeof(captured), data);
+	captured_size = datasize;
+	nr_captured++;
+	return datasize;
+}
+
+static const struct logging_backend capture_backend = {
+	.write = capture_write,
+};
+
+static const char *site_tags[] = {
+	"#0", "#1", "#2", "#3", "#4", "#5", "#6", "#7", "#8", "#9",
+};
+
+#undef LOGGING_TAG
+#define LOGGING_TAG	site_tags[i]
+static void info_at_site(int i) {
+	switch (i) {
+	case 0: info("site %d", i); break;
+	case 1: info("site %d", i); break;
+	case 2: info("site %d", i); break;
+	case 3: info("site %d", i); break;
+	case 4: info("site %d", i); break;
+	case 5: info("site %d", i); break;
+	case 6: info("site %d", i); break;
+	case 7: info("site %d", i); break;
+	case 8: info("site %d", i); break;
+	case 9: info("site %d", i); break;
+	default: break;
+	}
+}
+#undef LOGGING_TAG
+#define LOGGING_TAG	TAG
+
+TEST_GROUP(logging_site) {
+	void setup(void) {
+		mock().ignoreOtherCalls();
+
+		logging_init(get_time);
+		logging_add_backend(&capture_backend);
+
+		nr_captured = 0;
+	}
+	void teardown() {
+		mock().clear();
+	}
+};
+
+TEST(logging_site, ShouldRegisterTags_WhenMoreThanTagsMaxNumGiven) {
+	for (int i = 0; i < 10; i++) {
+		info_at_site(i);
+	}
+	LONGS_EQUAL(10, nr_captured);
+	LONGS_EQUAL(10, logging_count_tags());
+
+	logging_set_level_tag(site_tags[9], LOGGING_TYPE_ERROR);
+	LONGS_EQUAL(LOGGING_TYPE_ERROR, logging_get_level_tag(site_tags[9]));
+
+	info_at_site(9);
+	LONGS_EQUAL(10, nr_captured);
+	info_at_site(8);
+	LONGS_EQUAL(11, nr_captured);
+}
+
+TEST(logging_site, ShouldShareTag_WhenSameTagUsedAtMultipleSites) {
+	info("first site");
+	info("second site");
+	LONGS_EQUAL(2, nr_captured);
+	LONGS_EQUAL(1, logging_count_tags());
+
+	logging_set_level(LOGGING_TYPE_WARN);
+	info("first site");
+	info("second site");
+	warn("third site");
+	LONGS_EQUAL(3, nr_captured);
+}
+
+TEST(logging_site, ShouldFollowGlobalLevel) {
+	info_at_site(0);
+	logging_set_level_global(LOGGING_TYPE_WARN);
+	info_at_site(0);
+	LONGS_EQUAL(1, nr_captured);
+
+	logging_set_level_global(LOGGING_TYPE_DEBUG);
+	info_at_site(0);
+	LONGS_EQUAL(2, nr_captured);
+}
+
+static int nr_evaluated;
+static int evaluate(void) {
+	return ++nr_evaluated;
+}
+
+TEST(logging_site, ShouldNotEvaluateArguments_WhenLevelIsDisabled) {
+	nr_evaluated = 0;
+	logging_set_level(LOGGING_TYPE_WARN);
+
+	debug("%d", evaluate());
+	info("%d", evaluate());
+	LONGS_EQUAL(0, nr_evaluated);
+
+	warn("%d", evaluate());
+	LONGS_EQUAL(1, nr_evaluated);
+	LONGS_EQUAL(1, nr_captured);
+}
+
+TEST(logging_site, ShouldUseTagRegisteredBeforeFirstLog) {
+	logging_set_level_tag(site_tags[1], LOGGING_TYPE_ERROR);
+	info_at_site(1);
+	LONGS_EQUAL(0, nr_captured);
+	LONGS_EQUAL(1, logging_count_tags());
+}
+
+TEST(logging_site, ShouldResolveAgain_WhenReinitialized) {
+	logging_set_level_tag(site_tags[2], LOGGING_TYPE_ERROR);
+	info_at_site(2);
+	LONGS_EQUAL(0, nr_captured);
+
+	logging_init(get_time);
+	logging_add_backend(&capture_backend);
+
+	info_at_site(2);
+	LONGS_EQUAL(1, nr_captured);
+}
+
+TEST_GROUP(logging_async) {
+	uint8_t queue[512];
+
+	void setup(void) {
+		mock().ignoreOtherCalls();
+
+		logging_init(get_time);
+		logging_add_backend(&capture_backend);
+		LONGS_EQUAL(0, logging_set_async(queue, sizeof(queue)));
+
+		memset(captured, 0, sizeof(captured));
+		nr_captured = 0;
+	}
+	void teardown() {
+		logging_set_async(NULL, 0);
+		mock().clear();
+	}
+
+	void check_same_as_sync(const char *expected) {
+		LONGS_EQUAL(1, logging_drain(0));
+		LONGS_EQUAL(1, nr_captured);
+		STRCMP_EQUAL(expected, captured);
+	}
+};
+
+TEST(logging_async, set_async_ShouldReturnEINVAL_WhenBufferIsTooSmall) {
+	LONGS_EQUAL(-EINVAL, logging_set_async(queue, 4));
+}
+
+TEST(logging_async, write_ShouldNotReachBackend_UntilDrained) {
+	info("hello %d", 1);
+	info("world %d", 2);
+	LONGS_EQUAL(0, nr_captured);
+
+	LONGS_EQUAL(1, logging_drain(1));
+	LONGS_EQUAL(1, nr_captured);
+	LONGS_EQUAL(1, logging_drain(0));
+	LONGS_EQUAL(2, nr_captured);
+	LONGS_EQUAL(0, logging_drain(0));
+}
+
+TEST(logging_async, drain_ShouldRenderSameMessageAsSyncMode) {
+	char expected[sizeof(captured)];
+	const char *str = "str";
+	const logging_context ctx = { .tag = TAG, };
+#define FMT	"%d|%5.2f|%s|%c|%lu|%lld|%zu|%#x|%%|%-5s|%*d|%.*s|%hhu|%p|%s"
+#define ARGS	-12, 3.14159, str, 'c', 123456789UL, -9876543210LL, \
+		(size_t)42, 0xbeefU, "ab", 4, 7, 2, "xyz", 300, (void *)&ctx, \
+		(const char *)NULL
+
+	logging_set_async(NULL, 0);
+	logging_write(LOGGING_TYPE_INFO, &ctx, FMT, ARGS);
+	strcpy(expected, captured);
+	nr_captured = 0;
+
+	logging_set_async(queue, sizeof(queue));
+	logging_write(LOGGING_TYPE_INFO, &ctx, FMT, ARGS);
+	LONGS_EQUAL(0, nr_captured);
+	check_same_as_sync(expected);
+#undef ARGS
+#undef FMT
+}
+
+TEST(logging_async, write_ShouldCopyStringArguments) {
+	char str[8] = "before";
+	info("%s", str);
+	strcpy(str, "after");
+	logging_drain(0);
+	STRCMP_CONTAINS("before", captured);
+}
+
+TEST(logging_async, write_ShouldDropAndCount_WhenQueueIsFull) {
+	const logging_context ctx = { .tag = TAG, };
+	size_t queued = 0;
+
+	for (int i = 0; i < 64; i++) {
+		if (logging_write(LOGGING_TYPE_INFO, &ctx, "%d", i) == 0) {
+			break;
+		}
+		queued++;
+	}
+
+	CHECK(queued < 64);
+	LONGS_EQUAL(1, logging_count_dropped());
+	LONGS_EQUAL(queued, logging_drain(0));
+	CHECK(logging_write(LOGGING_TYPE_INFO, &ctx, "%d", 0) > 0);
+}
+
+TEST(logging_async, drain_ShouldDeliverInOrderOfTimestamp) {
+	mock().expectOneCall("get_time").andReturnValue(20U);
+	mock().expectOneCall("get_time").andReturnValue(10U);
+	mock().expectOneCall("get_time").andReturnValue(10U);
+
+	info("third");
+	info("first");
+	info("second");
+
+	LONGS_EQUAL(1, logging_drain(1));
+	STRCMP_EQUAL("10:INFO:logging: first", captured);
+	LONGS_EQUAL(1, logging_drain(1));
+	STRCMP_EQUAL("10:INFO:logging: second", captured);
+	LONGS_EQUAL(1, logging_drain(1));
+	STRCMP_EQUAL("20:INFO:logging: third", captured);
+}
+
+TEST(logging_async, write_ShouldWrapAroundQueue) {
+	const logging_context ctx = { .tag = TAG, };
+
+	for (int i = 0; i < 100; i++) {
+		char expected[32];
+		LONGS_EQUAL(0, logging_count_dropped());
+		CHECK(logging_write(LOGGING_TYPE_INFO, &ctx,
+				"%d %s", i, "wrap around") > 0);
+		LONGS_EQUAL(1, logging_drain(0));
+		snprintf(expected, sizeof(expected), "%d wrap around", i);
+		STRCMP_CONTAINS(expected, captured);
+	}
+}
+
+TEST(logging_async, write_ShouldNotQueue_WhenLevelIsDisabled) {
+	logging_set_level(LOGGING_TYPE_ERROR);
+	info("filtered");
+	LONGS_EQUAL(0, logging_drain(0));
+}
+
+TEST_GROUP(logging_dictionary) {
+	const logging_context ctx = { .tag = TAG, };
+
+	void setup(void) {
+		mock().ignoreOtherCalls();
+
+		logging_init(get_time);
+		logging_add_backend(&capture_backend);
+		logging_set_dictionary(true);
+
+		memset(captured, 0, sizeof(captured));
+		captured_size = 0;
+		nr_captured = 0;
+	}
+	void teardown() {
+		mock().clear();
+	}
+};
+
+TEST(logging_dictionary, write_ShouldStoreFormatAddressAndArguments) {
+	const char *fmt = "a long message that is not stored: %d %s";
+	size_t text_size;
+
+	logging_set_dictionary(false);
+	logging_write(LOGGING_TYPE_INFO, &ctx, fmt, 1, "abc");
+	text_size = captured_size;
+	STRCMP_CONTAINS("a long message that is not stored: 1 abc", captured);
+
+	logging_set_dictionary(true);
+	logging_write(LOGGING_TYPE_INFO, &ctx, fmt, 1, "abc");
+	LONGS_EQUAL(text_size - strlen("a long message that is not stored: 1 abc")
+			+ sizeof(uintptr_t) + sizeof(int) + 1 + strlen("abc"),
+			captured_size);
+}
+
+TEST(logging_dictionary, stringify_ShouldRenderSameMessageAsTextMode) {
+	char expected[sizeof(captured)];
+	const char *str = "str";
+#define FMT	"%d|%5.2f|%s|%c|%lu|%#x|%%|%-5s|%*d|%.*s|%hhu|%p|%s"
+#define ARGS	-12, 3.14159, str, 'c', 123456789UL, 0xbeefU, "ab", 4, 7, \
+		2, "xyz", 300, (void *)&ctx, (const char *)NULL
+
+	logging_set_dictionary(false);
+	logging_write(LOGGING_TYPE_WARN, &ctx, FMT, ARGS);
+	strcpy(expected, captured);
+
+	logging_set_dictionary(true);
+	logging_write(LOGGING_TYPE_WARN, &ctx, FMT, ARGS);
+	STRCMP_EQUAL(expected, captured);
+#undef ARGS
+#undef FMT
+}
+
+TEST(logging_dictionary, drain_ShouldStoreDictionary_WhenAsyncModeEnabled) {
+	uint8_t queue[256];
+	char expected[sizeof(captured)];
+	size_t text_size;
+
+	logging_set_dictionary(false);
+	logging_write(LOGGING_TYPE_ERROR, &ctx, "async %s %u times", "done", 3U);
+	strcpy(expected, captured);
+	text_size = captured_size;
+
+	logging_set_dictionary(true);
+	logging_set_async(queue, sizeof(queue));
+	logging_write(LOGGING_TYPE_ERROR, &ctx, "async %s %u times", "done", 3U);
+	LONGS_EQUAL(1, logging_drain(0));
+	logging_set_async(NULL, 0);
+
+	STRCMP_EQUAL(expected, captured);
+	CHECK(captured_size < text_size);
+}
+
+static size_t nr_batches;
+static size_t nr_batched;
+static size_t nr_flushed;
+
+static size_t batch_write(const struct logging_record *logs, size_t n) {
+	logging_stringify(captured, sizeof(captured), logs[n - 1].data);
+	nr_batches++;
+	nr_batched += n;
+	return n;
+}
+static void batch_flush(void) {
+	nr_flushed++;
+}
+
+static const struct logging_backend batch_backend = {
+	.write_batch = batch_write,
+	.flush = batch_flush,
+};
+
+TEST_GROUP(logging_batch) {
+	void setup(void) {
+		mock().ignoreOtherCalls();
+
+		logging_init(get_time);
+		logging_add_backend(&batch_backend);
+
+		nr_batches = 0;
+		nr_batched = 0;
+		nr_flushed = 0;
+	}
+	void teardown() {
+		logging_set_async(NULL, 0);
+		mock().clear();
+	}
+};
+
+TEST(logging_batch, write_ShouldHandOverEachLogAndFlush_WhenSyncMode) {
+	info("one");
+	info("two");
+	LONGS_EQUAL(2, nr_batches);
+	LONGS_EQUAL(2, nr_batched);
+	LONGS_EQUAL(2, nr_flushed);
+	STRCMP_EQUAL("0:INFO:logging: two", captured);
+}
+
+TEST(logging_batch, drain_ShouldHandOverLogsAtOnce_WhenAsyncMode) {
+	uint8_t queue[512];
+
+	logging_set_async(queue, sizeof(queue));
+	info("one");
+	info("two");
+	info("three");
+	LONGS_EQUAL(0, nr_batches);
+
+	LONGS_EQUAL(3, logging_drain(0));
+	LONGS_EQUAL(1, nr_batches);
+	LONGS_EQUAL(3, nr_batched);
+	LONGS_EQUAL(1, nr_flushed);
+	STRCMP_EQUAL("0:INFO:logging: three", captured);
+}
+
+TEST(logging_batch, drain_ShouldSplitBatches_WhenBatchBufferIsFull) {
+	uint8_t queue[2048];
+	const size_t n = 10;
+
+	logging_set_async(queue, sizeof(queue));
+	for (size_t i = 0; i < n; i++) {
+		info("%s", "a message long enough to fill up the batch buffer");
+	}
+
+	LONGS_EQUAL(n, logging_drain(0));
+	CHECK(nr_batches > 1);
+	LONGS_EQUAL(n, nr_batched);
+	LONGS_EQUAL(nr_batches, nr_flushed);
+}
@@ -0,0 +1,133 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+
+#include "libmcu/metrics.h"
+
+#define ENTRY_SIZE			8 /* key and value, 32 bits each */
+
+TEST_GROUP(metrics_delta) {
+	uint8_t buf[128];
+	metrics_cursor_t cursor;
+
+	void setup(void) {
+		metrics_init(true);
+		cursor = 0;
+		memset(buf, 0, sizeof(buf));
+	}
+	void teardown(void) {
+	}
+
+	void check_entry(int index, metric_key_t key, int32_t value) {
+		uint32_t k;
+		int32_t v;
+		memcpy(&k, &buf[index * ENTRY_SIZE], sizeof(k));
+		memcpy(&v, &buf[index * ENTRY_SIZE + sizeof(k)], sizeof(v));
+		LONGS_EQUAL(key, k);
+		LONGS_EQUAL(value, v);
+	}
+};
+
+TEST(metrics_delta, collect_delta_ShouldEncodeAll_WhenCursorIsZeroed) {
+	metrics_set(ReportInterval, 10);
+	metrics_increase(UnexpectedRebootCount);
+
+	LONGS_EQUAL(2 * ENTRY_SIZE,
+			metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+	check_entry(0, ReportInterval, 10);
+	check_entry(1, UnexpectedRebootCount, 1);
+	CHECK(cursor != 0);
+}
+
+TEST(metrics_delta, collect_delta_ShouldReturnZero_WhenNothingChanged) {
+	metrics_set(ReportInterval, 10);
+	metrics_collect_delta(buf, sizeof(buf), NULL, &cursor);
+	const metrics_cursor_t saved = cursor;
+
+	metrics_set(ReportInterval, 10);
+
+	LONGS_EQUAL(0, metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+	LONGS_EQUAL(saved, cursor);
+}
+
+TEST(metrics_delta, collect_delta_ShouldEncodeChangedOnly) {
+	metrics_set(ReportInterval, 10);
+	metrics_set(WallTime, 20);
+	metrics_increase(UnexpectedRebootCount);
+	metrics_collect_delta(buf, sizeof(buf), NULL, &cursor);
+
+	metrics_increase(UnexpectedRebootCount);
+	metrics_set_if_max(WallTime, 5);
+
+	LONGS_EQUAL(ENTRY_SIZE,
+			metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+	check_entry(0, UnexpectedRebootCount, 2);
+}
+
+TEST(metrics_delta, collect_delta_ShouldKeepChanges_WhenDryRun) {
+	metrics_collect_delta(buf, sizeof(buf), NULL, &cursor);
+	metrics_set(WallTime, 20);
+	const metrics_cursor_t saved = cursor;
+
+	LONGS_EQUAL(ENTRY_SIZE, metrics_collect_delta(NULL, 0, NULL, &cursor));
+	LONGS_EQUAL(saved, cursor);
+	LONGS_EQUAL(ENTRY_SIZE,
+			metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+	check_entry(0, WallTime, 20);
+}
+
+TEST(metrics_delta, collect_delta_ShouldKeepChanges_WhenBufferTooSmall) {
+	metrics_set(ReportInterval, 10);
+	metrics_collect_delta(buf, sizeof(buf), NULL, &cursor);
+	metrics_set(ReportInterval, 11);
+	metrics_set(WallTime, 20);
+	const metrics_cursor_t saved = cursor;
+
+	LONGS_EQUAL(0, metrics_collect_delta(buf, ENTRY_SIZE, NULL, &cursor));
+	LONGS_EQUAL(saved, cursor);
+	LONGS_EQUAL(2 * ENTRY_SIZE,
+			metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+	check_entry(0, ReportInterval, 11);
+	check_entry(1, WallTime, 20);
+}
+
+TEST(metrics_delta, collect_delta_ShouldEncodeAll_WhenCursorLeftBehind) {
+	metrics_cursor_t other = 0;
+
+	metrics_set(ReportInterval, 10);
+	metrics_collect_delta(buf, sizeof(buf), NULL, &cursor);
+	metrics_set(WallTime, 20);
+	metrics_collect_delta(buf, sizeof(buf), NULL, &other);
+	metrics_set(WallTime, 21);
+
+	LONGS_EQUAL(2 * ENTRY_SIZE,
+			metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+	check_entry(0, ReportInterval, 10);
+	check_entry(1, WallTime, 21);
+	LONGS_EQUAL(0, metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+}
+
+TEST(metrics_delta, collect_delta_ShouldEncodeAll_WhenResetInBetween) {
+	metrics_set(ReportInterval, 10);
+	metrics_collect_delta(buf, sizeof(buf), NULL, &cursor);
+	const metrics_cursor_t saved = cursor;
+
+	metrics_reset();
+	metrics_set(WallTime, 20);
+
+	LONGS_EQUAL(ENTRY_SIZE,
+			metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+	check_entry(0, WallTime, 20);
+	CHECK(cursor != saved);
+}
+
+TEST(metrics_delta, collect_delta_ShouldReturnZero_WhenCursorIsNull) {
+	metrics_set(ReportInterval, 10);
+	LONGS_EQUAL(0, metrics_collect_delta(buf, sizeof(buf), NULL, NULL));
+}
@@ -0,0 +1,156 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+#include <limits.h>
+
+#include "libmcu/metrics.h"
+
+#define NR_BUCKETS			7
+
+static uint32_t read_u32(const uint8_t *b, size_t off)
+{
+	uint32_t v;
+	memcpy(&v, b + off, sizeof(v));
+	return v;
+}
+
+static int32_t read_i32(const uint8_t *b, size_t off)
+{
+	int32_t v;
+	memcpy(&v, b + off, sizeof(v));
+	return v;
+}
+
+TEST_GROUP(metrics_histogram) {
+	uint8_t buf[128];
+
+	void setup(void) {
+		metrics_init(true);
+	}
+	void teardown(void) {
+	}
+
+	void observe_n(int n, metric_value_t val) {
+		for (int i = 0; i < n; i++) {
+			metrics_observe(Latency, val);
+		}
+	}
+};
+
+TEST(metrics_histogram, define_ShouldTakeKeyForEachBucket) {
+	LONGS_EQUAL(Latency + NR_BUCKETS - 1, Latency_LAST_BUCKET);
+	LONGS_EQUAL(Latency + NR_BUCKETS, Temperature);
+	LONGS_EQUAL(NR_BUCKETS + 2, metrics_count());
+}
+
+TEST(metrics_histogram, observe_ShouldCountInBucket_WhenValueFallsInRange) {
+	metrics_observe(Latency, -5);
+	metrics_observe(Latency, 0);
+	metrics_observe(Latency, 1);
+	metrics_observe(Latency, 3);
+	metrics_observe(Latency, 31);
+	metrics_observe(Latency, 32);
+	metrics_observe(Latency, INT32_MAX);
+
+	LONGS_EQUAL(2, metrics_get(Latency));
+	LONGS_EQUAL(1, metrics_get(Latency + 1));
+	LONGS_EQUAL(1, metrics_get(Latency + 2));
+	CHECK_FALSE(metrics_is_set(Latency + 3));
+	CHECK_FALSE(metrics_is_set(Latency + 4));
+	LONGS_EQUAL(1, metrics_get(Latency + 5));
+	LONGS_EQUAL(2, metrics_get(Latency_LAST_BUCKET));
+	LONGS_EQUAL(5, metrics_count_set());
+}
+
+TEST(metrics_histogram, observe_ShouldDoNothing_WhenKeyIsNotHistogram) {
+	metrics_observe(Requests, 1);
+	metrics_observe(Temperature, 1);
+	metrics_observe((metric_key_t)metrics_count(), 1);
+	LONGS_EQUAL(0, metrics_count_set());
+}
+
+TEST(metrics_histogram, get_percentile_ShouldReturnZero_WhenNothingObserved) {
+	LONGS_EQUAL(0, metrics_get_percentile(Latency, 50));
+	LONGS_EQUAL(0, metrics_get_percentile(Requests, 50));
+}
+
+TEST(metrics_histogram, get_percentile_ShouldReturnUpperBoundOfBucket) {
+	observe_n(50, 3);
+	observe_n(49, 10);
+	observe_n(1, 100);
+
+	LONGS_EQUAL(4, metrics_get_percentile(Latency, 0));
+	LONGS_EQUAL(4, metrics_get_percentile(Latency, 50));
+	LONGS_EQUAL(16, metrics_get_percentile(Latency, 51));
+	LONGS_EQUAL(16, metrics_get_percentile(Latency, 99));
+	LONGS_EQUAL(INT32_MAX, metrics_get_percentile(Latency, 100));
+	LONGS_EQUAL(0, metrics_get_percentile(Latency, 101));
+}
+
+TEST(metrics_histogram, stringify_key_ShouldNameBucketsAfterHistogram) {
+	STRCMP_EQUAL("Latency", metrics_stringify_key(Latency));
+	STRCMP_EQUAL("Latency", metrics_stringify_key(Latency + 3));
+	STRCMP_EQUAL("Latency", metrics_stringify_key(Latency_LAST_BUCKET));
+	STRCMP_EQUAL("Temperature", metrics_stringify_key(Temperature));
+}
+
+TEST(metrics_histogram, collect_reset_ShouldClearBuckets) {
+	observe_n(3, 5);
+
+	CHECK(metrics_collect_reset(buf, sizeof(buf), NULL) > 0);
+	LONGS_EQUAL(0, metrics_count_set());
+	LONGS_EQUAL(0, metrics_get_percentile(Latency, 50));
+}
+
+#if !defined(METRICS_SCHEMA_IBS)
+TEST(metrics_histogram, collect_ShouldEncodeOnlyBucketsHit) {
+	observe_n(2, 3);
+	observe_n(1, 100);
+
+	LONGS_EQUAL(16, metrics_collect(buf, sizeof(buf), NULL));
+	LONGS_EQUAL(Latency + 2, read_u32(buf, 0));
+	LONGS_EQUAL(2, read_i32(buf, 4));
+	LONGS_EQUAL(Latency_LAST_BUCKET, read_u32(buf, 8));
+	LONGS_EQUAL(1, read_i32(buf, 12));
+}
+#else
+#define IBS_HEADER_SIZE			2
+#define IBS_ENTRY_SIZE			18
+
+TEST(metrics_histogram, collect_ShouldEncodeBucketRangesInSchema) {
+	metrics_observe(Latency, -1);
+	metrics_observe(Latency, 3);
+	metrics_observe(Latency, 3);
+	metrics_observe(Latency, 100);
+	metrics_increase(Requests);
+
+	LONGS_EQUAL(IBS_HEADER_SIZE + 4 * IBS_ENTRY_SIZE,
+			metrics_collect(buf, sizeof(buf), NULL));
+
+	const uint8_t *e = &buf[IBS_HEADER_SIZE + IBS_ENTRY_SIZE];
+	LONGS_EQUAL(Latency, read_u32(e, 0));
+	LONGS_EQUAL(METRIC_CLASS_HISTOGRAM, e[4]);
+	LONGS_EQUAL(INT32_MIN, read_i32(e, 6));
+	LONGS_EQUAL(0, read_i32(e, 10));
+	LONGS_EQUAL(1, read_i32(e, 14));
+
+	e += IBS_ENTRY_SIZE;
+	LONGS_EQUAL(Latency + 2, read_u32(e, 0));
+	LONGS_EQUAL(METRIC_CLASS_HISTOGRAM, e[4]);
+	LONGS_EQUAL(2, read_i32(e, 6));
+	LONGS_EQUAL(3, read_i32(e, 10));
+	LONGS_EQUAL(2, read_i32(e, 14));
+
+	e += IBS_ENTRY_SIZE;
+	LONGS_EQUAL(Latency_LAST_BUCKET, read_u32(e, 0));
+	LONGS_EQUAL(32, read_i32(e, 6));
+	LONGS_EQUAL(INT32_MAX, read_i32(e, 10));
+	LONGS_EQUAL(1, read_i32(e, 14));
+}
+#endif
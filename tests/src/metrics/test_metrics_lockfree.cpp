@@ -0,0 +1,199 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "libmcu/metrics.h"
+#include "libmcu/metrics_overrides.h"
+
+#define NR_THREADS			4
+#define INCREMENTS			100000
+
+static volatile bool done;
+static void (*on_encode)(void);
+static void (*on_interleave)(void);
+
+static void run_once(void (**f)(void))
+{
+	void (*g)(void) = *f;
+
+	*f = NULL;
+	if (g) {
+		g();
+	}
+}
+
+/* Runs in the middle of a collection, after the values are taken out */
+size_t metrics_encode_header(void *buf, size_t bufsize,
+		uint32_t nr_total, uint32_t nr_updated, void *ctx)
+{
+	(void)buf;
+	(void)bufsize;
+	(void)nr_total;
+	(void)nr_updated;
+	(void)ctx;
+
+	run_once(&on_encode);
+
+	return 0;
+}
+
+extern "C" void metrics_test_interleave(void)
+{
+	run_once(&on_interleave);
+}
+
+static void set_wall_time(void)
+{
+	metrics_set(WallTime, 26);
+}
+
+static void set_report_interval(void)
+{
+	metrics_set(ReportInterval, 10);
+}
+
+static void *increase(void *arg)
+{
+	for (int i = 0; i < INCREMENTS; i++) {
+		metrics_increase(UnexpectedRebootCount);
+	}
+	return arg;
+}
+
+static void *set_extremes(void *arg)
+{
+	const int32_t id = (int32_t)(intptr_t)arg;
+
+	for (int32_t i = 0; i < INCREMENTS; i++) {
+		metrics_set_max_min(HeapHighWaterMark, StackHighWaterMark,
+				(i * NR_THREADS + id) % 9973);
+	}
+	return arg;
+}
+
+/* Sums up the counter from the default encoding, key and value in 32 bits
+ * each. */
+static int64_t sum_collected(const uint8_t *buf, size_t len)
+{
+	int64_t sum = 0;
+
+	for (size_t i = 0; i + 8 <= len; i += 8) {
+		uint32_t key;
+		int32_t value;
+		memcpy(&key, &buf[i], sizeof(key));
+		memcpy(&value, &buf[i + 4], sizeof(value));
+		if (key == UnexpectedRebootCount) {
+			sum += value;
+		}
+	}
+
+	return sum;
+}
+
+static void *collect(void *arg)
+{
+	int64_t *sum = (int64_t *)arg;
+	uint8_t buf[128];
+
+	while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+		const size_t len =
+			metrics_collect_reset(buf, sizeof(buf), NULL);
+		*sum += sum_collected(buf, len);
+	}
+
+	return NULL;
+}
+
+TEST_GROUP(metrics_lockfree) {
+	pthread_t threads[NR_THREADS];
+
+	void setup(void) {
+		metrics_init(true);
+		done = false;
+		on_encode = NULL;
+		on_interleave = NULL;
+	}
+	void teardown(void) {
+	}
+
+	void run(void *(*func)(void *)) {
+		for (int i = 0; i < NR_THREADS; i++) {
+			pthread_create(&threads[i], NULL,
+					func, (void *)(intptr_t)i);
+		}
+		for (int i = 0; i < NR_THREADS; i++) {
+			pthread_join(threads[i], NULL);
+		}
+	}
+};
+
+TEST(metrics_lockfree, increase_ShouldNotLoseCounts_WhenCalledConcurrently) {
+	run(increase);
+	LONGS_EQUAL(NR_THREADS * INCREMENTS,
+			metrics_get(UnexpectedRebootCount));
+}
+
+TEST(metrics_lockfree, set_max_min_ShouldKeepExtremes_WhenCalledConcurrently) {
+	run(set_extremes);
+	LONGS_EQUAL(9972, metrics_get(HeapHighWaterMark));
+	LONGS_EQUAL(0, metrics_get(StackHighWaterMark));
+}
+
+TEST(metrics_lockfree, collect_reset_ShouldNotLoseCounts_WhenRacingUpdates) {
+	pthread_t collector;
+	int64_t sum = 0;
+	uint8_t buf[128];
+
+	pthread_create(&collector, NULL, collect, &sum);
+	run(increase);
+	__atomic_store_n(&done, true, __ATOMIC_RELEASE);
+	pthread_join(collector, NULL);
+
+	const size_t len = metrics_collect_reset(buf, sizeof(buf), NULL);
+	sum += sum_collected(buf, len);
+	LONGS_EQUAL(NR_THREADS * INCREMENTS, sum);
+}
+
+TEST(metrics_lockfree, collect_reset_ShouldKeepValues_WhenBufferTooSmall) {
+	uint8_t buf[4];
+
+	metrics_increase_by(UnexpectedRebootCount, 3);
+	metrics_set(WallTime, 7);
+
+	LONGS_EQUAL(0, metrics_collect_reset(buf, sizeof(buf), NULL));
+	LONGS_EQUAL(3, metrics_get(UnexpectedRebootCount));
+	LONGS_EQUAL(7, metrics_get(WallTime));
+	LONGS_EQUAL(2, metrics_count_set());
+}
+
+TEST(metrics_lockfree, collect_reset_ShouldKeepNewerValue_WhenSetWhileCollecting) {
+	uint8_t buf[4];
+
+	metrics_set(WallTime, 25);
+	on_encode = set_wall_time;
+
+	LONGS_EQUAL(0, metrics_collect_reset(buf, sizeof(buf), NULL));
+	LONGS_EQUAL(26, metrics_get(WallTime));
+}
+
+TEST(metrics_lockfree, collect_delta_ShouldReportChange_WhenSetWhileCollecting) {
+	metrics_cursor_t cursor = 0;
+	uint8_t buf[128];
+	uint32_t key;
+
+	metrics_set(WallTime, 1);
+	LONGS_EQUAL(8, metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+
+	on_interleave = set_report_interval;
+	LONGS_EQUAL(0, metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+	LONGS_EQUAL(8, metrics_collect_delta(buf, sizeof(buf), NULL, &cursor));
+	memcpy(&key, buf, sizeof(key));
+	LONGS_EQUAL(ReportInterval, key);
+}
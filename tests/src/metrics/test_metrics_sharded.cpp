@@ -0,0 +1,133 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+
+#include "libmcu/metrics.h"
+#include "libmcu/metrics_overrides.h"
+
+static unsigned int nr_threads;
+/* Each thread gets a shard of its own on the first update */
+static thread_local int shard = -1;
+
+unsigned int metrics_get_shard(void)
+{
+	if (shard < 0) {
+		shard = (int)__atomic_fetch_add(&nr_threads, 1,
+				__ATOMIC_RELAXED);
+	}
+	return (unsigned int)shard;
+}
+
+TEST_GROUP(metrics_sharded) {
+	void setup(void) {
+		metrics_init(true);
+	}
+	void teardown(void) {
+		shard = 0;
+	}
+
+	void update_in(int n, void (*update)(metric_key_t, metric_value_t),
+			metric_key_t key, metric_value_t value) {
+		shard = n;
+		(*update)(key, value);
+	}
+
+	int32_t decode_value(const uint8_t *buf, metric_key_t key) {
+		uint32_t kval;
+		int32_t value;
+		memcpy(&kval, buf, sizeof(kval));
+		memcpy(&value, &buf[sizeof(kval)], sizeof(value));
+		LONGS_EQUAL(key, kval);
+		return value;
+	}
+};
+
+TEST(metrics_sharded, get_ShouldSumCounters_WhenIncreasedInManyShards) {
+	update_in(0, metrics_increase_by, UnexpectedRebootCount, 1);
+	update_in(1, metrics_increase_by, UnexpectedRebootCount, 2);
+	update_in(3, metrics_increase_by, UnexpectedRebootCount, 3);
+
+	LONGS_EQUAL(6, metrics_get(UnexpectedRebootCount));
+	LONGS_EQUAL(1, metrics_count_set());
+}
+
+TEST(metrics_sharded, get_ShouldMergeExtremes_WhenSetInManyShards) {
+	update_in(2, metrics_set_if_max, HeapHighWaterMark, 10);
+	update_in(1, metrics_set_if_max, HeapHighWaterMark, 30);
+	update_in(0, metrics_set_if_max, HeapHighWaterMark, 20);
+	update_in(3, metrics_set_if_min, StackHighWaterMark, 10);
+	update_in(1, metrics_set_if_min, StackHighWaterMark, -5);
+	update_in(2, metrics_set_if_min, StackHighWaterMark, 20);
+
+	LONGS_EQUAL(30, metrics_get(HeapHighWaterMark));
+	LONGS_EQUAL(-5, metrics_get(StackHighWaterMark));
+}
+
+TEST(metrics_sharded, set_ShouldOverrideAllShards) {
+	update_in(1, metrics_increase_by, UnexpectedRebootCount, 5);
+	update_in(3, metrics_set_if_max, HeapHighWaterMark, 100);
+	update_in(2, metrics_set, UnexpectedRebootCount, 1);
+	update_in(0, metrics_set, HeapHighWaterMark, 7);
+
+	LONGS_EQUAL(1, metrics_get(UnexpectedRebootCount));
+	LONGS_EQUAL(7, metrics_get(HeapHighWaterMark));
+
+	update_in(3, metrics_increase_by, UnexpectedRebootCount, 1);
+	update_in(1, metrics_set_if_max, HeapHighWaterMark, 5);
+	LONGS_EQUAL(2, metrics_get(UnexpectedRebootCount));
+	LONGS_EQUAL(7, metrics_get(HeapHighWaterMark));
+}
+
+TEST(metrics_sharded, unset_ShouldClearAllShards) {
+	update_in(1, metrics_increase_by, UnexpectedRebootCount, 5);
+	update_in(2, metrics_increase_by, UnexpectedRebootCount, 5);
+
+	metrics_unset(UnexpectedRebootCount);
+
+	CHECK_FALSE(metrics_is_set(UnexpectedRebootCount));
+	LONGS_EQUAL(0, metrics_get(UnexpectedRebootCount));
+	LONGS_EQUAL(0, metrics_count_set());
+}
+
+TEST(metrics_sharded, collect_ShouldEncodeMergedValues) {
+	uint8_t buf[16];
+
+	update_in(1, metrics_increase_by, UnexpectedRebootCount, 2);
+	update_in(2, metrics_increase_by, UnexpectedRebootCount, 3);
+
+	LONGS_EQUAL(8, metrics_collect(buf, sizeof(buf), NULL));
+	LONGS_EQUAL(5, decode_value(buf, UnexpectedRebootCount));
+}
+
+TEST(metrics_sharded, collect_reset_ShouldTakeAllShards) {
+	uint8_t buf[16];
+
+	update_in(1, metrics_set_if_max, HeapHighWaterMark, 30);
+	update_in(3, metrics_set_if_max, HeapHighWaterMark, 40);
+
+	LONGS_EQUAL(8, metrics_collect_reset(buf, sizeof(buf), NULL));
+	LONGS_EQUAL(40, decode_value(buf, HeapHighWaterMark));
+	LONGS_EQUAL(0, metrics_count_set());
+}
+
+TEST(metrics_sharded, collect_reset_ShouldKeepMergedValues_WhenBufferTooSmall) {
+	uint8_t buf[4];
+
+	update_in(1, metrics_increase_by, UnexpectedRebootCount, 2);
+	update_in(2, metrics_increase_by, UnexpectedRebootCount, 3);
+	update_in(1, metrics_set_if_min, StackHighWaterMark, 30);
+	update_in(3, metrics_set_if_min, StackHighWaterMark, 20);
+
+	LONGS_EQUAL(0, metrics_collect_reset(buf, sizeof(buf), NULL));
+	LONGS_EQUAL(5, metrics_get(UnexpectedRebootCount));
+	LONGS_EQUAL(20, metrics_get(StackHighWaterMark));
+
+	update_in(2, metrics_set_if_min, StackHighWaterMark, 25);
+	LONGS_EQUAL(20, metrics_get(StackHighWaterMark));
+}
@@ -8,9 +8,14 @@
 #include "CppUTest/TestHarness_c.h"
 #include "CppUTestExt/MockSupport.h"
 
+#include <pthread.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "libmcu/pubsub.h"
+#include "libmcu/msgq.h"
+#include "libmcu/buf.h"
 
 static const char *testopic = "group/user/id";
 
@@ -184,13 +189,14 @@ TEST(PubSub, subscribe_ShouldExpandCapacity_WhenSubscriptionsFull) {
 	CHECK(pubsub_subscribe(testopic, callback, NULL) != NULL);
 }
 
-TEST(PubSub, subscribe_ShouldReturnNull_WhenExpansionFailDueToOOM) {
+TEST(PubSub, subscribe_ShouldReturnNull_WhenIndexingFailDueToOOM) {
 	for (int i = 0; i < PUBSUB_MIN_SUBSCRIPTION_CAPACITY; i++) {
 		CHECK(pubsub_subscribe(testopic, callback, NULL) != NULL);
 	}
-	cpputest_malloc_set_out_of_memory_countdown(2);
-	POINTERS_EQUAL(NULL, pubsub_subscribe(testopic, callback, NULL));
+	cpputest_malloc_set_out_of_memory_countdown(3);
+	POINTERS_EQUAL(NULL, pubsub_subscribe("group/admin/id", callback, NULL));
 	cpputest_malloc_set_not_out_of_memory();
+	LONGS_EQUAL(0, pubsub_count("group/admin/id"));
 }
 
 TEST(PubSub, subscribe_static_ShouldExpandCapacity_WhenSubscriptionsFull) {
@@ -204,7 +210,7 @@ TEST(PubSub, subscribe_static_ShouldExpandCapacity_WhenSubscriptionsFull) {
 	pubsub_unsubscribe(&extra_sub);
 }
 
-TEST(PubSub, subscribe_static_ShouldReturnNull_WhenExpansionFailDueToOOM) {
+TEST(PubSub, subscribe_static_ShouldReturnNull_WhenIndexingFailDueToOOM) {
 	for (int i = 0; i < PUBSUB_MIN_SUBSCRIPTION_CAPACITY; i++) {
 		CHECK(pubsub_subscribe_static(&subs[i], testopic, callback, NULL)
 				!= NULL);
@@ -212,7 +218,7 @@ TEST(PubSub, subscribe_static_ShouldReturnNull_WhenExpansionFailDueToOOM) {
 	pubsub_subscribe_static_t extra_sub;
 	cpputest_malloc_set_out_of_memory();
 	POINTERS_EQUAL(NULL, pubsub_subscribe_static(&extra_sub,
-				testopic, callback, NULL));
+				"group/admin/id", callback, NULL));
 	cpputest_malloc_set_not_out_of_memory();
 }
 
@@ -357,3 +363,430 @@ TEST(PubSub, stringify_ShouldReturnStrings_WhenErrorCodeGiven) {
 	STRCMP_EQUAL("no exist subscriber",
 			pubsub_stringify_error(PUBSUB_NO_EXIST_SUBSCRIBER));
 }
+
+TEST(PubSub, subscribe_ShouldNotBeLimited_WhenMoreThan256SubscribersGiven) {
+	static pubsub_subscribe_static_t many[300];
+	char topics[10][16];
+
+	for (int i = 0; i < 10; i++) {
+		snprintf(topics[i], sizeof(topics[i]), "group/%d/id", i);
+	}
+	for (int i = 0; i < 300; i++) {
+		CHECK(pubsub_subscribe_static(&many[i], topics[i % 10],
+					callback, NULL) != NULL);
+	}
+
+	LONGS_EQUAL(30, pubsub_count("group/3/id"));
+	LONGS_EQUAL(0, pubsub_count(testopic));
+
+	for (int i = 0; i < 300; i++) {
+		LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_unsubscribe(&many[i]));
+	}
+	LONGS_EQUAL(0, pubsub_count("group/3/id"));
+}
+
+TEST(PubSub, count_ShouldMatchFiltersWithWildcardsInWord) {
+	pubsub_subscribe_t sub1 = pubsub_subscribe("group/us#", callback, NULL);
+	pubsub_subscribe_t sub2 = pubsub_subscribe("gr+/user/id", callback, NULL);
+	pubsub_subscribe_t sub3 = pubsub_subscribe("group/+/i#", callback, NULL);
+
+	LONGS_EQUAL(3, pubsub_count(testopic));
+
+	pubsub_unsubscribe(sub1);
+	pubsub_unsubscribe(sub2);
+	pubsub_unsubscribe(sub3);
+}
+
+TEST(PubSub, count_ShouldNotMatchWildcards_WhenNothingLeftInTopic) {
+	pubsub_subscribe_t sub1 = pubsub_subscribe("a/#", callback, NULL);
+	pubsub_subscribe_t sub2 = pubsub_subscribe("a/+", callback, NULL);
+	pubsub_subscribe_t sub3 = pubsub_subscribe("+/b", callback, NULL);
+	pubsub_subscribe_t sub4 = pubsub_subscribe("a/", callback, NULL);
+
+	LONGS_EQUAL(1, pubsub_count("a/"));
+	LONGS_EQUAL(1, pubsub_count("a//"));
+	LONGS_EQUAL(1, pubsub_count("/b"));
+	LONGS_EQUAL(0, pubsub_count("a"));
+
+	pubsub_unsubscribe(sub1);
+	pubsub_unsubscribe(sub2);
+	pubsub_unsubscribe(sub3);
+	pubsub_unsubscribe(sub4);
+}
+
+TEST(PubSub, count_ShouldMatch_WhenTopicDeeperThanCachedLevels) {
+	const char *deep = "a/b/c/d/e/f/g/h/i/j/k";
+	pubsub_subscribe_t sub1 = pubsub_subscribe(deep, callback, NULL);
+	pubsub_subscribe_t sub2 = pubsub_subscribe("a/b/c/d/e/f/g/h/i/+/k",
+			callback, NULL);
+	pubsub_subscribe_t sub3 = pubsub_subscribe("a/b/c/d/e/f/g/h/i/#",
+			callback, NULL);
+
+	LONGS_EQUAL(3, pubsub_count(deep));
+	LONGS_EQUAL(1, pubsub_count("a/b/c/d/e/f/g/h/i/x"));
+
+	pubsub_unsubscribe(sub1);
+	pubsub_unsubscribe(sub2);
+	pubsub_unsubscribe(sub3);
+}
+
+TEST(PubSub, count_ShouldMatchOnlyFiltersOfTheTopic_WhenManyFiltersGiven) {
+	const char *filters[] = {
+		"#", "group/#", "group/user/#", "group/user/id/#", "+/+/+",
+		"+/+", "group/+/id", "group/user/id", "group/user/ids",
+		"group/user", "group/admin/id", "+/user/+", "group/user/+/x",
+	};
+	pubsub_subscribe_t handles[sizeof(filters) / sizeof(*filters)];
+
+	for (size_t i = 0; i < sizeof(filters) / sizeof(*filters); i++) {
+		handles[i] = pubsub_subscribe(filters[i], callback, NULL);
+	}
+
+	LONGS_EQUAL(7, pubsub_count(testopic));
+	LONGS_EQUAL(4, pubsub_count("group/user"));
+	LONGS_EQUAL(5, pubsub_count("group/admin/id"));
+
+	for (size_t i = 0; i < sizeof(filters) / sizeof(*filters); i++) {
+		pubsub_unsubscribe(handles[i]);
+	}
+}
+
+static const char *nested_topic = "nested";
+
+static void republish_callback(void *context, const void *msg, size_t msglen) {
+	pubsub_publish(*(const char **)context, msg, msglen);
+}
+
+TEST(PubSub, publish_ShouldCallNestedSubscribers_WhenCallbackPublishes) {
+	const char *fixed_messaged = "message";
+	pubsub_subscribe_t sub1 = pubsub_subscribe(testopic,
+			republish_callback, &nested_topic);
+	pubsub_subscribe_t sub2 = pubsub_subscribe("nested", callback, NULL);
+
+	mock().expectOneCall("callback")
+		.withPointerParameter("context", NULL)
+		.withConstPointerParameter("msg", fixed_messaged)
+		.withParameter("msglen", strlen(fixed_messaged));
+	pubsub_publish(testopic, fixed_messaged, strlen(fixed_messaged));
+
+	pubsub_unsubscribe(sub1);
+	pubsub_unsubscribe(sub2);
+}
+
+static int nr_oneshot_called;
+
+static void oneshot_callback(void *context, const void *msg, size_t msglen) {
+	nr_oneshot_called++;
+	pubsub_unsubscribe((pubsub_subscribe_t)context);
+	pubsub_subscribe("other", callback, NULL);
+}
+
+TEST(PubSub, publish_ShouldBeSafe_WhenCallbackUnsubscribesItself) {
+	static pubsub_subscribe_static_t oneshot;
+	nr_oneshot_called = 0;
+
+	pubsub_subscribe_static(&oneshot, testopic, oneshot_callback, &oneshot);
+	pubsub_publish(testopic, "a", 1);
+	pubsub_publish(testopic, "a", 1);
+
+	LONGS_EQUAL(1, nr_oneshot_called);
+	LONGS_EQUAL(1, pubsub_count("other"));
+	LONGS_EQUAL(0, pubsub_count(testopic));
+}
+
+static volatile bool slow_entered;
+static volatile bool slow_released;
+
+static void slow_callback(void *context, const void *msg, size_t msglen) {
+	__atomic_store_n(&slow_entered, true, __ATOMIC_RELEASE);
+	while (!__atomic_load_n(&slow_released, __ATOMIC_ACQUIRE)) {
+	}
+}
+
+static int nr_fast_called;
+
+static void fast_callback(void *context, const void *msg, size_t msglen) {
+	nr_fast_called++;
+}
+
+static void *publish_slow(void *arg) {
+	pubsub_publish("slow", "a", 1);
+	return arg;
+}
+
+TEST(PubSub, publish_ShouldNotBeBlocked_WhenOtherSubscriberIsSlow) {
+	pubsub_subscribe_t sub1 = pubsub_subscribe("slow", slow_callback, NULL);
+	pubsub_subscribe_t sub2 = pubsub_subscribe("fast", fast_callback, NULL);
+	pthread_t thread;
+
+	slow_entered = false;
+	slow_released = false;
+	nr_fast_called = 0;
+	pthread_create(&thread, NULL, publish_slow, NULL);
+	while (!__atomic_load_n(&slow_entered, __ATOMIC_ACQUIRE)) {
+	}
+
+	LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_publish("fast", "b", 1));
+	LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_unsubscribe(sub2));
+	LONGS_EQUAL(1, nr_fast_called);
+
+	__atomic_store_n(&slow_released, true, __ATOMIC_RELEASE);
+	pthread_join(thread, NULL);
+	pubsub_unsubscribe(sub1);
+}
+
+static char async_received[8][16];
+static const void *async_msgs[8];
+static int nr_async_called;
+
+static void async_callback(void *context, const void *msg, size_t msglen) {
+	memcpy(async_received[nr_async_called], msg, msglen);
+	async_received[nr_async_called][msglen] = '\0';
+	async_msgs[nr_async_called] = msg;
+	nr_async_called++;
+}
+
+TEST_GROUP(PubSubAsync) {
+	struct pubsub_async_param param;
+
+	void setup(void) {
+		pubsub_init();
+
+		nr_async_called = 0;
+		param.queue_len = 2;
+		param.backpressure = PUBSUB_BACKPRESSURE_DROP_NEW;
+		param.timeout_ms = 0;
+	}
+	void teardown() {
+		pubsub_deinit();
+	}
+};
+
+TEST(PubSubAsync, subscribe_ShouldReturnNull_WhenInvalidParamsGiven) {
+	POINTERS_EQUAL(NULL, pubsub_subscribe_async(testopic,
+				NULL, NULL, &param));
+	POINTERS_EQUAL(NULL, pubsub_subscribe_async(testopic,
+				async_callback, NULL, NULL));
+	param.queue_len = 0;
+	POINTERS_EQUAL(NULL, pubsub_subscribe_async(testopic,
+				async_callback, NULL, &param));
+}
+
+TEST(PubSubAsync, subscribe_ShouldReturnNull_WhenAllocationFail) {
+	cpputest_malloc_set_out_of_memory();
+	POINTERS_EQUAL(NULL, pubsub_subscribe_async(testopic,
+				async_callback, NULL, &param));
+	cpputest_malloc_set_not_out_of_memory();
+}
+
+TEST(PubSubAsync, publish_ShouldDeliverOnDispatch) {
+	pubsub_subscribe_t sub = pubsub_subscribe_async(testopic,
+			async_callback, NULL, &param);
+
+	pubsub_publish(testopic, "hello", 5);
+	LONGS_EQUAL(0, nr_async_called);
+
+	LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_dispatch(sub, 0));
+	LONGS_EQUAL(1, nr_async_called);
+	STRCMP_EQUAL("hello", async_received[0]);
+	LONGS_EQUAL(PUBSUB_TIMEOUT, pubsub_dispatch(sub, 0));
+
+	pubsub_unsubscribe(sub);
+}
+
+TEST(PubSubAsync, publish_ShouldShareSingleCopy_WhenManyAsyncSubscribers) {
+	pubsub_subscribe_t sub1 = pubsub_subscribe_async(testopic,
+			async_callback, NULL, &param);
+	pubsub_subscribe_t sub2 = pubsub_subscribe_async("group/#",
+			async_callback, NULL, &param);
+
+	pubsub_publish(testopic, "hello", 5);
+	pubsub_dispatch(sub1, 0);
+	pubsub_dispatch(sub2, 0);
+
+	LONGS_EQUAL(2, nr_async_called);
+	POINTERS_EQUAL(async_msgs[0], async_msgs[1]);
+
+	pubsub_unsubscribe(sub1);
+	pubsub_unsubscribe(sub2);
+}
+
+TEST(PubSubAsync, publish_ShouldDropNewMessages_WhenQueueFull) {
+	pubsub_subscribe_t sub = pubsub_subscribe_async(testopic,
+			async_callback, NULL, &param);
+
+	pubsub_publish(testopic, "1", 1);
+	pubsub_publish(testopic, "2", 1);
+	pubsub_publish(testopic, "3", 1);
+	LONGS_EQUAL(1, pubsub_count_dropped(sub));
+
+	while (pubsub_dispatch(sub, 0) == PUBSUB_SUCCESS) {
+	}
+	LONGS_EQUAL(2, nr_async_called);
+	STRCMP_EQUAL("1", async_received[0]);
+	STRCMP_EQUAL("2", async_received[1]);
+
+	pubsub_unsubscribe(sub);
+}
+
+TEST(PubSubAsync, publish_ShouldDropOldestMessages_WhenQueueFull) {
+	param.backpressure = PUBSUB_BACKPRESSURE_DROP_OLDEST;
+	pubsub_subscribe_t sub = pubsub_subscribe_async(testopic,
+			async_callback, NULL, &param);
+
+	pubsub_publish(testopic, "1", 1);
+	pubsub_publish(testopic, "2", 1);
+	pubsub_publish(testopic, "3", 1);
+	LONGS_EQUAL(1, pubsub_count_dropped(sub));
+
+	while (pubsub_dispatch(sub, 0) == PUBSUB_SUCCESS) {
+	}
+	LONGS_EQUAL(2, nr_async_called);
+	STRCMP_EQUAL("2", async_received[0]);
+	STRCMP_EQUAL("3", async_received[1]);
+
+	pubsub_unsubscribe(sub);
+}
+
+TEST(PubSubAsync, publish_ShouldDropAfterTimeout_WhenBlockingAndQueueFull) {
+	param.queue_len = 1;
+	param.backpressure = PUBSUB_BACKPRESSURE_BLOCK;
+	param.timeout_ms = 10;
+	pubsub_subscribe_t sub = pubsub_subscribe_async(testopic,
+			async_callback, NULL, &param);
+
+	pubsub_publish(testopic, "1", 1);
+	pubsub_publish(testopic, "2", 1);
+	LONGS_EQUAL(1, pubsub_count_dropped(sub));
+
+	pubsub_unsubscribe(sub);
+}
+
+static void *dispatch_one(void *arg) {
+	pubsub_dispatch((pubsub_subscribe_t)arg, MSGQ_WAIT_FOREVER);
+	return NULL;
+}
+
+TEST(PubSubAsync, publish_ShouldWaitForSpace_WhenBlocking) {
+	param.queue_len = 1;
+	param.backpressure = PUBSUB_BACKPRESSURE_BLOCK;
+	param.timeout_ms = 5000;
+	pubsub_subscribe_t sub = pubsub_subscribe_async(testopic,
+			async_callback, NULL, &param);
+	pthread_t thread;
+
+	pubsub_publish(testopic, "1", 1);
+	pthread_create(&thread, NULL, dispatch_one, sub);
+	pubsub_publish(testopic, "2", 1);
+	pthread_join(thread, NULL);
+
+	LONGS_EQUAL(0, pubsub_count_dropped(sub));
+	LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_dispatch(sub, 0));
+	LONGS_EQUAL(2, nr_async_called);
+	STRCMP_EQUAL("2", async_received[1]);
+
+	pubsub_unsubscribe(sub);
+}
+
+TEST(PubSubAsync, unsubscribe_ShouldReleaseQueuedMessages) {
+	pubsub_subscribe_t sub = pubsub_subscribe_async(testopic,
+			async_callback, NULL, &param);
+
+	pubsub_publish(testopic, "1", 1);
+	pubsub_publish(testopic, "2", 1);
+
+	LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_unsubscribe(sub));
+	LONGS_EQUAL(0, pubsub_count(testopic));
+	LONGS_EQUAL(0, nr_async_called);
+}
+
+struct dispatcher {
+	pubsub_subscribe_t sub;
+	pubsub_error_t err;
+};
+
+static void *dispatch_until_unsubscribed(void *arg) {
+	struct dispatcher *dispatcher = (struct dispatcher *)arg;
+
+	while ((dispatcher->err = pubsub_dispatch(dispatcher->sub,
+			MSGQ_WAIT_FOREVER)) == PUBSUB_SUCCESS) {
+	}
+
+	return NULL;
+}
+
+TEST(PubSubAsync, dispatch_ShouldReturnNoExistSubscriber_WhenUnsubscribedWhileWaiting) {
+	struct dispatcher dispatchers[2];
+	pthread_t threads[2];
+	pubsub_subscribe_t sub = pubsub_subscribe_async(testopic,
+			async_callback, NULL, &param);
+
+	for (int i = 0; i < 2; i++) {
+		dispatchers[i] = (struct dispatcher) { sub, PUBSUB_SUCCESS };
+		pthread_create(&threads[i], NULL,
+				dispatch_until_unsubscribed, &dispatchers[i]);
+	}
+
+	pubsub_publish(testopic, "1", 1);
+	while (__atomic_load_n(&nr_async_called, __ATOMIC_ACQUIRE) == 0) {
+		usleep(1000);
+	}
+	usleep(10000); /* until both are blocked again */
+
+	LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_unsubscribe(sub));
+
+	for (int i = 0; i < 2; i++) {
+		pthread_join(threads[i], NULL);
+		LONGS_EQUAL(PUBSUB_NO_EXIST_SUBSCRIBER, dispatchers[i].err);
+	}
+	LONGS_EQUAL(1, nr_async_called);
+}
+
+TEST(PubSubAsync, dispatch_ShouldReturnInvalidParam_WhenNotAsyncHandleGiven) {
+	pubsub_subscribe_t sub = pubsub_subscribe(testopic, callback, NULL);
+
+	LONGS_EQUAL(PUBSUB_INVALID_PARAM, pubsub_dispatch(NULL, 0));
+	LONGS_EQUAL(PUBSUB_INVALID_PARAM, pubsub_dispatch(sub, 0));
+
+	pubsub_unsubscribe(sub);
+}
+
+TEST(PubSubAsync, publish_buf_ShouldQueueReferenceWithoutCopying) {
+	uintptr_t mem[16];
+	struct lm_buf_pool pool;
+	lm_buf_pool_init(&pool, mem, sizeof(mem), 8);
+	const size_t nr_bufs = lm_buf_pool_available(&pool);
+	struct lm_buf *buf = lm_buf_alloc(&pool, 5);
+	memcpy(lm_buf_data(buf), "hello", 5);
+	pubsub_subscribe_t sub1 = pubsub_subscribe_async(testopic,
+			async_callback, NULL, &param);
+	pubsub_subscribe_t sub2 = pubsub_subscribe_async(testopic,
+			async_callback, NULL, &param);
+
+	LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_publish_buf(testopic, buf));
+	lm_buf_unref(buf);
+	LONGS_EQUAL(nr_bufs - 1, lm_buf_pool_available(&pool));
+
+	pubsub_dispatch(sub1, 0);
+	pubsub_dispatch(sub2, 0);
+	POINTERS_EQUAL(lm_buf_data(buf), async_msgs[0]);
+	POINTERS_EQUAL(lm_buf_data(buf), async_msgs[1]);
+	LONGS_EQUAL(nr_bufs, lm_buf_pool_available(&pool));
+
+	pubsub_unsubscribe(sub1);
+	pubsub_unsubscribe(sub2);
+}
+
+TEST(PubSubAsync, publish_buf_ShouldPassBufferData_WhenSyncSubscriber) {
+	struct lm_buf *buf = lm_buf_new(5);
+	memcpy(lm_buf_data(buf), "hello", 5);
+	pubsub_subscribe_t sub = pubsub_subscribe(testopic,
+			async_callback, NULL);
+
+	LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_publish_buf(testopic, buf));
+	POINTERS_EQUAL(lm_buf_data(buf), async_msgs[0]);
+	LONGS_EQUAL(PUBSUB_INVALID_PARAM, pubsub_publish_buf(testopic, NULL));
+
+	lm_buf_unref(buf);
+	pubsub_unsubscribe(sub);
+}
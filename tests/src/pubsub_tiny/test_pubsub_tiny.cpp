@@ -6,6 +6,7 @@
 
 #include "CppUTest/TestHarness.h"
 #include "CppUTest/TestHarness_c.h"
+#include <stdio.h>
 #include <string.h>
 #include "libmcu/pubsub.h"
 
@@ -195,3 +196,45 @@ TEST(PubSub, stringify_ShouldReturnStrings_WhenErrorCodeGiven) {
 	STRCMP_EQUAL("no exist subscriber",
 			pubsub_stringify_error(PUBSUB_NO_EXIST_SUBSCRIBER));
 }
+
+TEST(PubSub, publish_handle_ShouldCallCallback_WhenResolvedTopicGiven) {
+	pubsub_topic_handle_t handle = pubsub_topic_handle(topic);
+	pubsub_subscribe_t sub = pubsub_subscribe(topic, callback, NULL);
+
+	CHECK(handle != NULL);
+	LONGS_EQUAL(PUBSUB_SUCCESS,
+			pubsub_publish_handle(handle, "message", 7));
+	LONGS_EQUAL(1, callback_count);
+	MEMCMP_EQUAL("message", message_spy, 7);
+
+	pubsub_unsubscribe(sub);
+}
+
+TEST(PubSub, topic_handle_ShouldReturnNull_WhenNotRegisteredTopicGiven) {
+	POINTERS_EQUAL(NULL, pubsub_topic_handle("tmp"));
+	POINTERS_EQUAL(NULL, pubsub_topic_handle(NULL));
+	LONGS_EQUAL(PUBSUB_INVALID_PARAM,
+			pubsub_publish_handle(NULL, "message", 7));
+}
+
+TEST(PubSub, create_ShouldFindAllTopics_WhenManyCreatedAndDestroyed) {
+	static char names[100][8];
+
+	for (int i = 0; i < 100; i++) {
+		snprintf(names[i], sizeof(names[i]), "t%d", i);
+		LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_create(names[i]));
+	}
+	for (int i = 0; i < 100; i += 3) {
+		LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_destroy(names[i]));
+	}
+	for (int i = 0; i < 100; i++) {
+		LONGS_EQUAL(i % 3? 0 : PUBSUB_NO_EXIST_TOPIC,
+				pubsub_count(names[i]));
+	}
+	for (int i = 0; i < 100; i++) {
+		if (i % 3) {
+			LONGS_EQUAL(PUBSUB_SUCCESS, pubsub_destroy(names[i]));
+		}
+	}
+	LONGS_EQUAL(0, pubsub_count(topic));
+}
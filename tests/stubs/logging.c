@@ -27,3 +27,11 @@ size_t logging_write(logging_t type, const struct logging_context *ctx, ...)
 	}
 	return (size_t)len;
 }
+
+struct logging_tag *logging_resolve_site(struct logging_site *site,
+		const char *tag)
+{
+	site->storage.tag = tag;
+	site->tag = &site->storage;
+	return site->tag;
+}
@@ -45,9 +45,21 @@ MACRO_DEFS = {
     "METRICS_DEFINE_BYTES":      ("bytes",      0,         INT32_MAX, False, False),
     "METRICS_DEFINE_BINARY":     ("binary",     0,         1,         False, False),
     "METRICS_DEFINE_STATE":      ("state",      INT32_MIN, INT32_MAX, False, False),
+    "METRICS_DEFINE_HISTOGRAM":  ("histogram",  None,      None,      False, False),
 }
 
 
+def _histogram_buckets(index: int, label: str, args: list[str]) -> list[MetricSchema]:
+    # One key per bucket in a row, each covering [bounds[i-1], bounds[i] - 1]
+    bounds = [_parse_int(a) for a in args]
+    lower = [INT32_MIN] + bounds
+    upper = [b - 1 for b in bounds] + [INT32_MAX]
+    return [
+        MetricSchema(key=index + i, label=label, type="histogram", min=lo, max=hi)
+        for i, (lo, hi) in enumerate(zip(lower, upper))
+    ]
+
+
 def _parse_int(s: str) -> int:
     s = s.strip()
     if s in ("INT32_MAX", "INT_MAX"):
@@ -83,6 +95,12 @@ def parse_def(path: str) -> list[MetricSchema]:
             type_name, fixed_min, fixed_max, has_range, has_unit = MACRO_DEFS[macro]
             args = [a.strip() for a in rest.split(",")] if rest else []
 
+            if macro == "METRICS_DEFINE_HISTOGRAM":
+                buckets = _histogram_buckets(index, label, args)
+                schemas.extend(buckets)
+                index += len(buckets)
+                continue
+
             entry = MetricSchema(key=index, label=label, type=type_name)
             index += 1
 
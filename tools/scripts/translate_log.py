@@ -1,17 +1,117 @@
 import sys
 import fcntl
 import os
+import re
 import struct
 
-TYPE_LIST = ("VERBOSE", "DEBUG", "INFO", "WARN", "ERROR", "NONE")
+TYPE_LIST = ("DEBUG", "INFO", "WARN", "ERROR", "NONE")
 TIMESTAMP_SIZE = 4 # 8 or 4 bytes
-LOG_SIZE = TIMESTAMP_SIZE + 4*2 + 2 + 2 + 1 # sizeof(ts + pc + lr + len + type)
+LOG_SIZE = TIMESTAMP_SIZE + 4*2 + 2 + 2 + 1 + 4 # sizeof(ts + pc + lr + magic + len + type + tag)
 LOG_MAGIC = 0xA5A5
+DICTIONARY_FLAG = 0x80
+
+# Argument sizes on the target, ILP32 assumed. Arguments are packed as they
+# are passed through varargs, so anything shorter than int is promoted.
+ARG_SIZES = {None: 4, "hh": 4, "h": 4, "l": 4, "ll": 8, "j": 8, "z": 4, "t": 4}
+DOUBLE_SIZE = 8 # long double as well on ARM EABI
+POINTER_SIZE = 4
+SPEC_PATTERN = re.compile(
+        r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?([diouxXcfFeEgGaAspn%])")
+
+
+class elfimage:
+    def __init__(self, file):
+        from elftools.elf.elffile import ELFFile
+
+        self.sections = []
+        with open(file, "rb") as f:
+            for section in ELFFile(f).iter_sections():
+                if section["sh_flags"] & 0x2 and section["sh_type"] != "SHT_NOBITS":
+                    self.sections.append((section["sh_addr"], section.data()))
+
+    def read_string(self, addr):
+        for base, data in self.sections:
+            if base <= addr < base + len(data):
+                end = data.find(b"\0", addr - base)
+                return data[addr - base:end].decode("ascii", "replace")
+        return None
+
+
+def unpack_arg(fmt, args, offset):
+    size = struct.calcsize(fmt)
+    return struct.unpack(fmt, args[offset:offset+size])[0], offset + size
+
+def render_dictionary(fmt, args):
+    """Render a format string with the arguments packed by the logger
+
+    Args:
+        fmt (str): Format string read from the ELF image
+        args (bytes): Packed arguments
+    Returns:
+        str: Rendered message, cut where the arguments run out
+    """
+    out = ""
+    pos = 0
+    offset = 0
+
+    for m in SPEC_PATTERN.finditer(fmt):
+        out += fmt[pos:m.start()]
+        pos = m.end()
+        flags, width, precision, length, conv = m.groups()
+
+        try:
+            if width == "*":
+                width, offset = unpack_arg("<i", args, offset)
+            if precision == "*":
+                precision, offset = unpack_arg("<i", args, offset)
+
+            if conv == "%":
+                out += "%"
+                continue
+            elif conv == "n":
+                continue
+            elif conv == "s":
+                strlen, offset = unpack_arg("<B", args, offset)
+                if len(args) - offset < strlen:
+                    raise struct.error
+                value = args[offset:offset+strlen].decode("ascii", "replace")
+                offset += strlen
+            elif conv in "fFeEgGaA":
+                value, offset = unpack_arg("<d", args, offset)
+            elif conv == "p":
+                value, offset = unpack_arg("<L" if POINTER_SIZE == 4 else "<Q", args, offset)
+                conv, flags = "x", flags + "#"
+            else:
+                size = ARG_SIZES.get(length, 4)
+                signed = conv in "di"
+                code = {4: "l", 8: "q"}[size]
+                value, offset = unpack_arg("<" + (code if signed else code.upper()), args, offset)
+                if length in ("hh", "h"):
+                    bits = 8 if length == "hh" else 16
+                    value &= (1 << bits) - 1
+                    if signed and value >> (bits - 1):
+                        value -= 1 << bits
+                if conv == "u":
+                    conv = "d"
+        except struct.error:
+            return out
+
+        spec = "%" + flags
+        spec += str(width) if width is not None else ""
+        spec += "." + str(precision) if precision is not None else ""
+
+        if conv in "aA":
+            out += float.hex(value)
+        else:
+            out += (spec + conv) % value
+
+    return out + fmt[pos:]
 
 
 class embedlog:
     def __init__(self):
         self.elf_file = None
+        self.elf_image = None
 
     def __str__(self):
         self.message = self.message.replace('\n', ' ').replace('\r', ' ')
@@ -67,11 +167,39 @@ class embedlog:
 
         self.message_length = struct.unpack("H", byte_stream[base_idx+10:base_idx+12])[0]
         self.log_type = struct.unpack("B", byte_stream[base_idx+12:base_idx+13])[0]
-        self.message = struct.unpack(str(self.message_length) + "s",
-                                     byte_stream[base_idx+13:base_idx+13+self.message_length])[0].decode('ascii')
+        message = struct.unpack(str(self.message_length) + "s",
+                                byte_stream[LOG_SIZE:LOG_SIZE+self.message_length])[0]
+
+        if self.log_type & DICTIONARY_FLAG:
+            self.log_type &= ~DICTIONARY_FLAG
+            self.message = self.unpack_dictionary(message)
+        else:
+            self.message = message.decode('ascii')
 
         return self.message_length + LOG_SIZE
 
+    def unpack_dictionary(self, message):
+        """Recover the text of a log stored in dictionary mode
+
+        Args:
+            message (bytes): Format string address followed by the packed arguments
+        Returns:
+            str: Rendered message
+        """
+        addr = struct.unpack("<L", message[0:POINTER_SIZE])[0]
+
+        if self.elf_file is None:
+            return "<fmt@{addr:#x}> {args}".format(addr=addr,
+                    args=message[POINTER_SIZE:].hex())
+        if self.elf_image is None:
+            self.elf_image = elfimage(self.elf_file)
+
+        fmt = self.elf_image.read_string(addr)
+        if fmt is None:
+            return "<fmt@{addr:#x}: not found>".format(addr=addr)
+
+        return render_dictionary(fmt, message[POINTER_SIZE:])
+
 
 def addr2line(file, addr):
     cmd = os.getenv("ADDR2LINE", "addr2line")